@@ -0,0 +1,156 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+/*
+    bench_arp.c - ARP cache alone, MAC and routes are stubs. Request rate limit and negative cache of
+    unanswered host, then cycles per arps_resolve with neighbor set fitting in cache and bigger than cache.
+
+    Options (DEFINES):
+    HOSTS           neighbor set, fitting in cache. Churn set is 20% bigger
+    ARP_CACHE_SIZE_MAX, ARP_HASH_SIZE
+ */
+
+#include "host.h"
+#include "../../userspace/process.h"
+#include "../../userspace/io.h"
+#include "../../userspace/endian.h"
+#include "tcpips_private.h"
+#include "arps.h"
+
+#ifndef HOSTS
+#define HOSTS                           500
+#endif //HOSTS
+
+#define LOOKUPS                         200000
+//unanswered host is checked for this time
+#define UNANSWERED_S                    30
+#define UNANSWERED_HOST                 9999
+
+void app();
+
+const REX __APP = {"App main", 65536, 200, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, app};
+
+static TCPIPS tcpips;
+static unsigned int requests, not_resolved;
+static unsigned int seed = 12345;
+
+//ARP request is counted, not sent
+IO* macs_allocate_io(TCPIPS* tcpips)
+{
+    ++requests;
+    return NULL;
+}
+
+void macs_tx(TCPIPS* tcpips, IO* io, const MAC* mac, uint16_t lentype)
+{
+}
+
+void routes_resolved(TCPIPS* tcpips, ARP_CACHE_ENTRY* arp)
+{
+}
+
+void routes_not_resolved(TCPIPS* tcpips, ARP_CACHE_ENTRY* arp)
+{
+    ++not_resolved;
+}
+
+void tcpips_release_io(TCPIPS* tcpips, IO* io)
+{
+}
+
+static unsigned int bench_rand()
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+static void bench_host(IP* ip, unsigned int i)
+{
+    ip->u8[0] = 10;
+    ip->u8[1] = 0;
+    ip->u8[2] = (i + 2) >> 8;
+    ip->u8[3] = (i + 2) & 0xff;
+}
+
+static void bench_reply(IO* io, unsigned int i)
+{
+    ARP_PACKET* arp = io_data(io);
+    short2be(arp->hrd_be, ARP_HRD_ETHERNET);
+    short2be(arp->pro_be, ETHERTYPE_IP);
+    arp->hln = sizeof(MAC);
+    arp->pln = sizeof(IP);
+    short2be(arp->op_be, ARP_REPLY);
+    arp->src_mac.u32.hi = 0x02000000 | i;
+    arp->src_mac.u32.lo = 0x0001;
+    bench_host(&arp->src_ip, i);
+    arp->dst_mac = tcpips.macs.mac;
+    arp->dst_ip = tcpips.ips.ip;
+    io->data_size = sizeof(ARP_PACKET);
+    arps_rx(&tcpips, io);
+}
+
+static void bench_unanswered()
+{
+    IP ip;
+    MAC mac;
+    ARP_CACHE_ENTRY* pending;
+    ARP_RESOLVE_STATUS status = ARP_RESOLVED;
+    unsigned int start, k;
+    bench_host(&ip, UNANSWERED_HOST);
+    start = tcpips.seconds;
+    for (; tcpips.seconds < start + UNANSWERED_S; ++tcpips.seconds)
+    {
+        arps_timer(&tcpips, tcpips.seconds);
+        //sender is retrying all the time
+        for (k = 0; k < 100; ++k)
+            status = arps_resolve(&tcpips, &ip, &mac, &pending);
+        printd("%2d s: %s, requests %d, not resolved %d\n", tcpips.seconds - start,
+               status == ARP_RESOLVED ? "resolved" : (status == ARP_PENDING ? "pending" : "unreachable"), requests, not_resolved);
+    }
+}
+
+static void bench_run(unsigned int hosts, const char* name)
+{
+    unsigned int i, n, hit;
+    unsigned long long t;
+    IP ip;
+    MAC mac;
+    ARP_CACHE_ENTRY* pending;
+    IO* io = io_create(64);
+    //warm up: resolve all
+    for (i = 0; i < hosts; ++i)
+    {
+        bench_host(&ip, i);
+        if (arps_resolve(&tcpips, &ip, &mac, &pending) != ARP_RESOLVED)
+            bench_reply(io, i);
+    }
+    t = __builtin_ia32_rdtsc();
+    for (n = hit = 0; n < LOOKUPS; ++n)
+    {
+        i = bench_rand() % hosts;
+        bench_host(&ip, i);
+        if (arps_resolve(&tcpips, &ip, &mac, &pending) == ARP_RESOLVED)
+            ++hit;
+        else
+            bench_reply(io, i);
+    }
+    t = __builtin_ia32_rdtsc() - t;
+    printd("%s: %d hosts, cache %d: %d cycles/resolve, hit %d%%\n", name, hosts, ARP_CACHE_SIZE_MAX, (int)(t / LOOKUPS), hit * 100 / LOOKUPS);
+    io_destroy(io);
+}
+
+void app()
+{
+    tcpips.macs.mac.u32.hi = 0x02aabbcc;
+    tcpips.macs.mac.u32.lo = 0x0001;
+    tcpips.ips.ip.u32.ip = IP_MAKE(10, 0, 0, 1);
+    tcpips.seconds = 1;
+    arps_init(&tcpips);
+    bench_unanswered();
+    bench_run(HOSTS, "fit");
+    bench_run(HOSTS + HOSTS / 5, "churn");
+    _exit(0);
+}
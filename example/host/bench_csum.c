@@ -0,0 +1,116 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+/*
+    bench_csum.c - Internet checksum: match with RFC 1071 byte loop on random buffers of any alignment,
+    chained sums, incremental update, and cycles per byte against byte loop.
+ */
+
+#include "host.h"
+#include "../../userspace/process.h"
+#include "../../userspace/ip.h"
+#include <string.h>
+
+#define CHECKS                          2000000
+#define SIZE_MAX_CHECK                  1600
+#define REPEAT                          100
+#define BEST_OF                         200
+
+void app();
+
+const REX __APP = {"App main", 16384, 200, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, app};
+
+static const unsigned int __SIZES[] =   {64, 128, 256, 512, 1024, 1500};
+
+static uint8_t buf[2048] __attribute__((aligned(8)));
+static unsigned int seed = 12345;
+
+static unsigned int bench_rand()
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+//RFC 1071 reference
+static uint16_t bench_checksum(const uint8_t* data, unsigned int size)
+{
+    unsigned int i;
+    uint32_t sum = 0;
+    for (i = 0; i < (size >> 1); ++i)
+        sum += (data[i << 1] << 8) | data[(i << 1) + 1];
+    if (size & 1)
+        sum += data[size - 1] << 8;
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return ~((uint16_t)sum);
+}
+
+static unsigned int bench_check()
+{
+    unsigned int i, n, off, size, f, bad;
+    uint16_t ref, upd;
+    uint8_t from[4], to[4];
+    for (n = bad = 0; n < CHECKS; ++n)
+    {
+        off = bench_rand() & 7;
+        size = bench_rand() % SIZE_MAX_CHECK;
+        //all ones buffers are for carry check
+        for (i = 0; i < size; ++i)
+            buf[off + i] = (n & 3) == 0 ? 0xff : bench_rand();
+        ref = bench_checksum(buf + off, size);
+        if (ip_checksum(buf + off, size) != ref)
+            ++bad;
+        //chained, first chunk is even
+        i = (bench_rand() % (size + 1)) & ~1;
+        if (ip_checksum_fold(ip_checksum_add(ip_checksum_add(0, buf + off, i), buf + off + i, size - i)) != ref)
+            ++bad;
+        //incremental update of 16-bit aligned field
+        if (size >= 8)
+        {
+            f = (bench_rand() % (size - 4)) & ~1;
+            memcpy(from, buf + off + f, 4);
+            for (i = 0; i < 4; ++i)
+                to[i] = bench_rand();
+            memcpy(buf + off + f, to, 4);
+            upd = ip_checksum_update(ref, from, to, 4);
+            ref = bench_checksum(buf + off, size);
+            //0 and 0xffff are same in one's complement
+            if (upd != ref && !((upd == 0xffff && ref == 0) || (upd == 0 && ref == 0xffff)))
+                ++bad;
+        }
+    }
+    return bad;
+}
+
+void app()
+{
+    unsigned int i, n, r;
+    volatile uint16_t sink;
+    unsigned long long t0, t1, t2, best_ref, best;
+    printd("mismatches: %d of %d\n", bench_check(), CHECKS);
+    printd("cycles/byte x100\nsize  byte loop  ip_checksum\n");
+    for (n = 0; n < sizeof(__SIZES) / sizeof(unsigned int); ++n)
+    {
+        best_ref = best = ~0ull;
+        for (r = 0; r < BEST_OF; ++r)
+        {
+            t0 = __builtin_ia32_rdtsc();
+            for (i = 0; i < REPEAT; ++i)
+                sink = bench_checksum(buf + 2, __SIZES[n]);
+            t1 = __builtin_ia32_rdtsc();
+            for (i = 0; i < REPEAT; ++i)
+                sink = ip_checksum(buf + 2, __SIZES[n]);
+            t2 = __builtin_ia32_rdtsc();
+            if (t1 - t0 < best_ref)
+                best_ref = t1 - t0;
+            if (t2 - t1 < best)
+                best = t2 - t1;
+        }
+        printd("%4d  %9d  %11d\n", __SIZES[n], (int)(best_ref * 100 / REPEAT / __SIZES[n]), (int)(best * 100 / REPEAT / __SIZES[n]));
+    }
+    (void)sink;
+    _exit(0);
+}
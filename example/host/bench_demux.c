@@ -0,0 +1,74 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+/*
+    bench_demux.c - TCP segment demux: TCB and listener lookup with many connections.
+    tcps.c is included to reach static lookup functions. Measured in host cycles.
+
+    Options (DEFINES):
+    TCP_HASH_SIZE   TCB lookup hash buckets
+ */
+
+//from REXOS tree of Makefile
+#include "tcps.c"
+#include "host.h"
+
+#define LISTENERS                       4
+#define LOOKUPS                         1000000
+
+void app();
+
+const REX __APP = {"App main", 131072, 200, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, app};
+
+static const int __CONNECTIONS[] =      {8, 64, 256};
+
+static TCPIPS tcpips;
+
+static void bench_addr(IP* ip, int n)
+{
+    ip->u32.ip = IP_MAKE(10, 0, 1 + n / 200, 1 + n % 200);
+}
+
+void app()
+{
+    int c, i, k, n, found;
+    IP ip;
+    IPC ipc;
+    unsigned long long t;
+    tcps_init(&tcpips);
+    //web server with extras
+    for (i = 0; i < LISTENERS; ++i)
+    {
+        ipc.param1 = 80 + i;
+        ipc.process = 1;
+        tcps_listen(&tcpips, &ipc);
+    }
+    n = 0;
+    for (c = 0; c < sizeof(__CONNECTIONS) / sizeof(int); ++c)
+    {
+        for (; n < __CONNECTIONS[c]; ++n)
+        {
+            bench_addr(&ip, n);
+            if (tcps_create_tcb_internal(&tcpips, &ip, 30000 + n * 7, 80) == INVALID_HANDLE)
+            {
+                printd("create %d failed: %d\n", n, get_last_error());
+                _exit(1);
+            }
+        }
+        found = 0;
+        t = __builtin_ia32_rdtsc();
+        for (k = 0; k < LOOKUPS; ++k)
+        {
+            i = (k * 37) % n;
+            bench_addr(&ip, i);
+            if (tcps_find_tcb(&tcpips, &ip, 30000 + i * 7, 80) != INVALID_HANDLE && tcps_find_listener(&tcpips, 80) != INVALID_HANDLE)
+                ++found;
+        }
+        t = __builtin_ia32_rdtsc() - t;
+        printd("%d connections: %d cycles per segment demux, found %d of %d\n", n, (int)(t / LOOKUPS), found, LOOKUPS);
+    }
+    _exit(0);
+}
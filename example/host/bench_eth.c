@@ -0,0 +1,391 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+/*
+    bench_eth.c - discrete time model of STM32 ETH: 100Mbit wire, MAC rx FIFO, DMA descriptor engine, IRQ
+    and tcpips post/complete logic. Real driver source runs on emulated registers. Frame sequence is checked
+    end to end. Not POSIX core based: driver is called directly, IPC is modelled by fixed delay.
+
+    Options (DEFINES):
+    ETH_RX_RING_SIZE, ETH_TX_RING_SIZE
+    RX_LEN          rx frame size, 0 - no rx
+    BURST           rx frames in burst at line rate, 0 - continuous
+    BURST_PERIOD_US burst repeat period
+    RX_US           stack time per rx frame
+    STALL_EVERY     stack stalls every N rx frames
+    STALL_US        stall time
+    TX_LEN          tx frame size, generated by stack, 0 - no tx
+    TX_US           stack time per tx frame
+    TX_DONE_US      stack time per tx completion
+    IRQ_NS          interrupt latency
+
+    Scenarios:
+    rx bursts       -DBURST=128 -DBURST_PERIOD_US=2000 -DRX_US=10
+    rx stalls       -DRX_LEN=1518 -DRX_US=40 -DSTALL_EVERY=50 -DSTALL_US=2000
+    IRQ latency     -DBURST=128 -DBURST_PERIOD_US=2000 -DRX_US=10 -DIRQ_NS=30000
+    tx bulk         -DRX_LEN=0 -DTX_LEN=64 -DTX_US=5 -DTX_DONE_US=2
+ */
+
+#include "stm32_eth_model.c"
+#include <stdio.h>
+
+#ifndef RX_LEN
+#define RX_LEN                          64
+#endif //RX_LEN
+#ifndef BURST
+#define BURST                           0
+#endif //BURST
+#ifndef BURST_PERIOD_US
+#define BURST_PERIOD_US                 0
+#endif //BURST_PERIOD_US
+#ifndef RX_US
+#define RX_US                           10
+#endif //RX_US
+#ifndef STALL_EVERY
+#define STALL_EVERY                     0
+#endif //STALL_EVERY
+#ifndef STALL_US
+#define STALL_US                        0
+#endif //STALL_US
+#ifndef TX_LEN
+#define TX_LEN                          0
+#endif //TX_LEN
+#ifndef TX_US
+#define TX_US                           5
+#endif //TX_US
+#ifndef TX_DONE_US
+#define TX_DONE_US                      2
+#endif //TX_DONE_US
+#ifndef IRQ_NS
+#define IRQ_NS                          1000
+#endif //IRQ_NS
+
+#define STEP_NS                         20
+#define SIM_NS                          2000000000ull
+#define IPC_NS                          3000
+//100Mbit
+#define NS_PER_BYTE                     80
+//preamble, SFD, IFG
+#define WIRE_OVERHEAD                   20
+#define FIFO_SIZE                       2048
+#define FIFO_FRAMES                     64
+#define POOL                            64
+#define FRAME_MAX                       1536
+#define QUEUE_SIZE                      1024
+#define TX_QUEUE_MAX                    8
+
+ETH_TypeDef eth_regs;
+RCC_TypeDef rcc_regs;
+int last_error;
+static EXO exo;
+static unsigned long long now;
+
+//IO pool
+typedef struct {
+    IO io;
+    uint8_t data[FRAME_MAX];
+} BUF;
+
+static BUF bufs[POOL];
+static IO* free_list[POOL];
+static int free_count;
+
+static IO* io_alloc()
+{
+    IO* io;
+    if (!free_count)
+        return NULL;
+    io = free_list[--free_count];
+    io->next = NULL;
+    io->data_offset = 0;
+    io->data_size = 0;
+    return io;
+}
+
+static void io_free(IO* io)
+{
+    free_list[free_count++] = io;
+}
+
+//IPC queues: 0 - to stack, 1 - to driver
+typedef struct {
+    unsigned long long at;
+    unsigned int cmd;
+    IO* io;
+    int param3;
+} MSG;
+
+static MSG queue[2][QUEUE_SIZE];
+static int queue_head[2], queue_tail[2];
+
+static void queue_push(int to_drv, unsigned int cmd, IO* io, int param3)
+{
+    MSG* m = &queue[to_drv][queue_tail[to_drv]];
+    queue_tail[to_drv] = (queue_tail[to_drv] + 1) % QUEUE_SIZE;
+    m->at = now + IPC_NS;
+    m->cmd = cmd;
+    m->io = io;
+    m->param3 = param3;
+}
+
+static MSG* queue_pop(int to_drv)
+{
+    MSG* m;
+    if (queue_head[to_drv] == queue_tail[to_drv] || queue[to_drv][queue_head[to_drv]].at > now)
+        return NULL;
+    m = &queue[to_drv][queue_head[to_drv]];
+    queue_head[to_drv] = (queue_head[to_drv] + 1) % QUEUE_SIZE;
+    return m;
+}
+
+void iio_complete_ex(HANDLE process, unsigned int cmd, unsigned int handle, IO* io, int param3)
+{
+    queue_push(0, cmd, io, param3);
+}
+
+//MAC/DMA
+static unsigned int fifo_len[FIFO_FRAMES], fifo_seq[FIFO_FRAMES];
+static int fifo_head, fifo_count, fifo_bytes;
+static bool rx_suspended, tx_suspended;
+static unsigned long long irq_at, next_arrival, tx_wire_busy_until, burst_start;
+static ETH_DESCRIPTORS* tx_active;
+static unsigned int rx_seq, wire_tx_seq, burst_left;
+static unsigned long long st_rx_wire, st_rx_fifo_drop, st_irq, st_rx_done, st_rx_gap, st_tx_done, st_tx_order, st_rx_bad;
+
+void eth_dmasr_clear(uint32_t bits)
+{
+    eth_regs.DMASR &= ~bits;
+}
+
+void eth_rx_poll()
+{
+    rx_suspended = false;
+}
+
+void eth_tx_poll()
+{
+    tx_suspended = false;
+}
+
+static void mac_status(uint32_t bits)
+{
+    if ((eth_regs.DMASR & (ETH_DMASR_RS | ETH_DMASR_TS)) == 0)
+        irq_at = now + IRQ_NS;
+    eth_regs.DMASR |= bits | ETH_DMASR_NIS;
+}
+
+static void mac_rx_dma()
+{
+    ETH_DESCRIPTORS* des;
+    unsigned int len;
+    if (!fifo_count || rx_suspended || !(eth_regs.DMAOMR & ETH_DMAOMR_SR))
+        return;
+    des = (ETH_DESCRIPTORS*)(uintptr_t)eth_regs.DMACHRDR;
+    if ((des->ctl & ETH_RDES_OWN) == 0)
+    {
+        //receive buffer unavailable: suspended until poll demand
+        rx_suspended = true;
+        return;
+    }
+    len = fifo_len[fifo_head];
+    memcpy(des->buf1, &fifo_seq[fifo_head], sizeof(unsigned int));
+    fifo_head = (fifo_head + 1) % FIFO_FRAMES;
+    --fifo_count;
+    fifo_bytes -= len;
+    des->ctl = ETH_RDES_FS | ETH_RDES_LS | (len << ETH_RDES_FL_POS);
+    eth_regs.DMACHRDR = (uint32_t)(uintptr_t)des->buf2_ndes;
+    mac_status(ETH_DMASR_RS);
+}
+
+static void mac_tx_dma()
+{
+    ETH_DESCRIPTORS* des;
+    unsigned int seq;
+    if (tx_active != NULL)
+    {
+        if (now < tx_wire_busy_until)
+            return;
+        des = tx_active;
+        tx_active = NULL;
+        des->ctl &= ~ETH_TDES_OWN;
+        //ring mode
+        if (des->ctl & ETH_TDES_TER)
+            eth_regs.DMACHTDR = eth_regs.DMATDLAR;
+        else
+            eth_regs.DMACHTDR += sizeof(ETH_DESCRIPTORS);
+        mac_status(ETH_DMASR_TS);
+    }
+    if (tx_suspended || !(eth_regs.DMAOMR & ETH_DMAOMR_ST))
+        return;
+    des = (ETH_DESCRIPTORS*)(uintptr_t)eth_regs.DMACHTDR;
+    if ((des->ctl & ETH_TDES_OWN) == 0)
+    {
+        tx_suspended = true;
+        return;
+    }
+    memcpy(&seq, des->buf1, sizeof(unsigned int));
+    if (seq != wire_tx_seq++)
+        ++st_tx_order;
+    tx_active = des;
+    tx_wire_busy_until = now + ((des->size & ETH_TDES_TBS1_MASK) + WIRE_OVERHEAD) * NS_PER_BYTE;
+}
+
+static void wire_rx()
+{
+    int i;
+    if (!RX_LEN || now < next_arrival)
+        return;
+    ++st_rx_wire;
+    if ((fifo_count < FIFO_FRAMES) && (fifo_bytes + RX_LEN <= FIFO_SIZE))
+    {
+        i = (fifo_head + fifo_count) % FIFO_FRAMES;
+        fifo_len[i] = RX_LEN;
+        fifo_seq[i] = rx_seq;
+        fifo_bytes += RX_LEN;
+        ++fifo_count;
+    }
+    else
+        ++st_rx_fifo_drop;
+    ++rx_seq;
+    next_arrival += (RX_LEN + WIRE_OVERHEAD) * NS_PER_BYTE;
+    if (BURST && --burst_left == 0)
+    {
+        burst_left = BURST;
+        burst_start += BURST_PERIOD_US * 1000ull;
+        next_arrival = burst_start;
+    }
+}
+
+//stack: tcpips post/complete logic
+static unsigned int rx_count, tx_count, expect_seq, tx_seq;
+static IO* tx_queue[POOL];
+static int tx_queue_head, tx_queue_count;
+static unsigned long long stack_busy_until;
+
+static void stack_rx_fill()
+{
+    IO* io;
+    while (rx_count < ETH_RX_RING_SIZE)
+    {
+        if ((io = io_alloc()) == NULL)
+            return;
+        ++rx_count;
+        queue_push(1, IPC_READ, io, FRAME_MAX);
+    }
+}
+
+static void stack_tx(IO* io)
+{
+    if (++tx_count > ETH_TX_RING_SIZE)
+        tx_queue[(tx_queue_head + tx_queue_count++) % POOL] = io;
+    else
+        queue_push(1, IPC_WRITE, io, 0);
+}
+
+static void stack_msg(MSG* m)
+{
+    unsigned int seq;
+    if (m->cmd == IPC_READ)
+    {
+        --rx_count;
+        stack_rx_fill();
+        if (m->param3 < 0)
+        {
+            ++st_rx_bad;
+            io_free(m->io);
+            return;
+        }
+        memcpy(&seq, io_data(m->io), sizeof(unsigned int));
+        if (seq != expect_seq)
+            st_rx_gap += seq - expect_seq;
+        expect_seq = seq + 1;
+        ++st_rx_done;
+        io_free(m->io);
+        stack_busy_until = now + RX_US * 1000ull;
+        if (STALL_EVERY && (st_rx_done % STALL_EVERY) == 0)
+            stack_busy_until += STALL_US * 1000ull;
+    }
+    else
+    {
+        ++st_tx_done;
+        io_free(m->io);
+        if (--tx_count >= ETH_TX_RING_SIZE)
+        {
+            queue_push(1, IPC_WRITE, tx_queue[tx_queue_head], 0);
+            tx_queue_head = (tx_queue_head + 1) % POOL;
+            --tx_queue_count;
+        }
+        stack_busy_until = now + TX_DONE_US * 1000ull;
+    }
+}
+
+static void stack_gen()
+{
+    IO* io;
+    if (!TX_LEN || tx_queue_count >= TX_QUEUE_MAX || now < stack_busy_until)
+        return;
+    if ((io = io_alloc()) == NULL)
+        return;
+    memcpy(io_data(io), &tx_seq, sizeof(unsigned int));
+    ++tx_seq;
+    io->data_size = TX_LEN;
+    stack_tx(io);
+    stack_busy_until = now + TX_US * 1000ull;
+}
+
+//driver runs in kernel context
+static void drv_msg(MSG* m)
+{
+    IPC ipc;
+    ipc.cmd = m->cmd;
+    ipc.param1 = 0;
+    ipc.param2 = (unsigned int)(uintptr_t)m->io;
+    ipc.param3 = m->param3;
+    ipc.process = 1;
+    last_error = ERROR_OK;
+    stm32_eth_request(&exo, &ipc);
+    if (last_error != ERROR_SYNC)
+        iio_complete_ex(1, m->cmd, 0, m->io, last_error);
+}
+
+int main()
+{
+    int i;
+    MSG* m;
+    double sec = SIM_NS / 1e9;
+    for (i = 0; i < POOL; ++i)
+        io_free(&bufs[i].io);
+    stm32_eth_init(&exo);
+    stm32_eth_open(&exo, 0, ETH_AUTO, 1);
+    //DMA start: current descriptors are base
+    eth_regs.DMACHRDR = eth_regs.DMARDLAR;
+    eth_regs.DMACHTDR = eth_regs.DMATDLAR;
+    stack_rx_fill();
+    burst_left = BURST;
+    next_arrival = burst_start = 10000;
+    for (now = 0; now < SIM_NS; now += STEP_NS)
+    {
+        wire_rx();
+        mac_rx_dma();
+        mac_tx_dma();
+        if ((eth_regs.DMASR & (ETH_DMASR_RS | ETH_DMASR_TS)) && now >= irq_at)
+        {
+            ++st_irq;
+            stm32_eth_isr(ETH_IRQn, &exo);
+        }
+        //IPC to driver is handled on arrival
+        while ((m = queue_pop(1)) != NULL)
+            drv_msg(m);
+        if (now >= stack_busy_until && (m = queue_pop(0)) != NULL)
+            stack_msg(m);
+        else
+            stack_gen();
+    }
+    printf("ring %2d/%2d: rx %7.0f fps, wire %7.0f fps, drops %6llu (gap %6llu, bad %llu), tx %7.0f fps, tx order err %llu, frames/irq %.2f\n",
+           ETH_RX_RING_SIZE, ETH_TX_RING_SIZE, st_rx_done / sec, st_rx_wire / sec, st_rx_fifo_drop, st_rx_gap, st_rx_bad, st_tx_done / sec, st_tx_order,
+           st_irq ? (double)(st_rx_done + st_tx_done) / st_irq : 0.0);
+    return 0;
+}
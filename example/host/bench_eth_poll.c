@@ -0,0 +1,330 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+/*
+    bench_eth_poll.c - rx flood model of STM32 ETH with shared CPU: ISR, kernel driver requests and stack
+    process compete for single core, rest is left to application. Interrupt or polled (ETH_RX_POLLING) rx
+    handoff of real driver source on emulated registers. Not POSIX core based.
+
+    Options (DEFINES):
+    ETH_RX_RING_SIZE, ETH_RX_POLL_THRESHOLD
+    ETH_RX_POLLING  0: one IPC per frame, 1: polled batched handoff
+    RX_LEN          rx frame size
+    GAP_NS          extra gap between frames, 0 - line rate
+    RX_NS           stack time per rx frame
+
+    Scenarios:
+    64B line rate   -DRX_LEN=64
+    64B light load  -DRX_LEN=64 -DGAP_NS=60000
+    1518B           -DRX_LEN=1518 -DRX_NS=20000
+ */
+
+#ifndef ETH_RX_POLLING
+#define ETH_RX_POLLING                  1
+#endif //ETH_RX_POLLING
+
+#include "stm32_eth_model.c"
+#include <stdio.h>
+
+#ifndef RX_LEN
+#define RX_LEN                          64
+#endif //RX_LEN
+#ifndef GAP_NS
+#define GAP_NS                          0
+#endif //GAP_NS
+#ifndef RX_NS
+#define RX_NS                           3000
+#endif //RX_NS
+
+#define STEP_NS                         20
+#define SIM_NS                          1000000000ull
+#define IPC_NS                          1000
+#define IRQ_NS                          500
+//CPU time of ISR, IPC dispatch to stack and driver call
+#define ISR_NS                          2000
+#define IPC_CPU_NS                      5000
+#define DRV_NS                          1000
+//100Mbit
+#define NS_PER_BYTE                     80
+//preamble, SFD, IFG
+#define WIRE_OVERHEAD                   20
+#define FIFO_SIZE                       2048
+#define FIFO_FRAMES                     64
+#define POOL                            64
+#define FRAME_MAX                       1536
+#define QUEUE_SIZE                      4096
+#define SEQ_MASK                        0xffff
+
+ETH_TypeDef eth_regs;
+RCC_TypeDef rcc_regs;
+int last_error;
+static EXO exo;
+static unsigned long long now, cpu_free_at;
+
+//IO pool
+typedef struct {
+    IO io;
+    uint8_t data[FRAME_MAX];
+} BUF;
+
+static BUF bufs[POOL];
+static IO* free_list[POOL];
+static int free_count;
+
+static IO* io_alloc()
+{
+    IO* io;
+    if (!free_count)
+        return NULL;
+    io = free_list[--free_count];
+    io->next = NULL;
+    io->data_offset = 0;
+    io->data_size = 0;
+    return io;
+}
+
+static void io_free(IO* io)
+{
+    free_list[free_count++] = io;
+}
+
+//IPC queues: 0 - to stack, 1 - to driver
+typedef struct {
+    unsigned long long at;
+    unsigned int cmd;
+    IO* io;
+    int param3;
+} MSG;
+
+static MSG queue[2][QUEUE_SIZE];
+static int queue_head[2], queue_tail[2];
+static unsigned long long st_ipc;
+
+static void queue_push(int to_drv, unsigned int cmd, IO* io, int param3)
+{
+    MSG* m = &queue[to_drv][queue_tail[to_drv]];
+    queue_tail[to_drv] = (queue_tail[to_drv] + 1) % QUEUE_SIZE;
+    m->at = now + IPC_NS;
+    m->cmd = cmd;
+    m->io = io;
+    m->param3 = param3;
+}
+
+static MSG* queue_pop(int to_drv)
+{
+    MSG* m;
+    if (queue_head[to_drv] == queue_tail[to_drv] || queue[to_drv][queue_head[to_drv]].at > now)
+        return NULL;
+    m = &queue[to_drv][queue_head[to_drv]];
+    queue_head[to_drv] = (queue_head[to_drv] + 1) % QUEUE_SIZE;
+    return m;
+}
+
+void iio_complete_ex(HANDLE process, unsigned int cmd, unsigned int handle, IO* io, int param3)
+{
+    ++st_ipc;
+    queue_push(0, cmd, io, param3);
+}
+
+//MAC/DMA
+static unsigned int fifo_len[FIFO_FRAMES], fifo_seq[FIFO_FRAMES];
+static int fifo_head, fifo_count, fifo_bytes;
+static bool rx_suspended;
+static unsigned long long irq_at, next_arrival;
+static unsigned long long arrival[SEQ_MASK + 1];
+static unsigned int rx_seq;
+static unsigned long long st_rx_wire, st_rx_fifo_drop, st_irq, st_rx_done, st_rx_gap, st_app_ns, st_max_latency;
+
+void eth_dmasr_clear(uint32_t bits)
+{
+    eth_regs.DMASR &= ~bits;
+}
+
+void eth_rx_poll()
+{
+    rx_suspended = false;
+}
+
+void eth_tx_poll()
+{
+}
+
+static bool irq_pending()
+{
+    return ((eth_regs.DMASR & ETH_DMASR_RS) && (eth_regs.DMAIER & ETH_DMAIER_RIE)) ||
+           ((eth_regs.DMASR & ETH_DMASR_TS) && (eth_regs.DMAIER & ETH_DMAIER_TIE));
+}
+
+static void mac_rx_dma()
+{
+    ETH_DESCRIPTORS* des;
+    unsigned int len;
+    if (!fifo_count || rx_suspended)
+        return;
+    des = (ETH_DESCRIPTORS*)(uintptr_t)eth_regs.DMACHRDR;
+    if ((des->ctl & ETH_RDES_OWN) == 0)
+    {
+        //receive buffer unavailable: suspended until poll demand
+        rx_suspended = true;
+        return;
+    }
+    len = fifo_len[fifo_head];
+    memcpy(des->buf1, &fifo_seq[fifo_head], sizeof(unsigned int));
+    fifo_head = (fifo_head + 1) % FIFO_FRAMES;
+    --fifo_count;
+    fifo_bytes -= len;
+    des->ctl = ETH_RDES_FS | ETH_RDES_LS | (len << ETH_RDES_FL_POS);
+    eth_regs.DMACHRDR = (uint32_t)(uintptr_t)des->buf2_ndes;
+    if (!irq_pending())
+        irq_at = now + IRQ_NS;
+    eth_regs.DMASR |= ETH_DMASR_RS | ETH_DMASR_NIS;
+}
+
+static void wire_rx()
+{
+    int i;
+    if (now < next_arrival)
+        return;
+    ++st_rx_wire;
+    if ((fifo_count < FIFO_FRAMES) && (fifo_bytes + RX_LEN <= FIFO_SIZE))
+    {
+        i = (fifo_head + fifo_count) % FIFO_FRAMES;
+        fifo_len[i] = RX_LEN;
+        fifo_seq[i] = rx_seq;
+        arrival[rx_seq & SEQ_MASK] = now;
+        fifo_bytes += RX_LEN;
+        ++fifo_count;
+    }
+    else
+        ++st_rx_fifo_drop;
+    ++rx_seq;
+    next_arrival += (RX_LEN + WIRE_OVERHEAD) * NS_PER_BYTE + GAP_NS;
+}
+
+//stack: tcpips post/complete logic
+static unsigned int rx_count, expect_seq;
+
+static void stack_rx_fill()
+{
+    IO* io;
+    while (rx_count < ETH_RX_RING_SIZE)
+    {
+        if ((io = io_alloc()) == NULL)
+            return;
+        ++rx_count;
+        queue_push(1, IPC_READ, io, FRAME_MAX);
+    }
+}
+
+static void stack_frame(IO* io)
+{
+    unsigned int seq;
+    memcpy(&seq, io_data(io), sizeof(unsigned int));
+    if (seq != expect_seq)
+        st_rx_gap += seq - expect_seq;
+    expect_seq = seq + 1;
+    if (now - arrival[seq & SEQ_MASK] > st_max_latency)
+        st_max_latency = now - arrival[seq & SEQ_MASK];
+    ++st_rx_done;
+    io_free(io);
+    cpu_free_at += RX_NS;
+}
+
+static void stack_msg(MSG* m)
+{
+    IO* io;
+    IO* next;
+    cpu_free_at = now + IPC_CPU_NS;
+    if (m->cmd == IPC_READ)
+    {
+        --rx_count;
+        stack_rx_fill();
+        if (m->param3 < 0)
+        {
+            io_free(m->io);
+            return;
+        }
+        stack_frame(m->io);
+    }
+    else if (m->cmd == ETH_POLL)
+    {
+        for (io = m->io; io != NULL; io = io->next)
+            --rx_count;
+        stack_rx_fill();
+        for (io = m->io; io != NULL; io = next)
+        {
+            next = io->next;
+            io->next = NULL;
+            stack_frame(io);
+        }
+        if (m->param3 & ETH_RX_POLL)
+            queue_push(1, ETH_POLL, NULL, ETH_RX_RING_SIZE);
+    }
+}
+
+//driver runs in kernel context
+static void drv_msg(MSG* m)
+{
+    IPC ipc;
+    ipc.cmd = m->cmd;
+    ipc.param1 = 0;
+    ipc.param2 = m->cmd == ETH_POLL ? (unsigned int)m->param3 : (unsigned int)(uintptr_t)m->io;
+    ipc.param3 = m->param3;
+    ipc.process = 1;
+    last_error = ERROR_OK;
+    stm32_eth_request(&exo, &ipc);
+    if (last_error != ERROR_SYNC && m->cmd != ETH_POLL)
+        iio_complete_ex(1, m->cmd, 0, m->io, last_error);
+    cpu_free_at = (cpu_free_at > now ? cpu_free_at : now) + DRV_NS;
+}
+
+int main()
+{
+    int i;
+    MSG* m;
+    double sec = SIM_NS / 1e9;
+    for (i = 0; i < POOL; ++i)
+        io_free(&bufs[i].io);
+    stm32_eth_init(&exo);
+    stm32_eth_open(&exo, 0, ETH_AUTO, 1);
+    //DMA start: current descriptors are base
+    eth_regs.DMACHRDR = eth_regs.DMARDLAR;
+    eth_regs.DMACHTDR = eth_regs.DMATDLAR;
+    stack_rx_fill();
+    next_arrival = 10000;
+    for (now = 0; now < SIM_NS; now += STEP_NS)
+    {
+        wire_rx();
+        mac_rx_dma();
+        //IRQ preempts everything
+        if (irq_pending() && now >= irq_at)
+        {
+            ++st_irq;
+            stm32_eth_isr(ETH_IRQn, &exo);
+            cpu_free_at = (cpu_free_at > now ? cpu_free_at : now) + ISR_NS;
+            continue;
+        }
+        if (now < cpu_free_at)
+            continue;
+        //kernel: driver requests first
+        if ((m = queue_pop(1)) != NULL)
+        {
+            drv_msg(m);
+            continue;
+        }
+        if ((m = queue_pop(0)) != NULL)
+        {
+            stack_msg(m);
+            continue;
+        }
+        //no work for kernel and stack: application runs
+        st_app_ns += STEP_NS;
+    }
+    printf("%s ring %2d: wire %6.0f fps, rx %6.0f fps, drops %6llu (gap %6llu), irq %6.0f/s, ipc %6.0f/s, app cpu %4.1f%%, max latency %5.0f us\n",
+           ETH_RX_POLLING ? "poll" : "irq ", ETH_RX_RING_SIZE, st_rx_wire / sec, st_rx_done / sec, st_rx_fifo_drop, st_rx_gap, st_irq / sec, st_ipc / sec,
+           100.0 * st_app_ns / SIM_NS, st_max_latency / 1000.0);
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+/*
+    bench_ipc.c - IPC cost. Measured by host time.
+
+    ack() round trip to other process, while unrelated IPCs are queued on caller: 0, 1, 3 ... 31 with
+    KERNEL_IPC_COUNT 64 of Makefile. Caller is waiting for specific sender and cmd, queued IPCs are skipped.
+
+    Burst of IPCs to higher priority process, draining with ipc_read_batch(): ipc_post() for every IPC against
+    single ipc_post_batch().
+ */
+
+#include "host.h"
+#include "../../userspace/process.h"
+#include "../../userspace/ipc.h"
+#include "kernel_config.h"
+
+#define ROUNDS                          200000
+#define BURST                           6
+#define BURST_ROUNDS                    50000
+
+void app();
+void echo();
+void sink();
+
+const REX __APP = {"App main", 4096, 200, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, app};
+const REX __ECHO = {"echo", 2048, 100, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, echo};
+const REX __SINK = {"sink", 2048, 100, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, sink};
+
+static volatile unsigned int got;
+
+void echo()
+{
+    IPC ipc;
+    for (;;)
+    {
+        ipc_read(&ipc);
+        ipc_write(&ipc);
+    }
+}
+
+void sink()
+{
+    IPC ipc[BURST];
+    for (;;)
+        got += ipc_read_batch(ipc, BURST);
+}
+
+static void bench_ack()
+{
+    int i, backlog;
+    unsigned long long t;
+    HANDLE e = process_create(&__ECHO);
+    for (backlog = 0; backlog < KERNEL_IPC_COUNT - 1; backlog = backlog * 2 + 1)
+    {
+        //unrelated IPCs to self, never read
+        while (rb_size(&__GLOBAL->process->ipcs) < backlog)
+            ipc_post_inline(process_get_current(), HAL_CMD(HAL_APP, 0x20), 0, 0, 0);
+        t = kposix_time_us();
+        for (i = 0; i < ROUNDS; ++i)
+            ack(e, HAL_REQ(HAL_APP, IPC_PING + 0x10), i, 0, 0);
+        printd("ack with %d queued: %d ns\n", backlog, (int)((kposix_time_us() - t) * 1000 / ROUNDS));
+    }
+}
+
+static void bench_burst()
+{
+    int i, j;
+    unsigned long long t;
+    IPC ipcs[BURST];
+    HANDLE s = process_create(&__SINK);
+    for (j = 0; j < BURST; ++j)
+    {
+        ipcs[j].process = s;
+        ipcs[j].cmd = HAL_CMD(HAL_APP, 0x20);
+        ipcs[j].param1 = j;
+    }
+    got = 0;
+    t = kposix_time_us();
+    for (i = 0; i < BURST_ROUNDS; ++i)
+        for (j = 0; j < BURST; ++j)
+            ipc_post(&ipcs[j]);
+    printd("burst of %d, ipc_post: %d ns, received %d\n", BURST, (int)((kposix_time_us() - t) * 1000 / BURST_ROUNDS), got);
+    got = 0;
+    t = kposix_time_us();
+    for (i = 0; i < BURST_ROUNDS; ++i)
+        ipc_post_batch(ipcs, BURST);
+    printd("burst of %d, ipc_post_batch: %d ns, received %d\n", BURST, (int)((kposix_time_us() - t) * 1000 / BURST_ROUNDS), got);
+}
+
+void app()
+{
+    bench_ack();
+    bench_burst();
+    _exit(0);
+}
@@ -0,0 +1,104 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+/*
+    bench_kmalloc.c - kernel heap cost and longest interrupts disabled time. Measured by host time.
+
+    Kernel heap is fragmented by SLOTS live slots of 80-480 bytes, half of them freed. Then random kmalloc/kfree of
+    small (8-64 bytes) and large (500-1100 bytes) slots, called from IRQ handler. Interrupts disabled time is taken
+    by POSIX_IRQ_PROFILING of Makefile: longest interval of every window, sorted over all windows.
+
+    Options (DEFINES):
+    SLOTS           fragmenting slots
+ */
+
+#include "host.h"
+#include "../../userspace/process.h"
+#include "../../userspace/irq.h"
+#include "../../kernel/kstdlib.h"
+
+#ifndef SLOTS
+#define SLOTS                           600
+#endif //SLOTS
+
+#define ROUNDS                          200000
+#define WINDOWS                         2000
+
+void app();
+
+const REX __APP = {"App main", 4096, 200, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, app};
+
+static void* slots[SLOTS];
+static unsigned int windows[WINDOWS];
+static unsigned int seed = 7;
+
+static unsigned int bench_rand()
+{
+    seed = seed * 1103515245 + 12345;
+    return seed;
+}
+
+//free or allocate random even slot. Returns false if allocation failed
+static bool bench_op()
+{
+    unsigned int r = bench_rand();
+    unsigned int i = ((r >> 8) % (SLOTS / 2)) * 2;
+    if (slots[i])
+    {
+        kfree(slots[i]);
+        slots[i] = NULL;
+        return true;
+    }
+    slots[i] = kmalloc(((r >> 20) & 3) ? 8 + ((r >> 4) & 7) * 8 : 500 + ((r >> 12) % 600));
+    return slots[i] != NULL;
+}
+
+static void bench(int vector, void* param)
+{
+    int i, j, fails;
+    unsigned int tmp;
+    unsigned long long t;
+    for (i = 0; i < SLOTS; ++i)
+        slots[i] = kmalloc(80 + (bench_rand() >> 16) % 400);
+    for (i = 0; i < SLOTS; i += 2)
+    {
+        kfree(slots[i]);
+        slots[i] = NULL;
+    }
+    kposix_irq_disabled_max_ns();
+    fails = 0;
+    t = kposix_time_us();
+    for (i = 0; i < ROUNDS; ++i)
+        if (!bench_op())
+            ++fails;
+    printd("kmalloc/kfree with %d slots: %d ns per op, failed %d\n", SLOTS, (int)((kposix_time_us() - t) * 1000 / ROUNDS), fails);
+    kposix_irq_disabled_max_ns();
+    for (j = 0; j < WINDOWS; ++j)
+    {
+        for (i = 0; i < ROUNDS / WINDOWS; ++i)
+            bench_op();
+        windows[j] = kposix_irq_disabled_max_ns();
+    }
+    for (i = 0; i < WINDOWS; ++i)
+        for (j = i + 1; j < WINDOWS; ++j)
+            if (windows[j] < windows[i])
+            {
+                tmp = windows[i];
+                windows[i] = windows[j];
+                windows[j] = tmp;
+            }
+    printd("longest interrupts disabled per window: median %d ns, p90 %d ns, p99 %d ns, max %d ns\n",
+           windows[WINDOWS / 2], windows[WINDOWS * 9 / 10], windows[WINDOWS * 99 / 100], windows[WINDOWS - 1]);
+    _exit(0);
+}
+
+void app()
+{
+    irq_register(1, bench, NULL);
+    kposix_irq_pend(1);
+    for (;;)
+        sleep_ms(1000);
+}
@@ -0,0 +1,70 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+/*
+    bench_sched.c - scheduler cost with many ready processes. Measured by host time.
+
+    Options (DEFINES):
+    SPINNERS        ready processes of different priority, always switching
+
+    Second run adds SPINNERS ready processes with same priority, as woken process.
+ */
+
+#include "host.h"
+#include "../../userspace/process.h"
+#include "../../userspace/svc.h"
+
+#ifndef SPINNERS
+#define SPINNERS                        48
+#endif //SPINNERS
+
+#define ROUNDS                          200000
+
+void app();
+void spin();
+
+const REX __APP = {"App main", 4096, 10, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, app};
+
+void spin()
+{
+    for (;;)
+        process_switch_test();
+}
+
+void app()
+{
+    int i;
+    unsigned long long t;
+    HANDLE sink;
+    REX rex = {"spin", 1024, 0, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, spin};
+    for (i = 0; i < SPINNERS; ++i)
+    {
+        rex.priority = 100 + i * 3;
+        process_create(&rex);
+    }
+    //lowest priority, never running
+    rex.priority = 250;
+    rex.flags = REX_FLAG_PERSISTENT_NAME;
+    sink = process_create(&rex);
+    t = kposix_time_us();
+    for (i = 0; i < ROUNDS; ++i)
+    {
+        process_unfreeze(sink);
+        process_freeze(sink);
+    }
+    printd("wakeup lowest of %d ready: %d ns per freeze/unfreeze\n", SPINNERS, (int)((kposix_time_us() - t) * 1000 / ROUNDS));
+    rex.flags = PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME;
+    for (i = 0; i < SPINNERS; ++i)
+        process_create(&rex);
+    t = kposix_time_us();
+    for (i = 0; i < ROUNDS; ++i)
+    {
+        process_unfreeze(sink);
+        process_freeze(sink);
+    }
+    printd("wakeup after %d ready of same priority: %d ns per freeze/unfreeze\n", SPINNERS, (int)((kposix_time_us() - t) * 1000 / ROUNDS));
+    _exit(0);
+}
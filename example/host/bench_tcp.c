@@ -0,0 +1,579 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+/*
+    bench_tcp.c - bulk TCP transfer between two stacks, connected by emulated 100Mbit wire.
+
+    Options (DEFINES):
+    LATENCY_US      one-way wire latency
+    LOSS_PPM        uniform random loss of any frame, parts per million
+    OFFLOAD         emulated MAC checksum offload
+    ZC              receiver uses zero-copy tcp_read_frame. Checks data and return of every frame with tcp_release_frame
+    ZC_STALL_MS     zero-copy receiver sleeps every 200 frames
+    ZC_BOGUS        receiver returns frames, never given by stack. Must be rejected
+    RX_SLEEP_MS     copy receiver sleeps before every read
+    CHAIN           user writes 2-segment IO chains
+    CLOSE           both sides close after transfer
+    PING            ICMP echo from receiver during transfer
+    RING_REPORT     frames reported by driver in ETH_GET_RING_SIZE, 0 - not supported
+    RING_ACCEPT     frames really accepted by driver per direction, rest is rejected like USB RNDIS does
+    SEED            loss generator seed
+
+    Scenarios:
+    sliding window  -DLATENCY_US=100, 1000, 5000: throughput with window of many segments
+    sender SWS      -DZC=1: data frames (frames - ACK frames) of zero-copy receiver with small window, 2897 is minimum
+ */
+
+#include "host.h"
+#include "../../userspace/process.h"
+#include "../../userspace/ipc.h"
+#include "../../userspace/io.h"
+#include "../../userspace/error.h"
+#include "../../userspace/systime.h"
+#include "../../userspace/eth.h"
+#include "../../userspace/tcpip.h"
+#include "../../userspace/tcp.h"
+#include "../../userspace/ip.h"
+#include "../../userspace/icmp.h"
+#include "sys_config.h"
+#include <string.h>
+
+#ifndef LATENCY_US
+#define LATENCY_US                      1000
+#endif //LATENCY_US
+#ifndef LOSS_PPM
+#define LOSS_PPM                        0
+#endif //LOSS_PPM
+#ifndef OFFLOAD
+#define OFFLOAD                         0
+#endif //OFFLOAD
+#ifndef ZC
+#define ZC                              0
+#endif //ZC
+#ifndef ZC_STALL_MS
+#define ZC_STALL_MS                     0
+#endif //ZC_STALL_MS
+#ifndef ZC_BOGUS
+#define ZC_BOGUS                        0
+#endif //ZC_BOGUS
+#ifndef RX_SLEEP_MS
+#define RX_SLEEP_MS                     0
+#endif //RX_SLEEP_MS
+#ifndef CHAIN
+#define CHAIN                           0
+#endif //CHAIN
+#ifndef CLOSE
+#define CLOSE                           0
+#endif //CLOSE
+#ifndef PING
+#define PING                            0
+#endif //PING
+#ifndef RING_REPORT
+#define RING_REPORT                     0
+#endif //RING_REPORT
+#ifndef RING_ACCEPT
+#define RING_ACCEPT                     4
+#endif //RING_ACCEPT
+#ifndef SEED
+#define SEED                            12345
+#endif //SEED
+
+#define TOTAL                           (4 * 1024 * 1024)
+#define WRITE_SIZE                      16384
+#define READ_SIZE                       32768
+#define WRITE_DEPTH                     4
+//100Mbit
+#define NS_PER_BYTE                     80
+//preamble, SFD, FCS, IFG
+#define WIRE_OVERHEAD                   24
+#define EVENTS                          64
+#define RX_RING_MAX                     8
+
+void app();
+void wire();
+void rx_app();
+void pinger();
+
+const REX __APP = {"App main", 16384, 200, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, app};
+const REX __WIRE = {"wire", 4096, 50, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, wire, 40};
+const REX __PING = {"pinger", 16384, 200, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, pinger};
+const REX __RX = {"rx app", 4096, 200, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, rx_app};
+
+//frame on wire: tx completion on sender side or rx on other side
+typedef struct {
+    bool used, rx;
+    int side;
+    unsigned long long time;
+    IO* io;
+    unsigned int size;
+    uint8_t data[TCPIP_MTU + 100];
+} EVENT;
+
+static EVENT events[EVENTS];
+static HANDLE tcpip[2];
+static IO* rx_io[2][RX_RING_MAX];
+static int rx_count[2], tx_inflight[2];
+static unsigned long long tx_free[2];
+static unsigned int frames, drops, lost, tx_rejects, rx_rejects;
+static HANDLE wire_timer;
+static unsigned int seed = SEED;
+
+static volatile unsigned int received, corrupted, zc_frames;
+static volatile unsigned long long rx_done, rx_tsc;
+static unsigned int pings, ping_lost, ping_sum, ping_max;
+
+static unsigned int wire_rand()
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % 1000000;
+}
+
+static void wire_schedule()
+{
+    int i;
+    unsigned long long next = ~0ull, now = kposix_time_us();
+    for (i = 0; i < EVENTS; ++i)
+        if (events[i].used && events[i].time < next)
+            next = events[i].time;
+    timer_stop(wire_timer, 0, HAL_APP);
+    if (next != ~0ull)
+        timer_start_us(wire_timer, next > now ? (unsigned int)(next - now) : 1);
+}
+
+static void wire_run()
+{
+    int i, j;
+    unsigned long long now = kposix_time_us();
+    IO* io;
+    EVENT* ev;
+    for (;;)
+    {
+        j = -1;
+        for (i = 0; i < EVENTS; ++i)
+            if (events[i].used && events[i].time <= now && (j < 0 || events[i].time < events[j].time))
+                j = i;
+        if (j < 0)
+            break;
+        ev = &events[j];
+        ev->used = false;
+        if (ev->rx)
+        {
+            //no read posted by stack
+            if (rx_count[ev->side] == 0)
+            {
+                ++drops;
+                continue;
+            }
+            io = rx_io[ev->side][0];
+            memmove(&rx_io[ev->side][0], &rx_io[ev->side][1], sizeof(IO*) * (RX_RING_MAX - 1));
+            --rx_count[ev->side];
+            memcpy(io_data(io), ev->data, ev->size);
+            io->data_size = ev->size;
+            io_complete_ex(tcpip[ev->side], HAL_IO_CMD(HAL_ETH, IPC_READ), ev->side, io, io->data_size | (OFFLOAD ? ETH_RX_CHECKSUM_OK : 0));
+        }
+        else
+        {
+            --tx_inflight[ev->side];
+            io_complete(tcpip[ev->side], HAL_IO_CMD(HAL_ETH, IPC_WRITE), ev->side, ev->io);
+        }
+    }
+    wire_schedule();
+}
+
+//MAC: insert checksums on tx
+static void wire_offload(uint8_t* frame, unsigned int size)
+{
+    uint8_t* ip = frame + 14;
+    unsigned int hdr, total;
+    IP src, dst;
+    if (frame[12] != 0x08 || frame[13] != 0x00)
+        return;
+    hdr = (ip[0] & 0xf) << 2;
+    if (ip[10] | ip[11])
+        printd("wire: IP checksum is not zero\n");
+    total = ip_checksum(ip, hdr);
+    ip[10] = total >> 8;
+    ip[11] = total & 0xff;
+    total = (ip[2] << 8) | ip[3];
+    memcpy(&src, ip + 12, 4);
+    memcpy(&dst, ip + 16, 4);
+    if (ip[9] == PROTO_TCP)
+    {
+        if (ip[hdr + 16] | ip[hdr + 17])
+            printd("wire: TCP checksum is not zero\n");
+        total = tcp_checksum(ip + hdr, total - hdr, &src, &dst);
+        ip[hdr + 16] = total >> 8;
+        ip[hdr + 17] = total & 0xff;
+    }
+}
+
+static EVENT* wire_event()
+{
+    int i;
+    for (i = 0; i < EVENTS; ++i)
+        if (!events[i].used)
+        {
+            events[i].used = true;
+            return &events[i];
+        }
+    printd("wire: out of events\n");
+    _exit(1);
+    return NULL;
+}
+
+static void wire_tx(int side, IO* io)
+{
+    EVENT* tx;
+    EVENT* rx;
+    IO* cur;
+    unsigned long long now = kposix_time_us();
+    unsigned int size = 0;
+    for (cur = io; cur != NULL; cur = cur->next)
+        size += cur->data_size;
+    //serialization on sender side
+    if (tx_free[side] < now)
+        tx_free[side] = now;
+    tx_free[side] += (size + WIRE_OVERHEAD) * NS_PER_BYTE / 1000 + 1;
+    tx = wire_event();
+    tx->rx = false;
+    tx->side = side;
+    tx->io = io;
+    tx->time = tx_free[side];
+    ++frames;
+    if (LOSS_PPM && wire_rand() < LOSS_PPM)
+        ++lost;
+    else
+    {
+        rx = wire_event();
+        rx->rx = true;
+        rx->side = side ^ 1;
+        rx->time = tx_free[side] + LATENCY_US;
+        rx->size = 0;
+        for (cur = io; cur != NULL; cur = cur->next)
+        {
+            memcpy(rx->data + rx->size, io_data(cur), cur->data_size);
+            rx->size += cur->data_size;
+        }
+        if (OFFLOAD)
+            wire_offload(rx->data, rx->size);
+    }
+    wire_schedule();
+}
+
+//emulated MAC driver of both stacks. Side is in param1
+void wire()
+{
+    IPC ipc;
+    IO* io;
+    IO* next;
+    int side;
+    wire_timer = timer_create(0, HAL_APP);
+    for (;;)
+    {
+        ipc_read(&ipc);
+        error(ERROR_OK);
+        if (HAL_GROUP(ipc.cmd) == HAL_APP)
+        {
+            wire_run();
+            continue;
+        }
+        side = ipc.param1;
+        switch (HAL_ITEM(ipc.cmd))
+        {
+        case IPC_OPEN:
+            tcpip[side] = ipc.process;
+            ipc_post_inline(ipc.process, HAL_CMD(HAL_ETH, ETH_NOTIFY_LINK_CHANGED), side, ETH_100_FULL, 0);
+            break;
+        case ETH_GET_HEADER_SIZE:
+            ipc.param2 = 0;
+            ipc.param3 = 0;
+            break;
+        case ETH_GET_FEATURES:
+            ipc.param2 = OFFLOAD ? ETH_FEATURE_TX_CHECKSUM | ETH_FEATURE_RX_CHECKSUM : 0;
+            break;
+        case ETH_GET_MAC:
+            ipc.param2 = 0x11223300 | side;
+            ipc.param3 = 0x4455;
+            break;
+        case ETH_GET_RING_SIZE:
+            if (!RING_REPORT)
+            {
+                error(ERROR_NOT_SUPPORTED);
+                break;
+            }
+            ipc.param2 = ipc.param3 = RING_REPORT;
+            break;
+        case IPC_READ:
+            //chain of reads, rest is returned when ring is full
+            for (io = (IO*)ipc.param2; io != NULL; io = next)
+            {
+                next = io->next;
+                if (rx_count[side] >= RING_ACCEPT || rx_count[side] >= RX_RING_MAX)
+                {
+                    ++rx_rejects;
+                    io_complete_ex(ipc.process, HAL_IO_CMD(HAL_ETH, IPC_READ), side, io, ERROR_IN_PROGRESS);
+                    break;
+                }
+                io->next = NULL;
+                rx_io[side][rx_count[side]++] = io;
+            }
+            error(ERROR_SYNC);
+            break;
+        case IPC_WRITE:
+            if (tx_inflight[side] >= RING_ACCEPT)
+            {
+                ++tx_rejects;
+                error(ERROR_IN_PROGRESS);
+                break;
+            }
+            ++tx_inflight[side];
+            wire_tx(side, (IO*)ipc.param2);
+            error(ERROR_SYNC);
+            break;
+        default:
+            error(ERROR_NOT_SUPPORTED);
+        }
+        ipc_write(&ipc);
+    }
+}
+
+//ICMP echo from receiver to sender during bulk transfer. Reply waits in sender tx queue
+void pinger()
+{
+    IP ip;
+    unsigned long long t;
+    unsigned int rtt;
+    ip.u32.ip = IP_MAKE(10, 0, 0, 1);
+    sleep_ms(100);
+    while (received < TOTAL)
+    {
+        t = kposix_time_us();
+        if (icmp_ping(tcpip[1], &ip))
+        {
+            rtt = (unsigned int)(kposix_time_us() - t);
+            ++pings;
+            ping_sum += rtt;
+            if (rtt > ping_max)
+                ping_max = rtt;
+        }
+        else
+            ++ping_lost;
+        sleep_ms(10);
+    }
+    for (;;)
+        sleep_ms(1000);
+}
+
+//every write block is filled with its number
+static void rx_verify(const uint8_t* data, unsigned int size)
+{
+    unsigned int i;
+    for (i = 0; i < size; ++i)
+        if (data[i] != (uint8_t)((received + i) / WRITE_SIZE))
+        {
+            ++corrupted;
+            break;
+        }
+}
+
+void rx_app()
+{
+    IPC ipc;
+    HANDLE tcb;
+    IO* io;
+#if !(ZC)
+    int res;
+#endif //ZC
+#if (ZC_STALL_MS)
+    unsigned int stalls = 0;
+#endif //ZC_STALL_MS
+#if (ZC_BOGUS)
+    int i;
+#endif //ZC_BOGUS
+    tcp_listen(tcpip[1], 5001);
+    do {
+        ipc_read(&ipc);
+    } while (HAL_GROUP(ipc.cmd) != HAL_TCP || HAL_ITEM(ipc.cmd) != IPC_OPEN);
+    tcb = ipc.param2;
+#if (ZC)
+#if (ZC_BOGUS)
+    //not given by stack: rejected, frames count untouched. Otherwise stack is out of frames accounting and transfer fails
+    for (i = 0; i < TCPIP_MAX_FRAMES_COUNT * 2; ++i)
+        tcp_release_frame(tcpip[1], tcb, io_create(64));
+    tcp_release_frame(tcpip[1], tcb, NULL);
+#endif //ZC_BOGUS
+    while (received < TOTAL)
+    {
+        io = tcp_read_frame_sync(tcpip[1], tcb);
+        if (io == NULL)
+        {
+            printd("read frame error %d\n", get_last_error());
+            break;
+        }
+        rx_verify(io_data(io), io->data_size);
+        received += io->data_size;
+        ++zc_frames;
+#if (ZC_STALL_MS)
+        //slow user: stack must keep frames for rx and ACK
+        if (++stalls % 200 == 0)
+            sleep_ms(ZC_STALL_MS);
+#endif //ZC_STALL_MS
+        tcp_release_frame(tcpip[1], tcb, io);
+    }
+    rx_done = kposix_time_us();
+    rx_tsc = __builtin_ia32_rdtsc();
+#if (CLOSE)
+    io = tcp_read_frame_sync(tcpip[1], tcb);
+    printd("rx frame after close: %x %d\n", io, get_last_error());
+#endif //CLOSE
+#else
+    io = io_create(READ_SIZE + sizeof(TCP_STACK));
+    while (received < TOTAL)
+    {
+#if (RX_SLEEP_MS)
+        sleep_ms(RX_SLEEP_MS);
+#endif //RX_SLEEP_MS
+        res = tcp_read_sync(tcpip[1], tcb, io, READ_SIZE);
+        if (res < 0)
+        {
+            printd("read error %d\n", res);
+            break;
+        }
+        rx_verify(io_data(io), res);
+        received += res;
+    }
+    rx_done = kposix_time_us();
+    rx_tsc = __builtin_ia32_rdtsc();
+#if (CLOSE)
+    res = tcp_read_sync(tcpip[1], tcb, io, READ_SIZE);
+    printd("rx after close: %d\n", res);
+#endif //CLOSE
+#endif //ZC
+#if (CLOSE)
+    tcp_close(tcpip[1], tcb);
+    printd("rx closed %d\n", get_last_error());
+#endif //CLOSE
+    for (;;)
+        ipc_read(&ipc);
+}
+
+//wait write completion. On close not sent blocks are returned at once, every block is counted
+static int write_wait(HANDLE tcb, int* pending)
+{
+    IPC ipc;
+    IO* io;
+    ipc_read_ex(&ipc, tcpip[0], HAL_IO_CMD(HAL_TCP, IPC_WRITE), tcb);
+    for (io = (IO*)ipc.param2; io != NULL; io = tcp_unchain_write(io))
+        --(*pending);
+    return (int)ipc.param3;
+}
+
+void app()
+{
+    IP ip;
+    HANDLE tcb, w;
+    IO* io[WRITE_DEPTH];
+    TCP_STACK* stack;
+    TCP_STAT st;
+    int i, j, res, pending;
+    unsigned int sent;
+    unsigned long long t, tsc;
+    w = process_create(&__WIRE);
+    tcpip[0] = tcpip_create(8192, 150, 0);
+    tcpip[1] = tcpip_create(8192, 150, 1);
+    ip.u32.ip = IP_MAKE(10, 0, 0, 1);
+    ip_set(tcpip[0], &ip);
+    ip.u32.ip = IP_MAKE(10, 0, 0, 2);
+    ip_set(tcpip[1], &ip);
+    tcpip_open(tcpip[0], w, 0, ETH_AUTO);
+    tcpip_open(tcpip[1], w, 1, ETH_AUTO);
+    sleep_ms(10);
+    process_create(&__RX);
+    sleep_ms(10);
+#if (PING)
+    process_create(&__PING);
+#endif //PING
+    tcb = tcp_create_tcb(tcpip[0], &ip, 5001);
+    if (!tcp_open(tcpip[0], tcb))
+    {
+        printd("open failed %d\n", get_last_error());
+        _exit(1);
+    }
+    for (i = 0; i < WRITE_DEPTH; ++i)
+    {
+#if (CHAIN)
+        //user block of 2 segments, TCP_STACK in head
+        io[i] = io_create(WRITE_SIZE / 2 + sizeof(TCP_STACK));
+        io_chain(io[i], io_create(WRITE_SIZE / 2));
+#else
+        io[i] = io_create(WRITE_SIZE + sizeof(TCP_STACK));
+#endif //CHAIN
+    }
+    t = kposix_time_us();
+    tsc = __builtin_ia32_rdtsc();
+    sent = 0;
+    pending = 0;
+    for (i = 0; sent < TOTAL; ++i)
+    {
+        j = i % WRITE_DEPTH;
+        if (i >= WRITE_DEPTH)
+        {
+            res = write_wait(tcb, &pending);
+            if (res < 0)
+            {
+                printd("write error %d after %d bytes\n", res, sent);
+                break;
+            }
+        }
+        io_reset(io[j]);
+        stack = io_push(io[j], sizeof(TCP_STACK));
+        stack->flags = 0;
+        stack->urg_len = 0;
+#if (CHAIN)
+        memset(io_data(io[j]), (uint8_t)i, WRITE_SIZE / 2);
+        io[j]->data_size = WRITE_SIZE / 2;
+        memset(io_data(io[j]->next), (uint8_t)i, WRITE_SIZE / 2);
+        io[j]->next->data_size = WRITE_SIZE / 2;
+#else
+        memset(io_data(io[j]), (uint8_t)i, WRITE_SIZE);
+        io[j]->data_size = WRITE_SIZE;
+#endif //CHAIN
+        tcp_write(tcpip[0], tcb, io[j]);
+        ++pending;
+        sent += WRITE_SIZE;
+    }
+    while (pending > 0)
+        write_wait(tcb, &pending);
+    for (j = 0; j < WRITE_DEPTH; ++j)
+    {
+        error(ERROR_OK);
+        io_destroy(io[j]);
+        if (get_last_error() != ERROR_OK)
+            printd("write block %d destroy error %d\n", j, get_last_error());
+    }
+#if (CLOSE)
+    tcp_close(tcpip[0], tcb);
+    printd("closed %d\n", get_last_error());
+#endif //CLOSE
+    for (j = 0; j < 100000 && received < TOTAL; ++j)
+        sleep_ms(10);
+    t = (rx_done ? rx_done : kposix_time_us()) - t;
+    printd("latency %d us, loss %d ppm: %d bytes in %d us: %d kbit/s, frames %d, lost %d, rx drops %d, corrupted reads %d\n",
+           LATENCY_US, LOSS_PPM, received, (int)t, (int)((unsigned long long)received * 8000 / (t ? t : 1)), frames, lost, drops, corrupted);
+    printd("driver rejects: tx %d, rx %d\n", tx_rejects, rx_rejects);
+#if (PING)
+    printd("ping during transfer: %d replies, %d lost, avg %d us, max %d us\n", pings, ping_lost, ping_sum / (pings ? pings : 1), ping_max);
+#endif //PING
+#if (ZC)
+    //stack has TCPIP_MAX_FRAMES_COUNT frames: whole transfer is only possible, if every frame is returned
+    printd("zero-copy: %d frames read and returned, %s\n", zc_frames, (received == TOTAL && !corrupted && zc_frames > TCPIP_MAX_FRAMES_COUNT) ? "ok" : "FAILED");
+#endif //ZC
+    if (rx_tsc)
+        printd("host cycles/byte x100: %d\n", (int)((rx_tsc - tsc) * 100 / (received ? received : 1)));
+    tcp_get_stat(tcpip[1], &st);
+    printd("rx stat: %d bytes, %d ACK frames, %d ACK/MB\n", st.rx_bytes, st.tx_acks, (int)((unsigned long long)st.tx_acks * 1048576 / (st.rx_bytes ? st.rx_bytes : 1)));
+    _exit(0);
+}
@@ -0,0 +1,82 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+/*
+    bench_timer.c - soft timers start/stop cost with many active timers, and firing accuracy.
+    Accuracy is checked on host time, or on virtual time, if POSIX_VIRTUAL_CLOCK is set. Start/stop cost is
+    measured only by host time, it is 0 on virtual.
+
+    Options (DEFINES):
+    TIMERS          active timers
+    SPREAD_MS       accuracy check: timers are fired in this range
+ */
+
+#include "host.h"
+#include "../../userspace/process.h"
+#include "../../userspace/ipc.h"
+#include "../../userspace/systime.h"
+
+#ifndef TIMERS
+#define TIMERS                          400
+#endif //TIMERS
+#ifndef SPREAD_MS
+#define SPREAD_MS                       3000
+#endif //SPREAD_MS
+
+#define ROUNDS                          100000
+#define ACCURACY_TIMERS                 60
+
+void app();
+
+const REX __APP = {"App main", 8192, 200, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, app, 64};
+
+static HANDLE timers[TIMERS];
+static unsigned long long due[ACCURACY_TIMERS];
+static unsigned int seed = 1;
+
+static unsigned int bench_rand(unsigned int range)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % range;
+}
+
+void app()
+{
+    int i, fired, early;
+    unsigned long long t, now, late_max;
+    IPC ipc;
+    for (i = 0; i < TIMERS; ++i)
+        timers[i] = timer_create(i, HAL_APP);
+    for (i = 0; i < TIMERS; ++i)
+        timer_start_ms(timers[i], 100 + bench_rand(60000));
+    t = kposix_time_us();
+    for (i = 0; i < ROUNDS; ++i)
+    {
+        timer_istop(timers[i % TIMERS]);
+        timer_start_ms(timers[i % TIMERS], 100 + bench_rand(60000));
+    }
+    printd("%d active: %d ns per stop+start\n", TIMERS, (int)((kposix_time_us() - t) * 1000 / ROUNDS));
+    for (i = 0; i < TIMERS; ++i)
+        timer_istop(timers[i]);
+
+    for (i = 0; i < ACCURACY_TIMERS; ++i)
+    {
+        due[i] = kposix_time_us() + bench_rand(SPREAD_MS) * 1000;
+        timer_start_us(timers[i], due[i] - kposix_time_us());
+    }
+    late_max = 0;
+    for (fired = early = 0; fired < ACCURACY_TIMERS; ++fired)
+    {
+        ipc_read(&ipc);
+        now = kposix_time_us();
+        if (now < due[ipc.param1])
+            ++early;
+        else if (now - due[ipc.param1] > late_max)
+            late_max = now - due[ipc.param1];
+    }
+    printd("%d timers in %d ms: fired %d, early %d, max late %d us\n", ACCURACY_TIMERS, SPREAD_MS, fired, early, (int)late_max);
+    _exit(0);
+}
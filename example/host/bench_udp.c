@@ -0,0 +1,467 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+/*
+    bench_udp.c - emulated MAC floods one stack with UDP datagrams at 100Mbit line rate, app counts them.
+    Received rate, MAC FIFO drops and driver IPC per frame with per-frame or polled batched handoff.
+
+    Options (DEFINES):
+    BATCH           0: one IPC per frame, 1: chained frames in one ETH_POLL IPC, polled while frames are arriving
+    FRAME           frame size on wire, without preamble, FCS and IFG
+    FIFO            MAC rx FIFO, frames
+    TICK_US         interrupt/timer granularity of emulated MAC
+    DURATION_US     flood time
+    READ_DEPTH      udp_read requests, posted by app
+    ETH_RX_RING_SIZE
+    UDPTX           instead of flood: send 2-segment IO chains, check frames on wire
+    ARPQ            instead of flood: datagrams queued on unresolved neighbors. 10.0.0.2 answers ARP resend,
+                    10.0.0.3/4 never answer. Queued frames are delivered or dropped, none is lost in queue
+ */
+
+#include "host.h"
+#include "../../userspace/process.h"
+#include "../../userspace/ipc.h"
+#include "../../userspace/io.h"
+#include "../../userspace/error.h"
+#include "../../userspace/systime.h"
+#include "../../userspace/eth.h"
+#include "../../userspace/tcpip.h"
+#include "../../userspace/udp.h"
+#include "../../userspace/ip.h"
+#include "../../userspace/arp.h"
+#include <string.h>
+
+#ifndef BATCH
+#define BATCH                           0
+#endif //BATCH
+#ifndef FRAME
+#define FRAME                           64
+#endif //FRAME
+#ifndef FIFO
+#define FIFO                            24
+#endif //FIFO
+#ifndef TICK_US
+#define TICK_US                         50
+#endif //TICK_US
+#ifndef DURATION_US
+#define DURATION_US                     1000000
+#endif //DURATION_US
+#ifndef READ_DEPTH
+#define READ_DEPTH                      16
+#endif //READ_DEPTH
+#ifndef UDPTX
+#define UDPTX                           0
+#endif //UDPTX
+#ifndef ARPQ
+#define ARPQ                            0
+#endif //ARPQ
+
+//100Mbit
+#define NS_PER_BYTE                     80
+//preamble, SFD, FCS, IFG
+#define WIRE_OVERHEAD                   24
+#define POSTED_MAX                      64
+#define UDP_PAYLOAD_OFFSET              (14 + 20 + 8)
+#define UDPTX_HEAD                      300
+#define UDPTX_TAIL                      200
+#define ARP_REQUEST_OP                  1
+#define ARPQ_HOSTS                      5
+
+void app();
+void wire();
+
+const REX __APP = {"App main", 16384, 200, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, app, 64};
+const REX __WIRE = {"wire", 4096, 50, PROCESS_FLAGS_ACTIVE | REX_FLAG_PERSISTENT_NAME, wire, 64};
+
+static HANDLE tcpip, app_process;
+static IO* posted[POSTED_MAX];
+static unsigned int posted_count, seq, fifo;
+static unsigned long long wire_ns, stop_ns;
+static bool polling, running;
+static unsigned int st_wire, st_drop, st_ipc, st_polls, st_posts, st_read_ipc;
+static unsigned int received, gaps;
+static uint8_t frame[FRAME];
+
+static unsigned int tx_ok, tx_bad;
+static unsigned int arpq_tx[ARPQ_HOSTS], arpq_requests[ARPQ_HOSTS];
+static bool arpq_answer;
+
+static IO* wire_posted()
+{
+    IO* io = posted[0];
+    memmove(&posted[0], &posted[1], sizeof(IO*) * (--posted_count));
+    return io;
+}
+
+//2-segment chain is sent as one frame
+static void wire_tx_check(IO* io)
+{
+    unsigned int i;
+    uint8_t* p = io_data(io);
+    if (p[12] != 0x08 || p[13] != 0x00 || p[23] != PROTO_UDP)
+        return;
+    if (io->data_size != UDP_PAYLOAD_OFFSET + UDPTX_HEAD + UDPTX_TAIL)
+    {
+        ++tx_bad;
+        return;
+    }
+    for (i = 0; i < UDPTX_HEAD + UDPTX_TAIL; ++i)
+        if (p[UDP_PAYLOAD_OFFSET + i] != (uint8_t)(i < UDPTX_HEAD ? i : 0xa5))
+        {
+            ++tx_bad;
+            return;
+        }
+    ++tx_ok;
+}
+
+//10.0.0.2 answers resent request only, frames are queued meanwhile
+static void arpq_reply(uint8_t* req)
+{
+    IO* io;
+    uint8_t* p;
+    if (!arpq_answer || req[41] != 2 || (arpq_requests[2] & 1) == 0 || posted_count == 0)
+        return;
+    io = wire_posted();
+    p = io_data(io);
+    memcpy(p, req + 6, 6);
+    p[6] = 0x02; p[7] = 0x22; p[8] = 0x33; p[9] = 0x44; p[10] = 0x55; p[11] = 0x02;
+    p[12] = 0x08; p[13] = 0x06;
+    memcpy(p + 14, req + 14, 6);
+    p[20] = 0; p[21] = 2;
+    memcpy(p + 22, p + 6, 6);
+    memcpy(p + 28, req + 38, 4);
+    memcpy(p + 32, req + 22, 10);
+    io->data_size = 42;
+    io_complete_ex(tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), 0, io, io->data_size | ETH_RX_CHECKSUM_OK);
+}
+
+static void arpq_tx_check(IO* io)
+{
+    uint8_t* p = io_data(io);
+    if (p[12] == 0x08 && p[13] == 0x06 && p[21] == ARP_REQUEST_OP && p[41] < ARPQ_HOSTS)
+    {
+        ++arpq_requests[p[41]];
+        arpq_reply(p);
+    }
+    if (p[12] == 0x08 && p[13] == 0x00 && p[23] == PROTO_UDP && p[33] < ARPQ_HOSTS)
+        ++arpq_tx[p[33]];
+}
+
+//IPv4 10.0.0.2 -> 10.0.0.1, UDP 5000 -> 5001. Payload starts with sequence number
+static void wire_frame_init()
+{
+    IP src, dst;
+    frame[12] = 0x08;
+    frame[13] = 0x00;
+    frame[14] = 0x45;
+    frame[16] = (FRAME - 14) >> 8;
+    frame[17] = (FRAME - 14) & 0xff;
+    frame[22] = 64;
+    frame[23] = PROTO_UDP;
+    src.u32.ip = IP_MAKE(10, 0, 0, 2);
+    dst.u32.ip = IP_MAKE(10, 0, 0, 1);
+    memcpy(frame + 26, &src, 4);
+    memcpy(frame + 30, &dst, 4);
+    frame[34] = 5000 >> 8;
+    frame[35] = 5000 & 0xff;
+    frame[36] = 5001 >> 8;
+    frame[37] = 5001 & 0xff;
+    frame[38] = (FRAME - 34) >> 8;
+    frame[39] = (FRAME - 34) & 0xff;
+}
+
+//frames arrived from wire to MAC FIFO since last call
+static void wire_arrive()
+{
+    unsigned long long now = kposix_time_us() * 1000;
+    while (running && wire_ns + (FRAME + WIRE_OVERHEAD) * NS_PER_BYTE <= now)
+    {
+        wire_ns += (FRAME + WIRE_OVERHEAD) * NS_PER_BYTE;
+        if (wire_ns >= stop_ns)
+        {
+            running = false;
+            ipc_post_inline(app_process, HAL_CMD(HAL_APP, 0), 0, 0, 0);
+            break;
+        }
+        ++st_wire;
+        if (fifo < FIFO)
+            ++fifo;
+        else
+        {
+            //lost frame still consumes sequence number
+            ++st_drop;
+            ++seq;
+        }
+    }
+}
+
+//DMA fills posted descriptor from FIFO
+static IO* wire_pop()
+{
+    IO* io = wire_posted();
+    --fifo;
+    memcpy(io_data(io), frame, FRAME);
+    memcpy((uint8_t*)io_data(io) + UDP_PAYLOAD_OFFSET, &seq, sizeof(seq));
+    ++seq;
+    io->data_size = FRAME;
+    return io;
+}
+
+//"irq" or poll request delivers filled descriptors
+static void wire_deliver(bool poll, unsigned int budget)
+{
+    IO* head;
+    IO* tail;
+    IO* io;
+    ETH_RX_STACK* stack;
+    unsigned int count;
+    if (!BATCH)
+    {
+        while (fifo && posted_count)
+        {
+            ++st_ipc;
+            io = wire_pop();
+            io_complete_ex(tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), 0, io, io->data_size | ETH_RX_CHECKSUM_OK);
+        }
+        return;
+    }
+    //irq is masked while stack is polling
+    if (polling && !poll)
+        return;
+    head = tail = NULL;
+    for (count = 0; count < budget && fifo && posted_count; ++count)
+    {
+        io = wire_pop();
+        io->next = NULL;
+        stack = io_push(io, sizeof(ETH_RX_STACK));
+        stack->flags = ETH_RX_CHECKSUM_OK;
+        if (tail)
+            tail->next = io;
+        else
+            head = io;
+        tail = io;
+    }
+    polling = count > 0;
+    if (count)
+    {
+        ++st_ipc;
+        io_complete_ex(tcpip, HAL_IO_CMD(HAL_ETH, ETH_POLL), 0, head, ETH_RX_POLL);
+    }
+}
+
+//emulated MAC driver
+void wire()
+{
+    IPC ipc;
+    IO* io;
+    IO* next;
+    HANDLE timer = timer_create(0, HAL_APP);
+    wire_frame_init();
+    for (;;)
+    {
+        ipc_read(&ipc);
+        error(ERROR_OK);
+        if (HAL_GROUP(ipc.cmd) == HAL_APP)
+        {
+            //flood start from app
+            if (ipc.param1)
+            {
+                wire_ns = kposix_time_us() * 1000;
+                stop_ns = wire_ns + DURATION_US * 1000ull;
+                running = true;
+                app_process = ipc.process;
+            }
+            wire_arrive();
+            wire_deliver(false, POSTED_MAX);
+            if (running)
+                timer_start_us(timer, TICK_US);
+            continue;
+        }
+        switch (HAL_ITEM(ipc.cmd))
+        {
+        case IPC_OPEN:
+            tcpip = ipc.process;
+            ipc_post_inline(ipc.process, HAL_CMD(HAL_ETH, ETH_NOTIFY_LINK_CHANGED), 0, ETH_100_FULL, 0);
+            break;
+        case ETH_GET_HEADER_SIZE:
+            ipc.param2 = 0;
+            ipc.param3 = 0;
+            break;
+        case ETH_GET_FEATURES:
+            ipc.param2 = ETH_FEATURE_TX_CHECKSUM | ETH_FEATURE_RX_CHECKSUM;
+            break;
+        case ETH_GET_MAC:
+            ipc.param2 = 0x11223300;
+            ipc.param3 = 0x4455;
+            memcpy(frame, &ipc.param2, 4);
+            memcpy(frame + 4, &ipc.param3, 2);
+            break;
+        case ETH_GET_RING_SIZE:
+            ipc.param2 = ipc.param3 = ETH_RX_RING_SIZE;
+            break;
+        case IPC_READ:
+            for (io = (IO*)ipc.param2; io != NULL; io = next)
+            {
+                next = io->next;
+                if (posted_count >= POSTED_MAX)
+                {
+                    io_complete_ex(ipc.process, HAL_IO_CMD(HAL_ETH, IPC_READ), 0, io, ERROR_IN_PROGRESS);
+                    break;
+                }
+                io->next = NULL;
+                posted[posted_count++] = io;
+                ++st_posts;
+            }
+            ++st_read_ipc;
+            wire_arrive();
+            //descriptor returned to DMA is filled immediately if frames are waiting in FIFO
+            if (!BATCH)
+                wire_deliver(false, POSTED_MAX);
+            error(ERROR_SYNC);
+            break;
+        case IPC_WRITE:
+            if (UDPTX)
+                wire_tx_check((IO*)ipc.param2);
+            if (ARPQ)
+                arpq_tx_check((IO*)ipc.param2);
+            io_complete(ipc.process, HAL_IO_CMD(HAL_ETH, IPC_WRITE), 0, (IO*)ipc.param2);
+            error(ERROR_SYNC);
+            break;
+        case ETH_POLL:
+            ++st_polls;
+            wire_arrive();
+            wire_deliver(true, ipc.param2);
+            //posted without reply
+            continue;
+        default:
+            error(ERROR_NOT_SUPPORTED);
+        }
+        ipc_write(&ipc);
+    }
+}
+
+static void app_udptx()
+{
+    MAC mac;
+    IP dst;
+    IO* chain;
+    HANDLE h;
+    unsigned int i;
+    mac.u32.hi = 0x11223302;
+    mac.u32.lo = 0x4455;
+    dst.u32.ip = IP_MAKE(10, 0, 0, 2);
+    arp_add_static(tcpip, &dst, &mac);
+    h = udp_connect(tcpip, 5000, &dst);
+    chain = io_create(UDPTX_HEAD);
+    io_chain(chain, io_create(UDPTX_TAIL));
+    for (i = 0; i < UDPTX_HEAD; ++i)
+        ((uint8_t*)io_data(chain))[i] = i;
+    chain->data_size = UDPTX_HEAD;
+    memset(io_data(chain->next), 0xa5, UDPTX_TAIL);
+    chain->next->data_size = UDPTX_TAIL;
+    for (i = 0; i < 10; ++i)
+        udp_write_sync(tcpip, h, chain);
+    sleep_ms(10);
+    error(ERROR_OK);
+    io_destroy(chain);
+    printd("udp chained write: %d ok, %d bad, destroy error %d\n", tx_ok, tx_bad, get_last_error());
+}
+
+static void app_arpq()
+{
+    IP dst;
+    IO* io;
+    HANDLE h[ARPQ_HOSTS];
+    unsigned int round, i, n;
+    io = io_create(100);
+    io->data_size = 100;
+    memset(io_data(io), 0x5a, 100);
+    //first round is never answered
+    for (round = 0; round < 3; ++round)
+    {
+        //ICMP no route errors connection, reopen
+        for (i = 2; i < ARPQ_HOSTS; ++i)
+        {
+            dst.u32.ip = IP_MAKE(10, 0, 0, i);
+            h[i] = udp_connect(tcpip, 5000 + round * 10 + i, &dst);
+        }
+        memset(arpq_tx, 0, sizeof(arpq_tx));
+        arpq_answer = (round != 0);
+        for (i = 2; i < ARPQ_HOSTS; ++i)
+            for (n = 0; n < 5; ++n)
+                udp_write_sync(tcpip, h[i], io);
+        //past incomplete and negative cache timeouts
+        sleep_ms(30000);
+        printd("round %d: delivered to .2 %d .3 %d .4 %d, ARP requests .2 %d .3 %d .4 %d\n", round, arpq_tx[2], arpq_tx[3], arpq_tx[4],
+               arpq_requests[2], arpq_requests[3], arpq_requests[4]);
+    }
+    //no frame is lost in queues: stack is still able to send
+    memset(arpq_tx, 0, sizeof(arpq_tx));
+    for (n = 0; n < 20; ++n)
+        udp_write_sync(tcpip, h[2], io);
+    sleep_ms(100);
+    printd("after: delivered to .2 %d of 20\n", arpq_tx[2]);
+}
+
+static void app_flood(HANDLE w)
+{
+    HANDLE h;
+    IO* io;
+    IPC ipc;
+    unsigned int i, s, expect;
+    unsigned long long tsc;
+    h = udp_listen(tcpip, 5001);
+    for (i = 0; i < READ_DEPTH; ++i)
+        udp_read(tcpip, h, io_create(TCPIP_MTU + 100), TCPIP_MTU);
+    expect = 0;
+    tsc = __builtin_ia32_rdtsc();
+    //start flood
+    ipc_post_inline(w, HAL_CMD(HAL_APP, 0), 1, 0, 0);
+    for (;;)
+    {
+        ipc_read(&ipc);
+        if (HAL_GROUP(ipc.cmd) == HAL_UDP)
+        {
+            io = (IO*)ipc.param2;
+            memcpy(&s, io_data(io), sizeof(s));
+            if (s != expect)
+                gaps += s - expect;
+            expect = s + 1;
+            ++received;
+            io_reset(io);
+            udp_read(tcpip, h, io, TCPIP_MTU);
+        }
+        //drained after end of flood
+        if (!running && fifo == 0 && received + st_drop >= st_wire)
+            break;
+    }
+    tsc = __builtin_ia32_rdtsc() - tsc;
+    printd("%s ring %2d frame %4d: wire %6d fps, received %6d fps, fifo drops %6d, seq gaps %6d, driver ipc %6d/s (%d polls), "
+           "frames/ipc %d.%02d, read ipc %d/s (%d.%02d buffers/ipc), host cycles/frame %d\n",
+           BATCH ? "batch" : "frame", ETH_RX_RING_SIZE, FRAME, st_wire * (1000000 / DURATION_US), received * (1000000 / DURATION_US), st_drop, gaps,
+           st_ipc * (1000000 / DURATION_US), st_polls, received / (st_ipc ? st_ipc : 1), (received * 100 / (st_ipc ? st_ipc : 1)) % 100,
+           st_read_ipc * (1000000 / DURATION_US), st_posts / (st_read_ipc ? st_read_ipc : 1), (st_posts * 100 / (st_read_ipc ? st_read_ipc : 1)) % 100,
+           (int)(tsc / (received ? received : 1)));
+}
+
+void app()
+{
+    IP ip;
+    HANDLE w;
+    w = process_create(&__WIRE);
+    tcpip = tcpip_create(8192, 150, 0);
+    ip.u32.ip = IP_MAKE(10, 0, 0, 1);
+    ip_set(tcpip, &ip);
+    tcpip_open(tcpip, w, 0, ETH_AUTO);
+    sleep_ms(10);
+    if (UDPTX)
+        app_udptx();
+    else if (ARPQ)
+        app_arpq();
+    else
+        app_flood(w);
+    _exit(0);
+}
@@ -0,0 +1,12 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+//host simulation: no board specific config
+
+#endif // CONFIG_H
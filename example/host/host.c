@@ -0,0 +1,23 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#include "host.h"
+#include "../../lib/lib_stdio.h"
+#include "../../userspace/svc.h"
+#include "../../userspace/process.h"
+#include <string.h>
+
+#define PRINTD_BUF_SIZE                 200
+
+void printd(const char* fmt, ...)
+{
+    char buf[PRINTD_BUF_SIZE];
+    va_list va;
+    va_start(va, fmt);
+    ((const LIB_STDIO*)__GLOBAL->lib[LIB_ID_STDIO])->sformat(buf, fmt, va);
+    va_end(va);
+    svc_call(SVC_PRINTD, (unsigned int)buf, strlen(buf), 0);
+}
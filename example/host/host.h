@@ -0,0 +1,21 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#ifndef HOST_H
+#define HOST_H
+
+/*
+    host.h - common part of host simulation benchmarks
+*/
+
+#include "../../kernel/core/kposix.h"
+
+//format string to kernel debug output (host stdout)
+void printd(const char* fmt, ...);
+//end of host process
+extern void _exit(int);
+
+#endif // HOST_H
@@ -0,0 +1,49 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#ifndef KERNEL_CONFIG_H
+#define KERNEL_CONFIG_H
+
+//----------------------------------- kernel ------------------------------------------------------------------
+//enable kernel info. Disabling this you can save some flash size, but kernel will be much less verbose, especially on critical errors. Generally doesn't affect on perfomance
+#define KERNEL_DEBUG                                1
+//marks objects with magic in headers. Decrease perfomance on few tacts, but very useful for debug if you don't have MPU enabled
+#define KERNEL_MARKS                                0
+//check range of dynamic objects in pools
+#define KERNEL_RANGE_CHECKING                       0
+//check kernel handles. Require few tacts, but making kernel calls much safer
+#define KERNEL_HANDLE_CHECKING                      1
+//check user adresses. Require few tacts, but making kernel calls much safer
+#define KERNEL_ADDRESS_CHECKING                     0
+//some kernel statistics (stack, mem, etc). Decrease perfomance in any object creation.
+#define KERNEL_PROFILING                            1
+//Enabling this you will get stats on each thread uptime, but decreasing context switching up to 2 times
+#define KERNEL_PROCESS_STAT                         1
+//Kernel halt on fatal error, disable power save mode
+//Don't forget to turn off in production.
+#define KERNEL_DEVELOPER_MODE                       1
+//enable this only if you have problems with system timer. May decrease perfomance
+#define KERNEL_TIMER_DEBUG                          0
+//default size of IPC queue per process. Can be overrided in REX
+#ifndef KERNEL_IPC_COUNT
+#define KERNEL_IPC_COUNT                            7
+#endif //KERNEL_IPC_COUNT
+//enable this only if you have problems with IPC oferflow.
+#define KERNEL_IPC_DEBUG                            1
+//Allows to debug critical kernel errors, but decreases perfomance
+#define KERNEL_SVC_DEBUG                            0
+//Enable on io security errors
+#define KERNEL_IO_DEBUG                             1
+//maximum number of global handles. Must be at least 1
+#define KERNEL_OBJECTS_COUNT                        5
+//preallocated IOs, shared by drivers and stacks. 0 - IO is always allocated from heap
+#define KERNEL_IO_POOL_COUNT                        12
+//size of preallocated IO with header. Ethernet frame with TCPIP_MTU 1500 requires ~1560
+#define KERNEL_IO_POOL_SIZE                         1568
+//maximum segments in IO chain. Longer or looped chain is rejected
+#define KERNEL_IO_MAX_SEGMENTS                      64
+
+#endif // KERNEL_CONFIG_H
@@ -0,0 +1,193 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#ifndef STM32_ETH_MODEL_H
+#define STM32_ETH_MODEL_H
+
+/*
+    stm32_eth_model.h - host model of STM32 ETH MAC/DMA registers and kernel calls, used by driver.
+    Driver source is taken from kernel/stm32 without includes, see Makefile.
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stddef.h>
+
+#define ETH_CHECKSUM_OFFLOAD                0
+#define MAC_FILTER                          0
+
+#ifndef ETH_RX_RING_SIZE
+#define ETH_RX_RING_SIZE                    2
+#endif //ETH_RX_RING_SIZE
+#ifndef ETH_TX_RING_SIZE
+#define ETH_TX_RING_SIZE                    2
+#endif //ETH_TX_RING_SIZE
+#ifndef ETH_RX_POLLING
+#define ETH_RX_POLLING                      0
+#endif //ETH_RX_POLLING
+#ifndef ETH_RX_POLL_THRESHOLD
+#define ETH_RX_POLL_THRESHOLD               1
+#endif //ETH_RX_POLL_THRESHOLD
+
+typedef unsigned int HANDLE;
+#define INVALID_HANDLE                      0
+#define KERNEL_HANDLE                       0
+
+typedef struct _IO {
+    struct _IO* next;
+    unsigned int data_offset, data_size, size;
+} IO;
+
+static inline void* io_data(IO* io)
+{
+    return (uint8_t*)io + sizeof(IO) + io->data_offset;
+}
+
+typedef struct {
+    unsigned int cmd, process, param1, param2;
+    int param3;
+} IPC;
+
+typedef union {
+    uint8_t u8[6];
+    struct {
+        uint32_t hi;
+        uint16_t lo;
+    } u32;
+} MAC;
+
+typedef enum {
+    ETH_10_HALF = 0,
+    ETH_10_FULL,
+    ETH_100_HALF,
+    ETH_100_FULL,
+    ETH_AUTO,
+    ETH_LOOPBACK,
+    ETH_NO_LINK,
+    ETH_REMOTE_FAULT
+} ETH_CONN_TYPE;
+
+enum {
+    IPC_OPEN = 1,
+    IPC_CLOSE,
+    IPC_FLUSH,
+    IPC_READ,
+    IPC_WRITE,
+    IPC_TIMEOUT,
+    ETH_SET_MAC = 100,
+    ETH_GET_MAC,
+    ETH_NOTIFY_LINK_CHANGED,
+    ETH_GET_HEADER_SIZE,
+    ETH_GET_FEATURES,
+    ETH_POLL,
+    ETH_GET_RING_SIZE
+};
+
+#define HAL_ETH                             0
+#define HAL_IO_CMD(group, cmd)              (cmd)
+#define HAL_CMD(group, cmd)                 (cmd)
+#define HAL_ITEM(cmd)                       (cmd)
+
+#define ETH_FEATURE_TX_CHECKSUM             (1 << 0)
+#define ETH_FEATURE_RX_CHECKSUM             (1 << 1)
+#define ETH_RX_CHECKSUM_OK                  (1 << 30)
+#define ETH_RX_POLL                         (1 << 29)
+
+#define ERROR_OK                            0
+#define ERROR_SYNC                          -1
+#define ERROR_NOT_ACTIVE                    -2
+#define ERROR_IN_PROGRESS                   -3
+#define ERROR_NOT_SUPPORTED                 -4
+#define ERROR_IO_CANCELLED                  -5
+#define ERROR_NOT_FOUND                     -6
+#define ERROR_NOT_CONFIGURED                -7
+
+//registers, used by driver. DMASR is write-1-to-clear on hardware, see eth_dmasr_clear
+typedef struct {
+    uint32_t MACCR, MACFFR, MACMIIAR, MACMIIDR, MACA0HR, MACA0LR;
+    uint32_t DMABMR, DMATPDR, DMARPDR, DMARDLAR, DMATDLAR, DMASR, DMAOMR, DMAIER, DMACHTDR, DMACHRDR;
+} ETH_TypeDef;
+
+typedef struct {
+    uint32_t AHBENR;
+} RCC_TypeDef;
+
+extern ETH_TypeDef eth_regs;
+extern RCC_TypeDef rcc_regs;
+#define ETH                                 (&eth_regs)
+#define RCC                                 (&rcc_regs)
+
+#define ETH_DMASR_TS                        (1 << 0)
+#define ETH_DMASR_RS                        (1 << 6)
+#define ETH_DMASR_NIS                       (1 << 16)
+#define ETH_DMABMR_SR                       (1 << 0)
+#define ETH_DMAOMR_SR                       (1 << 1)
+#define ETH_DMAOMR_ST                       (1 << 13)
+#define ETH_DMAOMR_FTF                      (1 << 20)
+#define ETH_DMAOMR_TSF                      (1 << 21)
+#define ETH_DMAIER_TIE                      (1 << 0)
+#define ETH_DMAIER_RIE                      (1 << 6)
+#define ETH_DMAIER_NISE                     (1 << 16)
+#define ETH_MACCR_RE                        (1 << 2)
+#define ETH_MACCR_TE                        (1 << 3)
+#define ETH_MACCR_IPCO                      (1 << 10)
+#define ETH_MACCR_DM                        (1 << 11)
+#define ETH_MACCR_FES                       (1 << 14)
+#define ETH_MACFFR_RA                       (1u << 31)
+#define ETH_MACMIIAR_MB                     (1 << 0)
+#define ETH_MACMIIAR_MW                     (1 << 1)
+#define ETH_MACMIIAR_MR                     (0x1f << 6)
+#define ETH_MACMIIAR_PA                     (0x1f << 11)
+#define ETH_MACMIIAR_CR_Div16               0
+#define ETH_MACMIIAR_CR_Div26               0
+#define ETH_MACMIIAR_CR_Div42               0
+#define ETH_MACMIIDR_MD                     0xffff
+#define RCC_AHBENR_ETHMACEN                 (1 << 0)
+#define RCC_AHBENR_ETHMACTXEN               (1 << 1)
+#define RCC_AHBENR_ETHMACRXEN               (1 << 2)
+#define ETH_IRQn                            61
+#define POWER_BUS_CLOCK                     0
+
+typedef struct _EXO EXO;
+
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+static inline void NVIC_EnableIRQ(int irq) {}
+static inline void NVIC_DisableIRQ(int irq) {}
+static inline void NVIC_SetPriority(int irq, int priority) {}
+static inline void kirq_register(HANDLE process, int irq, void (*isr)(int, void*), void* param) {}
+static inline void kirq_unregister(HANDLE process, int irq) {}
+static inline HANDLE ksystime_soft_timer_create(HANDLE process, int param, int hal) { return 1; }
+static inline void ksystime_soft_timer_destroy(HANDLE timer) {}
+static inline void ksystime_soft_timer_start_ms(HANDLE timer, int ms) {}
+static inline void kexo_post(HANDLE process, unsigned int cmd, unsigned int param1, unsigned int param2, unsigned int param3) {}
+static inline unsigned int stm32_power_get_clock_inside(EXO* exo, int clock) { return 72000000; }
+static inline bool eth_phy_power_on(uint8_t phy_addr, ETH_CONN_TYPE conn) { return true; }
+static inline void eth_phy_power_off(uint8_t phy_addr) {}
+static inline ETH_CONN_TYPE eth_phy_get_conn_status(uint8_t phy_addr) { return ETH_100_FULL; }
+
+extern int last_error;
+static inline void kerror(int error) { last_error = error; }
+static inline void error(int error) { last_error = error; }
+
+//provided by model
+void iio_complete_ex(HANDLE process, unsigned int cmd, unsigned int handle, IO* io, int param3);
+void eth_dmasr_clear(uint32_t bits);
+void eth_rx_poll(void);
+void eth_tx_poll(void);
+
+static inline void iio_complete(HANDLE process, unsigned int cmd, unsigned int handle, IO* io)
+{
+    iio_complete_ex(process, cmd, handle, io, io->data_size);
+}
+
+static inline void kexo_io_ex(HANDLE process, unsigned int cmd, unsigned int handle, IO* io, int param3)
+{
+    iio_complete_ex(process, cmd, handle, io, param3);
+}
+
+#endif // STM32_ETH_MODEL_H
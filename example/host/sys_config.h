@@ -0,0 +1,109 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#ifndef SYS_CONFIG_H
+#define SYS_CONFIG_H
+
+/*
+    sys_config.h - host simulation benchmarks config. Network is driven by emulated MAC, no hardware drivers.
+    Values, marked #ifndef, are changed by benchmark in Makefile or with DEFINES.
+ */
+
+//----------------------------- objects ----------------------------------------------
+//make sure, you know what are you doing, before change
+#define SYS_OBJ_STDOUT                                      0
+#define SYS_OBJ_CORE                                        1
+#define SYS_OBJ_ETH                                         2
+
+#define SYS_OBJ_ADC                                         INVALID_HANDLE
+#define SYS_OBJ_DAC                                         INVALID_HANDLE
+#define SYS_OBJ_STDIN                                       INVALID_HANDLE
+//------------------------------ POWER -----------------------------------------------
+#define POWER_MANAGEMENT                                    0
+//--------------------------------- ETH ----------------------------------------------
+#define ETH_AUTO_NEGOTIATION_TIME                           5000
+
+#define ETH_DOUBLE_BUFFERING                                1
+//------------------------------- TCP/IP ---------------------------------------------
+#define TCPIP_DEBUG                                         0
+#define TCPIP_DEBUG_ERRORS                                  0
+
+#define TCPIP_MTU                                           1500
+#ifndef TCPIP_MAX_FRAMES_COUNT
+#define TCPIP_MAX_FRAMES_COUNT                              10
+#endif //TCPIP_MAX_FRAMES_COUNT
+//IPC queue size of stack process. Each frame in flight requires at least one
+#define TCPIP_IPC_COUNT                                     32
+
+//----------------------------- TCP/IP MAC --------------------------------------------
+//software MAC filter. Turn on in case of hardware is not supporting
+#define MAC_FILTER                                          0
+#define MAC_FIREWALL                                        1
+#define TCPIP_MAC_DEBUG                                     0
+
+//----------------------------- TCP/IP ARP --------------------------------------------
+#define ARP_DEBUG                                           0
+#define ARP_DEBUG_FLOW                                      0
+
+#ifndef ARP_CACHE_SIZE_MAX
+#define ARP_CACHE_SIZE_MAX                                  10
+#endif //ARP_CACHE_SIZE_MAX
+//in seconds
+#define ARP_CACHE_INCOMPLETE_TIMEOUT                        5
+#define ARP_CACHE_TIMEOUT                                   600
+
+//----------------------------- TCP/IP IP ---------------------------------------------
+#define IP_DEBUG                                            0
+#define IP_DEBUG_FLOW                                       0
+
+//set, if not supported by hardware
+#define IP_CHECKSUM                                         1
+
+#define IP_FRAGMENTATION                                    1
+#define IP_FRAGMENTATION_ASSEMBLY_TIMEOUT                   10
+//must be less TCPIP_MTU * TCPIP_MAX_FRAMES_COUNT
+#define IP_MAX_LONG_SIZE                                    5000
+#define IP_MAX_LONG_PACKETS                                 2
+
+#define IP_FIREWALL                                         1
+
+//---------------------------- TCP/IP ICMP --------------------------------------------
+#define ICMP                                                1
+#define ICMP_DEBUG                                          0
+
+#define ICMP_ECHO_TIMEOUT                                   5
+//reply on ICMP echo and echo request
+#define ICMP_ECHO                                           1
+
+//----------------------------- TCP/IP UDP --------------------------------------------
+#ifndef UDP
+#define UDP                                                 0
+#endif //UDP
+//required for DHCP
+#define UDP_BROADCAST                                       1
+#define DNSS                                                0
+#define DHCPS                                               0
+
+#define UDP_DEBUG                                           0
+#define UDP_DEBUG_FLOW                                      0
+#define DNSS_DEBUG                                          0
+#define DHCPS_DEBUG                                         0
+
+//----------------------------- TCP/IP TCP --------------------------------------------
+#define TCP_DEBUG                                           0
+#define TCP_RETRY_COUNT                                     3
+#define TCP_KEEP_ALIVE                                      0
+//maximum retransmission timeout, keep-alive interval, ms
+#define TCP_TIMEOUT                                         30000
+//0 - don't limit
+#ifndef TCP_HANDLES_LIMIT
+#define TCP_HANDLES_LIMIT                                   10
+#endif //TCP_HANDLES_LIMIT
+//Low-level debug. only for development
+#define TCP_DEBUG_FLOW                                      0
+#define TCP_DEBUG_PACKETS                                   0
+
+#endif // SYS_CONFIG_H
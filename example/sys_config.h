@@ -128,18 +128,38 @@
 #define ETH_AUTO_NEGOTIATION_TIME                           5000
 
 #define ETH_DOUBLE_BUFFERING                                1
+//DMA descriptor rings depth of MAC driver (stm32, lpc). Rx frames are taken from TCPIP_MAX_FRAMES_COUNT.
+//Without them depth is 2 or 1, depending on ETH_DOUBLE_BUFFERING. USB RNDIS supports only that
+#define ETH_RX_RING_SIZE                                    4
+#define ETH_TX_RING_SIZE                                    4
+//mask rx interrupt after first frame and poll ring by stack, until it is drained
+#define ETH_RX_POLLING                                      1
+//poll, returned less frames, switches back to interrupt
+#define ETH_RX_POLL_THRESHOLD                               1
+//IP/TCP/UDP/ICMP checksums are calculated and verified by MAC
+#define ETH_CHECKSUM_OFFLOAD                                1
 //------------------------------- TCP/IP ---------------------------------------------
 #define TCPIP_DEBUG                                         1
 #define TCPIP_DEBUG_ERRORS                                  1
+//print rx frames, interrupts and driver IPC per second
+#define TCPIP_DEBUG_RX_STATS                                0
 
 #define TCPIP_MTU                                           1500
 #define TCPIP_MAX_FRAMES_COUNT                              10
+//frames per tx class (control: ARP, ICMP, TCP without payload; bulk), waiting for driver. Bulk is dropped first
+#define TCPIP_TX_QUEUE_SIZE                                 8
+//IPC queue size of stack process. Each frame in flight requires at least one
+#define TCPIP_IPC_COUNT                                     32
 
 //----------------------------- TCP/IP MAC --------------------------------------------
 //software MAC filter. Turn on in case of hardware is not supporting
 #define MAC_FILTER                                          0
 #define MAC_FIREWALL                                        1
 #define TCPIP_MAC_DEBUG                                     0
+//capture rx/tx frames to ring buffer, read as pcap stream with mac_pcap_read()
+#define MAC_PCAP                                            0
+#define MAC_PCAP_BUF_SIZE                                   4096
+#define MAC_PCAP_SNAPLEN                                    128
 
 //----------------------------- TCP/IP ARP --------------------------------------------
 #define ARP_DEBUG                                           1
@@ -149,6 +169,13 @@
 //in seconds
 #define ARP_CACHE_INCOMPLETE_TIMEOUT                        5
 #define ARP_CACHE_TIMEOUT                                   600
+//no answer on request: drop instead of request again
+#define ARP_CACHE_NEGATIVE_TIMEOUT                          20
+//cache lookup hash buckets, power of 2. About ARP_CACHE_SIZE_MAX / 4 keeps lookup short
+#define ARP_HASH_SIZE                                       4
+//frames waiting for resolve: per neighbor, oldest is dropped on overflow, and total. Total must be less TCPIP_MAX_FRAMES_COUNT
+#define ROUTE_QUEUE_DEPTH                                   3
+#define ROUTE_QUEUE_MAX                                     5
 
 //----------------------------- TCP/IP IP ---------------------------------------------
 #define IP_DEBUG                                            1
@@ -190,9 +217,25 @@
 #define TCP_DEBUG                                           1
 #define TCP_RETRY_COUNT                                     3
 #define TCP_KEEP_ALIVE                                      0
+//maximum retransmission timeout, keep-alive interval, ms
 #define TCP_TIMEOUT                                         30000
+//minimum retransmission timeout, ms. RFC 6298 recommends 1000, lower is faster loss recovery on LAN
+#define TCP_RTO_MIN                                         1000
+//delayed ACK timeout, ms. 0 - ACK every received segment
+#define TCP_DELAYED_ACK                                     200
+//out of order segments held per connection until gap is filled. Each holds one of TCPIP_MAX_FRAMES_COUNT
+#define TCP_OOO_MAX                                         4
+//receive window scale shift, up to 14. Window is limited by 64K << TCP_WSCALE. Rise for rx blocks above 64K
+#define TCP_WSCALE                                          0
+//timestamps option: RTT of every ACK and PAWS. Costs 12 bytes of each segment
+#define TCP_TIMESTAMPS                                      1
+//zero-copy read (tcp_read_frame) frames per connection: queued, and separately owned by user. Each holds one of TCPIP_MAX_FRAMES_COUNT
+//window is also limited by free frames of stack
+#define TCP_ZC_FRAMES                                       10
 //0 - don't limit
 #define TCP_HANDLES_LIMIT                                   10
+//TCB lookup hash buckets, power of 2. About TCP_HANDLES_LIMIT / 4 keeps lookup short
+#define TCP_HASH_SIZE                                       4
 //Low-level debug. only for development
 #define TCP_DEBUG_FLOW                                      0
 #define TCP_DEBUG_PACKETS                                   0
@@ -212,6 +255,8 @@
 #define WEBS_IO_SIZE                                        1460
 //Maximum request size. If request is bigger, it will be responded with "payload too large"
 #define WEBS_MAX_PAYLOAD                                    8192
+//IPC queue size of web server process
+#define WEBS_IPC_COUNT                                      16
 
 //---------------------------- TLS server---------------------------------------------
 //cryptography can take much space.
@@ -0,0 +1,333 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+//host headers goes first. Don't include anything, that can be overrided by userspace (stdlib.h, time.h, etc.)
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/uio.h>
+#include <signal.h>
+
+#include "kposix.h"
+#include "kernel_config.h"
+#include "../kernel.h"
+#include "../kprocess.h"
+#include "../ksystime.h"
+#include "../kirq.h"
+#include "../dbg.h"
+#include "../../userspace/svc.h"
+#include "../../userspace/process.h"
+#include <string.h>
+
+#define POSIX_CONTEXT_REGS                          6
+#define USEC_IN_SEC                                 1000000ull
+
+//older host: address is hint only, result is checked
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE                         0
+#endif //MAP_FIXED_NOREPLACE
+
+typedef struct {
+    //kernel context sp, saved on leave
+    unsigned int* kernel_sp;
+    //host main() sp. Never restored
+    unsigned int* host_sp;
+    bool kernel_mode;
+    bool switch_pending;
+    //pending trap
+    unsigned int num, param1, param2, param3;
+    void (*fn)(void);
+    //HPET
+    unsigned long long hpet_start, hpet_deadline;
+    bool hpet_active;
+    //time of event, dispatched right now. Used as HPET base
+    unsigned long long event;
+    bool in_event;
+    //next second pulse
+    unsigned long long second;
+#if (POSIX_VIRTUAL_CLOCK)
+    unsigned long long virtual_time;
+#else
+    struct timeval start;
+#endif //POSIX_VIRTUAL_CLOCK
+    unsigned int irq_pending[(IRQ_VECTORS_COUNT + 31) / 32];
+    bool irq_pending_any;
+#if (POSIX_IRQ_PROFILING)
+    //TSC at disable and longest disabled interval in ticks
+    unsigned long long irq_disabled, irq_disabled_max;
+    //TSC calibration base
+    unsigned long long tsc_start;
+    struct timeval tsc_start_tv;
+#endif //POSIX_IRQ_PROFILING
+} KPOSIX;
+
+static KPOSIX __KPOSIX;
+
+extern void posix_context_switch(unsigned int** save_sp, unsigned int* load_sp);
+extern void posix_process_exit(void);
+extern void kprocess_abnormal_exit();
+
+unsigned long long kposix_time_us()
+{
+#if (POSIX_VIRTUAL_CLOCK)
+    return __KPOSIX.virtual_time;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (unsigned long long)(tv.tv_sec - __KPOSIX.start.tv_sec) * USEC_IN_SEC + tv.tv_usec - __KPOSIX.start.tv_usec;
+#endif //POSIX_VIRTUAL_CLOCK
+}
+
+#if (POSIX_IRQ_PROFILING)
+void disable_interrupts(void)
+{
+    __KPOSIX.irq_disabled = __builtin_ia32_rdtsc();
+}
+
+void enable_interrupts(void)
+{
+    unsigned long long ticks = __builtin_ia32_rdtsc() - __KPOSIX.irq_disabled;
+    if (ticks > __KPOSIX.irq_disabled_max)
+        __KPOSIX.irq_disabled_max = ticks;
+}
+
+unsigned int kposix_irq_disabled_max_ns(void)
+{
+    struct timeval tv;
+    unsigned long long us, ticks;
+    gettimeofday(&tv, NULL);
+    us = (unsigned long long)(tv.tv_sec - __KPOSIX.tsc_start_tv.tv_sec) * USEC_IN_SEC + tv.tv_usec - __KPOSIX.tsc_start_tv.tv_usec;
+    ticks = __builtin_ia32_rdtsc() - __KPOSIX.tsc_start;
+    us = ticks ? __KPOSIX.irq_disabled_max * us * 1000 / ticks : 0;
+    __KPOSIX.irq_disabled_max = 0;
+    return (unsigned int)us;
+}
+#endif //POSIX_IRQ_PROFILING
+
+static unsigned long long kposix_hpet_now()
+{
+    return __KPOSIX.in_event ? __KPOSIX.event : kposix_time_us();
+}
+
+static void kposix_hpet_start(unsigned int value, void* param)
+{
+    __KPOSIX.hpet_start = kposix_hpet_now();
+    __KPOSIX.hpet_deadline = __KPOSIX.hpet_start + value;
+    __KPOSIX.hpet_active = true;
+}
+
+static void kposix_hpet_stop(void* param)
+{
+    __KPOSIX.hpet_active = false;
+}
+
+static unsigned int kposix_hpet_elapsed(void* param)
+{
+    return (unsigned int)(kposix_hpet_now() - __KPOSIX.hpet_start);
+}
+
+static const CB_SVC_TIMER __KPOSIX_HPET = {
+    kposix_hpet_start,
+    kposix_hpet_stop,
+    kposix_hpet_elapsed
+};
+
+static void kposix_stdout(const char *const buf, unsigned int size, void* param)
+{
+    struct iovec iov;
+    iov.iov_base = (void*)buf;
+    iov.iov_len = size;
+    writev(1, &iov, 1);
+}
+
+void fatal()
+{
+    raise(SIGABRT);
+}
+
+void kposix_irq_pend(int vector)
+{
+    __KPOSIX.irq_pending[vector / 32] |= 1u << (vector & 31);
+    __KPOSIX.irq_pending_any = true;
+}
+
+static void kposix_event(unsigned long long time, void (*handler)())
+{
+    __KPOSIX.event = time;
+    __KPOSIX.in_event = true;
+    handler();
+    __KPOSIX.in_event = false;
+}
+
+//dispatch simulated IRQs and timer events
+static void kposix_poll()
+{
+    int i, vector;
+    unsigned long long now;
+    while (__KPOSIX.irq_pending_any)
+    {
+        __KPOSIX.irq_pending_any = false;
+        for (i = 0; i < (IRQ_VECTORS_COUNT + 31) / 32; ++i)
+            while (__KPOSIX.irq_pending[i])
+            {
+                vector = __builtin_ctz(__KPOSIX.irq_pending[i]);
+                __KPOSIX.irq_pending[i] &= ~(1u << vector);
+                kirq_enter(i * 32 + vector);
+            }
+    }
+    now = kposix_time_us();
+    while (now >= __KPOSIX.second)
+    {
+        kposix_event(__KPOSIX.second, ksystime_second_pulse);
+        __KPOSIX.second += USEC_IN_SEC;
+    }
+    if (__KPOSIX.hpet_active && now >= __KPOSIX.hpet_deadline)
+    {
+        __KPOSIX.hpet_active = false;
+        kposix_event(__KPOSIX.hpet_deadline, ksystime_hpet_timeout);
+    }
+}
+
+//halt core until next event
+static void kposix_idle()
+{
+    unsigned long long next;
+#if !(POSIX_VIRTUAL_CLOCK)
+    unsigned long long now;
+    struct timeval tv;
+#endif //POSIX_VIRTUAL_CLOCK
+    next = __KPOSIX.second;
+    if (__KPOSIX.hpet_active && __KPOSIX.hpet_deadline < next)
+        next = __KPOSIX.hpet_deadline;
+#if (POSIX_VIRTUAL_CLOCK)
+    __KPOSIX.virtual_time = next;
+#else
+    now = kposix_time_us();
+    if (next > now)
+    {
+        tv.tv_sec = (next - now) / USEC_IN_SEC;
+        tv.tv_usec = (next - now) % USEC_IN_SEC;
+        select(0, NULL, NULL, NULL, &tv);
+    }
+#endif //POSIX_VIRTUAL_CLOCK
+    kposix_poll();
+}
+
+//kernel leave. Same as PendSV on cortex-m
+static void kposix_leave()
+{
+    kposix_poll();
+    if (__KPOSIX.switch_pending)
+    {
+        //halt core if no tasks
+        while (__KERNEL->next_process == NULL)
+            kposix_idle();
+        __KPOSIX.switch_pending = false;
+        __KERNEL->active_process = __KERNEL->next_process;
+        __KERNEL->next_process = NULL;
+        __GLOBAL->process = ((KPROCESS*)__KERNEL->active_process)->process;
+    }
+}
+
+static void kposix_trap()
+{
+    void (*fn)(void);
+    if (__KPOSIX.fn)
+    {
+        fn = __KPOSIX.fn;
+        __KPOSIX.fn = NULL;
+        fn();
+    }
+    else
+        svc(__KPOSIX.num, __KPOSIX.param1, __KPOSIX.param2, __KPOSIX.param3);
+}
+
+//same as svc trap. Save process context, raise to kernel context
+static void kposix_enter()
+{
+    posix_context_switch(&((KPROCESS*)__KERNEL->active_process)->sp, __KPOSIX.kernel_sp);
+}
+
+static unsigned int* kposix_stack_init(unsigned int* top, void (*fn)(void))
+{
+    unsigned long* sp = (unsigned long*)(((unsigned long)top & ~15ul) - (POSIX_CONTEXT_REGS + 2) * sizeof(unsigned long));
+    memset(sp, 0, POSIX_CONTEXT_REGS * sizeof(unsigned long));
+    sp[POSIX_CONTEXT_REGS] = (unsigned long)fn;
+    sp[POSIX_CONTEXT_REGS + 1] = (unsigned long)posix_process_exit;
+    return (unsigned int*)sp;
+}
+
+void pend_switch_context(void)
+{
+    __KPOSIX.switch_pending = true;
+}
+
+void process_setup_context(KPROCESS* process, void (*fn)(void))
+{
+    process->sp = kposix_stack_init(process->sp, fn);
+}
+
+void svc_call(unsigned int num, unsigned int param1, unsigned int param2, unsigned int param3)
+{
+    //already in kernel context: IRQ handler or kernel itself
+    if (__KPOSIX.kernel_mode)
+    {
+        svc(num, param1, param2, param3);
+        return;
+    }
+    __KPOSIX.num = num;
+    __KPOSIX.param1 = param1;
+    __KPOSIX.param2 = param2;
+    __KPOSIX.param3 = param3;
+    kposix_enter();
+}
+
+//called on return from process function
+void kposix_process_exit()
+{
+    __KPOSIX.fn = kprocess_abnormal_exit;
+    kposix_enter();
+}
+
+static void kposix_kernel()
+{
+    startup();
+    kernel_setup_dbg(kposix_stdout, NULL);
+    ksystime_hpet_setup(&__KPOSIX_HPET, NULL);
+    __KPOSIX.second = USEC_IN_SEC;
+    for (;;)
+    {
+        kposix_leave();
+        __KPOSIX.kernel_mode = false;
+        posix_context_switch(&__KPOSIX.kernel_sp, ((KPROCESS*)__KERNEL->active_process)->sp);
+        __KPOSIX.kernel_mode = true;
+        kposix_trap();
+    }
+}
+
+int main()
+{
+    //never over existing host mapping
+    if (mmap((void*)SRAM_BASE, SRAM_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0) != (void*)SRAM_BASE)
+        return 1;
+#if (KERNEL_PROFILING)
+    memset((void*)(SRAM_BASE + SRAM_SIZE - KERNEL_STACK_MAX), MAGIC_UNINITIALIZED_BYTE, KERNEL_STACK_MAX);
+#endif //KERNEL_PROFILING
+#if !(POSIX_VIRTUAL_CLOCK)
+    gettimeofday(&__KPOSIX.start, NULL);
+#endif //POSIX_VIRTUAL_CLOCK
+#if (POSIX_IRQ_PROFILING)
+    gettimeofday(&__KPOSIX.tsc_start_tv, NULL);
+    __KPOSIX.tsc_start = __builtin_ia32_rdtsc();
+#endif //POSIX_IRQ_PROFILING
+    __KPOSIX.kernel_mode = true;
+    __KPOSIX.kernel_sp = kposix_stack_init((unsigned int*)(SRAM_BASE + SRAM_SIZE), kposix_kernel);
+    //make context and sp switch
+    posix_context_switch(&__KPOSIX.host_sp, __KPOSIX.kernel_sp);
+    //never reach
+    return 0;
+}
@@ -0,0 +1,64 @@
+/*
+    RExOS - embedded RTOS
+    Copyright (c) 2011-2018, Alexey Kramarenko
+    All rights reserved.
+*/
+
+#ifndef KPOSIX_H
+#define KPOSIX_H
+
+/*
+    kposix.h - host (linux) simulation core.
+
+    Kernel is running in single host thread. There is no asynchronous interrupts: HPET, second pulse and
+    simulated IRQs are dispatched on every kernel leave and in idle loop. So, interrupts are never
+    masked and disable/enable pair is empty, unless POSIX_IRQ_PROFILING is set: then pair is only timed.
+*/
+
+#include "../../userspace/cc_macro.h"
+
+//Use virtual clock instead of host time. Time is only advanced in idle, so results are reproducible
+#ifndef POSIX_VIRTUAL_CLOCK
+#define POSIX_VIRTUAL_CLOCK                 0
+#endif //POSIX_VIRTUAL_CLOCK
+
+//Measure longest interval with interrupts disabled
+#ifndef POSIX_IRQ_PROFILING
+#define POSIX_IRQ_PROFILING                 0
+#endif //POSIX_IRQ_PROFILING
+
+#if (POSIX_IRQ_PROFILING)
+void disable_interrupts(void);
+void enable_interrupts(void);
+
+/**
+    \brief longest interrupts disabled interval since last call
+    \retval time in ns
+*/
+unsigned int kposix_irq_disabled_max_ns(void);
+#else
+__STATIC_INLINE void disable_interrupts(void)
+{
+}
+
+__STATIC_INLINE void enable_interrupts(void)
+{
+}
+#endif //POSIX_IRQ_PROFILING
+
+/**
+    \brief pend simulated IRQ
+    \details IRQ handler is called in kernel context on next kernel leave
+    \param vector: IRQ vector
+    \retval none
+*/
+void kposix_irq_pend(int vector);
+
+/**
+    \brief host uptime in us
+    \details Host or virtual, depending on POSIX_VIRTUAL_CLOCK
+    \retval time in us since start
+*/
+unsigned long long kposix_time_us();
+
+#endif // KPOSIX_H
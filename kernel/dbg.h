@@ -83,9 +83,9 @@
 #if (KERNEL_ADDRESS_CHECKING)
 #define CHECK_ADDRESS(process, address, sz)     if (!kprocess_check_address((process), (address), (sz))) \
                                                     {printk("INVALID ADDRESS at %s, line %d, process: %s\n", __FILE__, __LINE__, kprocess_name((HANDLE)(process)));    panic();}
-#define CHECK_IO_ADDRESS(process, ipc)          if (((IPC*)(ipc))->cmd & HAL_IO_FLAG) { \
-                                                    if (!kprocess_check_address((process), (HANDLE*)(ipc)->param2, sizeof(HANDLE))) \
-                                                        {printk("INVALID IO ADDRESS at %s, line %d, process: %s\n", __FILE__, __LINE__, kprocess_name((HANDLE)(process)));    panic();}
+#define CHECK_IO_ADDRESS(process, ipc)          if (((IPC*)(ipc))->cmd & HAL_IO_MODE) { \
+                                                    if (!kstdlib_check_address((void*)((IPC*)(ipc))->param2, sizeof(IO))) \
+                                                        {printk("INVALID IO ADDRESS at %s, line %d, process: %s\n", __FILE__, __LINE__, kprocess_name((HANDLE)(process)));    panic();} }
 #else
 #define CHECK_ADDRESS(process, address, size)
 #define CHECK_IO_ADDRESS(process, ipc)
@@ -15,7 +15,9 @@
 #include "kobject.h"
 #include "ksystime.h"
 #include "kstdlib.h"
+#if (KERNEL_HEAP)
 #include "kheap.h"
+#endif //KERNEL_HEAP
 
 #include "../userspace/error.h"
 #include "../userspace/core/core.h"
@@ -161,6 +163,28 @@ void svc(unsigned int num, unsigned int param1, unsigned int param2, unsigned in
         CHECK_IO_ADDRESS(process, (IPC*)param1);
         kipc_call(process, (IPC*)param1);
         break;
+    case SVC_IPC_POST_BATCH:
+        //size of batch must not overflow on address check
+        if (param2 > ((unsigned int)-1) / sizeof(IPC))
+        {
+            error(ERROR_INVALID_PARAMS);
+            break;
+        }
+        CHECK_ADDRESS(process, (IPC*)param1, param2 * sizeof(IPC));
+#if (KERNEL_ADDRESS_CHECKING)
+        {
+            unsigned int i;
+            for (i = 0; i < param2; ++i)
+            {
+                CHECK_IO_ADDRESS(process, (IPC*)param1 + i);
+            }
+        }
+#endif //KERNEL_ADDRESS_CHECKING
+        kipc_post_batch(process, (IPC*)param1, param2);
+        break;
+    case SVC_IPC_UNBLOCK:
+        kipc_unblock(process);
+        break;
     //stream related
     case SVC_STREAM_CREATE:
         CHECK_ADDRESS(process, (HANDLE*)param1, sizeof(HANDLE));
@@ -215,6 +239,9 @@ void svc(unsigned int num, unsigned int param1, unsigned int param2, unsigned in
         CHECK_ADDRESS(process, (IO**)param1, sizeof(IO*));
         *((IO**)param1) = kio_create(param2);
         break;
+    case SVC_IO_REF:
+        kio_ref((IO*)param1);
+        break;
     case SVC_IO_DESTROY:
         kio_destroy((IO*)param1);
         break;
@@ -279,6 +306,9 @@ void startup()
     //initialize main pool
     kstdlib_init();
 
+    //initialize preallocated IO pool
+    kio_init();
+
     //initilize system time
     ksystime_init();
 
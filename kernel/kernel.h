@@ -44,6 +44,7 @@
 #include "../lib/pool.h"
 #include "../userspace/rb.h"
 #include "../userspace/array.h"
+#include "../userspace/dlist.h"
 
 #ifndef IRQ_VECTORS_COUNT
 #error IRQ_VECTORS_COUNT is not decoded. Please specify it manually in Makefile
@@ -53,6 +54,8 @@
 #include "core/arm7/core_arm7.h"
 #elif defined(CORTEX_M)
 #include "kcortexm.h"
+#elif defined(POSIX)
+#include "kposix.h"
 #else
 #error MCU core is not defined or not supported
 #endif
@@ -68,8 +71,12 @@ typedef struct {
     void* next_process;
 
     int kerror;
-    //active processes
-    KPROCESS* processes;
+    //active processes. FIFO per priority, head of highest non-empty priority is running
+    KPROCESS* processes[KPROCESS_READY_PRIORITIES];
+    //non-empty priorities, 32 per group. MSB is lowest priority value in group
+    unsigned int ready_mask[KPROCESS_READY_GROUPS];
+    //non-empty groups. MSB is group 0
+    unsigned int ready_groups;
 #if (KERNEL_PROCESS_STAT)
     KPROCESS* wait_processes;
 #endif //(KERNEL_PROCESS_STAT)
@@ -102,11 +109,22 @@ typedef struct {
     //callback param for HPET timer
     void* cb_ktimer_param;
 
-    KTIMER* timers;
+    //timers of current second. Unsorted inside slot
+    KTIMER* timers[KTIMER_SLOTS];
+    //non-empty slots. MSB is slot 0
+    unsigned int timers_mask;
+    //timers of next seconds, hashed by second
+    KTIMER* timers_wheel[KTIMER_WHEEL_SIZE];
     //HPET value, set before call
     unsigned int hpet_value;
     //--------------------------- memory pools -------------------------
     ARRAY* pools;
+    //set inside kmalloc/krealloc/kfree. Only there pool walk can be split by IRQ
+    bool pools_masked;
+#if (KERNEL_IO_POOL_COUNT)
+    //free preallocated IOs
+    DLIST* io_pool;
+#endif //KERNEL_IO_POOL_COUNT
     //-------------------------- kernel objects ------------------------
     HANDLE objects[KERNEL_OBJECTS_COUNT];
 } KERNEL;
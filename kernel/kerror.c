@@ -14,7 +14,7 @@ int kget_last_error()
 
 void kerror(int kerror)
 {
-    __disable_irq();
+    disable_interrupts();
     __KERNEL->kerror = kerror;
-    __enable_irq();
+    enable_interrupts();
 }
@@ -15,43 +15,88 @@ typedef struct {
     IO* io;
     HANDLE owner;
     HANDLE granted;
+    unsigned int refs;
     bool kill_flag;
+    //allocated from preallocated IO pool
+    bool pooled;
 }KIO;
 
+#ifndef KERNEL_IO_MAX_SEGMENTS
+#define KERNEL_IO_MAX_SEGMENTS              64
+#endif //KERNEL_IO_MAX_SEGMENTS
+
+#if (KERNEL_IO_POOL_COUNT)
+#define KIO_POOL_HEADER_SIZE                ((sizeof(KIO) + 3) & ~3)
+#define KIO_POOL_ITEM_SIZE                  (KIO_POOL_HEADER_SIZE + KERNEL_IO_POOL_SIZE)
+#endif //KERNEL_IO_POOL_COUNT
+
 static void kio_destroy_internal(KIO* kio)
 {
     CLEAR_MAGIC(kio);
+#if (KERNEL_IO_POOL_COUNT)
+    if (kio->pooled)
+    {
+        disable_interrupts();
+        kio->list.next = __KERNEL->io_pool;
+        __KERNEL->io_pool = (DLIST*)kio;
+        enable_interrupts();
+        return;
+    }
+#endif //KERNEL_IO_POOL_COUNT
     kfree(kio->io);
     kfree(kio);
 }
 
-IO* kio_create(unsigned int size)
+#if (KERNEL_IO_POOL_COUNT)
+static KIO* kio_pool_get()
 {
     KIO* kio;
-    HANDLE process = kprocess_get_current();
-    kio = (KIO*)kmalloc(sizeof(KIO));
+    disable_interrupts();
+    kio = (KIO*)__KERNEL->io_pool;
     if (kio != NULL)
+        __KERNEL->io_pool = kio->list.next;
+    enable_interrupts();
+    return kio;
+}
+#endif //KERNEL_IO_POOL_COUNT
+
+IO* kio_create(unsigned int size)
+{
+    KIO* kio = NULL;
+    HANDLE process = kprocess_get_current();
+#if (KERNEL_IO_POOL_COUNT)
+    if (size + sizeof(IO) <= KERNEL_IO_POOL_SIZE && (kio = kio_pool_get()) != NULL)
     {
-        DO_MAGIC(kio, MAGIC_KIO);
-        kio->owner = kio->granted = process;
-        kio->kill_flag = false;
+        kio->pooled = true;
+        kio->io = (IO*)((uint8_t*)kio + KIO_POOL_HEADER_SIZE);
+        kio->io->size = KERNEL_IO_POOL_SIZE;
+    }
+#endif //KERNEL_IO_POOL_COUNT
+    if (kio == NULL)
+    {
+        kio = (KIO*)kmalloc(sizeof(KIO));
+        if (kio == NULL)
+            return NULL;
+        kio->pooled = false;
         kio->io = (IO*)kmalloc(size + sizeof(IO));
         if ((kio->io) == NULL)
         {
             kfree(kio);
             return NULL;
         }
-        kio->io->kio = (HANDLE)kio;
         kio->io->size = size + sizeof(IO);
     }
+    DO_MAGIC(kio, MAGIC_KIO);
+    kio->owner = kio->granted = process;
+    kio->refs = 1;
+    kio->kill_flag = false;
+    kio->io->kio = (HANDLE)kio;
+    kio->io->next = kio->io->queue = NULL;
     return kio->io;
 }
 
-bool kio_send(HANDLE process, IO* io, HANDLE receiver)
+static bool kio_send_internal(HANDLE process, KIO* kio, HANDLE receiver, bool give)
 {
-    KIO* kio = (KIO*)(io->kio);
-    //sent from untrusted environment
-    CHECK_MAGIC(kio, MAGIC_KIO);
     if (process != kio->granted)
     {
 #if (KERNEL_IO_DEBUG)
@@ -63,6 +108,20 @@ bool kio_send(HANDLE process, IO* io, HANDLE receiver)
         error(ERROR_ACCESS_DENIED);
         return false;
     }
+    //ownership transfer. Receiver is now responsible for destroy
+    if (give)
+    {
+        disable_interrupts();
+        kio->owner = kio->granted = receiver;
+        //released by previous owner, new owner gets single reference
+        if (kio->kill_flag)
+        {
+            kio->kill_flag = false;
+            kio->refs = 1;
+        }
+        enable_interrupts();
+        return true;
+    }
     //user released IO
     if ((kio->kill_flag) && (receiver == kio->owner))
     {
@@ -73,14 +132,68 @@ bool kio_send(HANDLE process, IO* io, HANDLE receiver)
     return true;
 }
 
-void kio_destroy(IO *io)
+//chain is linked by user process. Loop must not hang kernel
+static bool kio_chain_check(IO* io)
+{
+    unsigned int count;
+    for (count = 0; io != NULL; io = io->next)
+    {
+        if (++count > KERNEL_IO_MAX_SEGMENTS)
+        {
+            error(ERROR_INVALID_PARAMS);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool kio_send(HANDLE process, IO* io, HANDLE receiver, bool give)
+{
+    IO* next;
+    KIO* kio;
+    if (!kio_chain_check(io))
+        return false;
+    //sent from untrusted environment. Check whole chain before access change
+    for (next = io; next != NULL; next = next->next)
+    {
+        kio = (KIO*)(next->kio);
+        CHECK_MAGIC(kio, MAGIC_KIO);
+        if (process != kio->granted)
+            return kio_send_internal(process, kio, receiver, give);
+    }
+    //segments are granted with head
+    for (; io != NULL; io = next)
+    {
+        next = io->next;
+        kio_send_internal(process, (KIO*)(io->kio), receiver, give);
+    }
+    return true;
+}
+
+void kio_ref(IO* io)
 {
-    bool kill_flag = false;
     if (io == NULL)
         return;
     KIO* kio = (KIO*)io->kio;
     CHECK_MAGIC(kio, MAGIC_KIO);
 
+    if (kio->owner != kprocess_get_current())
+    {
+        error(ERROR_ACCESS_DENIED);
+        return;
+    }
+    disable_interrupts();
+    ++kio->refs;
+    enable_interrupts();
+}
+
+static void kio_destroy_segment(IO *io)
+{
+    bool kill_flag = false;
+    bool last;
+    KIO* kio = (KIO*)io->kio;
+    CHECK_MAGIC(kio, MAGIC_KIO);
+
     if (kio->owner != kprocess_get_current())
     {
         printk("acd1!\n: %#08x\n", kio->io);
@@ -88,14 +201,49 @@ void kio_destroy(IO *io)
         return;
     }
     disable_interrupts();
-    if (kio->granted != kio->owner)
+    last = (--kio->refs == 0);
+    if (last && (kio->granted != kio->owner))
     {
         kio->kill_flag = true;
         kill_flag = true;
     }
     enable_interrupts();
+    if (!last)
+        return;
     if (kill_flag)
         error(ERROR_BUSY);
     else
         kio_destroy_internal(kio);
 }
+
+void kio_destroy(IO *io)
+{
+    IO* next;
+    if (!kio_chain_check(io))
+        return;
+    //whole chain is destroyed. Referenced segments are only released
+    for (; io != NULL; io = next)
+    {
+        next = io->next;
+        kio_destroy_segment(io);
+    }
+}
+
+void kio_init()
+{
+#if (KERNEL_IO_POOL_COUNT)
+    int i;
+    uint8_t* pool;
+    KIO* kio;
+    //preallocated once, never returned to heap
+    pool = kmalloc(KIO_POOL_ITEM_SIZE * KERNEL_IO_POOL_COUNT);
+    if (pool == NULL)
+        return;
+    for (i = KERNEL_IO_POOL_COUNT - 1; i >= 0; --i)
+    {
+        kio = (KIO*)(pool + i * KIO_POOL_ITEM_SIZE);
+        kio->list.next = __KERNEL->io_pool;
+        __KERNEL->io_pool = (DLIST*)kio;
+    }
+#endif //KERNEL_IO_POOL_COUNT
+}
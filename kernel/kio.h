@@ -15,9 +15,13 @@
 #include <stdbool.h>
 
 IO* kio_create(unsigned int size);
+void kio_ref(IO* io);
 void kio_destroy(IO* io);
 
 //internally called from kipc
-bool kio_send(HANDLE process, IO* io, HANDLE receiver);
+bool kio_send(HANDLE process, IO* io, HANDLE receiver, bool give);
+
+//called from kernel
+void kio_init();
 
 #endif // KIO_H
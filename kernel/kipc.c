@@ -14,27 +14,70 @@
 #include "../userspace/core/core.h"
 #include "kernel.h"
 #include "kernel_config.h"
+#include <string.h>
 
 #define KIPC_ITEM(p, num)                               ((IPC*)((unsigned int)(((KPROCESS*)(p))->process) + sizeof(PROCESS) + (num) * sizeof(IPC)))
 
-void kipc_init(KPROCESS *process)
+void kipc_init(KPROCESS *process, unsigned int size)
 {
-    rb_init(&(process->process->ipcs), KERNEL_IPC_COUNT);
+    rb_init(&(process->process->ipcs), size);
+    memset(process->process->ipc_posted, 0, sizeof(process->process->ipc_posted));
+    memset(process->process->ipc_peeked, 0, sizeof(process->process->ipc_peeked));
+    process->process->ipc_blocked = false;
     process->kipc.wait_process = INVALID_HANDLE;
     process->kipc.cmd = ANY_CMD;
+    process->kipc.hwm = 0;
+    process->kipc.blocking = false;
+    process->kipc.senders = NULL;
+    process->kipc.send.process = (HANDLE)process;
 }
 
 void kipc_lock_release(KPROCESS* process)
 {
+    KPROCESS* receiver;
+    //blocked on send
+    if (process->sync_object != INVALID_HANDLE)
+    {
+        receiver = (KPROCESS*)process->sync_object;
+        disable_interrupts();
+        dlist_remove((DLIST**)&receiver->kipc.senders, (DLIST*)&process->kipc.send);
+        receiver->process->ipc_blocked = (receiver->kipc.senders != NULL);
+        enable_interrupts();
+        process->sync_object = INVALID_HANDLE;
+    }
     process->kipc.wait_process = INVALID_HANDLE;
 }
 
+void kipc_destroy(KPROCESS* process)
+{
+    KIPC_SEND* send;
+    //wakeup all blocked senders with error
+    while ((send = process->kipc.senders) != NULL)
+    {
+        disable_interrupts();
+        dlist_remove_head((DLIST**)&process->kipc.senders);
+        enable_interrupts();
+        ((KPROCESS*)send->process)->sync_object = INVALID_HANDLE;
+        kprocess_error(send->process, ERROR_SYNC_OBJECT_DESTROYED);
+        kprocess_wakeup(send->process);
+    }
+}
+
 static inline int kipc_index(HANDLE p, HANDLE wait_process, unsigned int cmd, unsigned int param1)
 {
     KPROCESS* process;
     int i;
-    unsigned int head;
+    unsigned int head, hash;
     process = (KPROCESS*)p;
+    //common case on call: response is not received yet. Don't scan queue
+    if ((wait_process != ANY_HANDLE) && (cmd != ANY_CMD))
+    {
+        hash = IPC_HASH(wait_process, cmd);
+        if (process->process->ipc_posted[hash] == process->process->ipc_peeked[hash])
+            return -1;
+    }
+    else if ((wait_process == ANY_HANDLE) && (cmd == ANY_CMD) && (param1 == ANY_HANDLE))
+        return rb_is_empty(&process->process->ipcs) ? -1 : (int)process->process->ipcs.tail;
     head = process->process->ipcs.head;
     for (i = process->process->ipcs.tail; i != head; i = RB_ROUND(&process->process->ipcs, i + 1))
         if (((KIPC_ITEM(process, i)->process == wait_process) || (wait_process == ANY_HANDLE)) && ((KIPC_ITEM(process, i)->cmd == cmd) || (cmd == ANY_CMD)) &&
@@ -49,7 +92,10 @@ static bool kipc_send(HANDLE sender, HANDLE receiver, unsigned int cmd, void* pa
     switch (cmd & HAL_MODE)
     {
     case HAL_IO_MODE:
-        res = kio_send(sender, param, receiver);
+        res = kio_send(sender, param, receiver, false);
+        break;
+    case HAL_IO_GIVE_MODE:
+        res = kio_send(sender, param, receiver, true);
         break;
     default:
         break;
@@ -57,7 +103,7 @@ static bool kipc_send(HANDLE sender, HANDLE receiver, unsigned int cmd, void* pa
     return res;
 }
 
-static void kipc_post_internal(HANDLE sender, HANDLE receiver, unsigned int cmd, unsigned int param1, unsigned int param2, unsigned int param3)
+static void kipc_post_internal(HANDLE sender, HANDLE receiver, unsigned int cmd, unsigned int param1, unsigned int param2, unsigned int param3, bool first)
 {
     IPC* cur;
     KPROCESS* r;
@@ -66,7 +112,13 @@ static void kipc_post_internal(HANDLE sender, HANDLE receiver, unsigned int cmd,
     r = (KPROCESS*)receiver;
     disable_interrupts();
     if (!rb_is_full(&r->process->ipcs))
-        index = rb_put(&r->process->ipcs);
+    {
+        //receiver is sleeping, so tail is safe to modify
+        index = first ? rb_unget(&r->process->ipcs) : rb_put(&r->process->ipcs);
+        ++r->process->ipc_posted[IPC_HASH(sender, cmd)];
+        if (rb_size(&r->process->ipcs) > r->kipc.hwm)
+            r->kipc.hwm = rb_size(&r->process->ipcs);
+    }
     enable_interrupts();
     if (index >= 0)
     {
@@ -95,17 +147,40 @@ static void kipc_post_internal(HANDLE sender, HANDLE receiver, unsigned int cmd,
     }
 }
 
-void kipc_post(HANDLE sender, IPC* ipc)
+static bool kipc_block(HANDLE sender, KPROCESS* receiver, IPC* ipc, bool call)
+{
+    KPROCESS* s = (KPROCESS*)sender;
+    //only process itself can be blocked, not kernel or IRQ. Waiting receiver will never free queue
+    if (sender == KERNEL_HANDLE || __KERNEL->context >= 0 || !s->kipc.blocking || (receiver->flags & PROCESS_FLAGS_WAITING) ||
+        !rb_is_full(&receiver->process->ipcs))
+        return false;
+    memcpy(&s->kipc.send.ipc, ipc, sizeof(IPC));
+    s->kipc.send.call = call;
+    kprocess_sleep(sender, NULL, PROCESS_SYNC_IPC, (HANDLE)receiver);
+    disable_interrupts();
+    dlist_add_tail((DLIST**)&receiver->kipc.senders, (DLIST*)&s->kipc.send);
+    receiver->process->ipc_blocked = true;
+    enable_interrupts();
+    return true;
+}
+
+//return false, if sender is blocked on full receiver queue
+static bool kipc_post_process(HANDLE sender, IPC* ipc, bool may_block, bool call)
 {
     KPROCESS* receiver;
+    bool first;
     CHECK_MAGIC((KPROCESS*)ipc->process, MAGIC_PROCESS);
+    receiver = (KPROCESS*)ipc->process;
+    //block before IO access change. If receiver is destroyed, IO is still owned by sender
+    if (may_block && ipc->process != KERNEL_HANDLE && kipc_block(sender, receiver, ipc, call))
+        return false;
 
     if (!kipc_send(sender, ipc->process, ipc->cmd, (void*)ipc->param2))
     {
         //can't be delivered. Return response back with error (if required)
         if (ipc->cmd & HAL_REQ_FLAG)
-            kipc_post_internal(ipc->process, sender, ipc->cmd & ~HAL_REQ_FLAG, ipc->param1, ipc->param2, get_last_error());
-        return;
+            kipc_post_internal(ipc->process, sender, ipc->cmd & ~HAL_REQ_FLAG, ipc->param1, ipc->param2, get_last_error(), false);
+        return true;
     }
 #ifdef EXODRIVERS
     if (ipc->process == KERNEL_HANDLE)
@@ -121,39 +196,45 @@ void kipc_post(HANDLE sender, IPC* ipc)
 
             if (kget_last_error() != ERROR_OK)
                 ipc->param3 = kget_last_error();
-            kipc_post_internal(ipc->process, sender, ipc->cmd & ~HAL_REQ_FLAG, ipc->param1, ipc->param2, ipc->param3);
+            kipc_post_internal(ipc->process, sender, ipc->cmd & ~HAL_REQ_FLAG, ipc->param1, ipc->param2, ipc->param3, false);
         }
         kerror(old_kerror);
-        return;
+        return true;
     }
 #endif //EXODRIVERS
 
-    receiver = (KPROCESS*)ipc->process;
+    first = false;
     disable_interrupts();
     if ((receiver->kipc.wait_process == sender || receiver->kipc.wait_process == ANY_HANDLE) &&
                  (receiver->kipc.cmd == ipc->cmd || receiver->kipc.cmd == ANY_CMD) &&
                  ((receiver->kipc.param1 == ipc->param1) || (receiver->kipc.param1 == ANY_HANDLE)))
     {
-        //already waiting? Wakeup him
+        //already waiting? Wakeup him. Nothing matched is queued, so put it first and receiver will not scan queue
         receiver->kipc.wait_process = INVALID_HANDLE;
+        first = true;
         kprocess_wakeup((HANDLE)receiver);
     }
     enable_interrupts();
-    kipc_post_internal(sender, ipc->process, ipc->cmd, ipc->param1, ipc->param2, ipc->param3);
+    kipc_post_internal(sender, ipc->process, ipc->cmd, ipc->param1, ipc->param2, ipc->param3, first);
+    return true;
 }
 
-void kipc_wait(HANDLE process, HANDLE wait_process, unsigned int cmd, unsigned int param1)
+void kipc_post(HANDLE sender, IPC* ipc)
 {
-    if (wait_process == process)
-    {
-#if (KERNEL_IPC_DEBUG)
-        printk("IPC deadlock: %s\n", kprocess_name(process));
-#endif //KERNEL_IPC_DEBUG
-        error(ERROR_DEADLOCK);
-        return;
-    }
-    kprocess_sleep(process, NULL, PROCESS_SYNC_IPC, INVALID_HANDLE);
+    kipc_post_process(sender, ipc, true, false);
+}
+
+void kipc_post_batch(HANDLE sender, IPC* ipcs, unsigned int count)
+{
+    unsigned int i;
+    //context switch is pended only once, on leave. Batch is never blocked, can't be resumed from the middle
+    for (i = 0; i < count; ++i)
+        kipc_post_process(sender, &ipcs[i], false, false);
+}
 
+//process is already sleeping
+static void kipc_wait_internal(HANDLE process, HANDLE wait_process, unsigned int cmd, unsigned int param1)
+{
     disable_interrupts();
     if (kipc_index(process, wait_process, cmd, param1) >= 0)
         //maybe already on queue? Wakeup process
@@ -165,11 +246,55 @@ void kipc_wait(HANDLE process, HANDLE wait_process, unsigned int cmd, unsigned i
         ((KPROCESS*)process)->kipc.param1 = param1;
     }
     enable_interrupts();
+}
 
+void kipc_wait(HANDLE process, HANDLE wait_process, unsigned int cmd, unsigned int param1)
+{
+    if (wait_process == process)
+    {
+#if (KERNEL_IPC_DEBUG)
+        printk("IPC deadlock: %s\n", kprocess_name(process));
+#endif //KERNEL_IPC_DEBUG
+        error(ERROR_DEADLOCK);
+        return;
+    }
+    kprocess_sleep(process, NULL, PROCESS_SYNC_IPC, INVALID_HANDLE);
+    kipc_wait_internal(process, wait_process, cmd, param1);
+}
+
+void kipc_unblock(HANDLE process)
+{
+    KPROCESS* receiver = (KPROCESS*)process;
+    KIPC_SEND* send;
+    int err;
+    while ((send = receiver->kipc.senders) != NULL && !rb_is_full(&receiver->process->ipcs))
+    {
+        disable_interrupts();
+        dlist_remove_head((DLIST**)&receiver->kipc.senders);
+        enable_interrupts();
+        ((KPROCESS*)send->process)->sync_object = INVALID_HANDLE;
+        //IO access is changed only on delivery. Failure is sender's error, not receiver's
+        err = get_last_error();
+        if (!kipc_send(send->process, process, send->ipc.cmd, (void*)send->ipc.param2))
+        {
+            kprocess_error(send->process, get_last_error());
+            error(err);
+            kprocess_wakeup(send->process);
+            continue;
+        }
+        //receiver is running now, no need to check it's wait state
+        kipc_post_internal(send->process, process, send->ipc.cmd, send->ipc.param1, send->ipc.param2, send->ipc.param3, false);
+        //sender still sleeping, now waiting for response
+        if (send->call)
+            kipc_wait_internal(send->process, process, send->ipc.cmd & ~HAL_REQ_FLAG, send->ipc.param1);
+        else
+            kprocess_wakeup(send->process);
+    }
+    receiver->process->ipc_blocked = (receiver->kipc.senders != NULL);
 }
 
 void kipc_call(HANDLE process, IPC* ipc)
 {
-    kipc_post(process, ipc);
-    kipc_wait(process, ipc->process, ipc->cmd & ~HAL_REQ_FLAG, ipc->param1);
+    if (kipc_post_process(process, ipc, true, true))
+        kipc_wait(process, ipc->process, ipc->cmd & ~HAL_REQ_FLAG, ipc->param1);
 }
@@ -11,12 +11,15 @@
 #include "kprocess.h"
 
 //called from kprocess
-void kipc_init(KPROCESS* process);
+void kipc_init(KPROCESS* process, unsigned int size);
 void kipc_lock_release(KPROCESS* process);
+void kipc_destroy(KPROCESS* process);
 
 void kipc_post(HANDLE sender, IPC* ipc);
+void kipc_post_batch(HANDLE sender, IPC* ipcs, unsigned int count);
 void kipc_wait(HANDLE process, HANDLE wait_process, unsigned int cmd, unsigned int param1);
 void kipc_call(HANDLE process, IPC* ipc);
+void kipc_unblock(HANDLE process);
 
 
 #endif // KIPC_H
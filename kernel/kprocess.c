@@ -23,9 +23,9 @@
 
 #if (KERNEL_PROFILING)
 #if (KERNEL_PROCESS_STAT)
-const char *const STAT_LINE="-------------------------------------------------------------------------\n";
+const char *const STAT_LINE="-------------------------------------------------------------------------------\n";
 #else
-const char *const STAT_LINE="---------------------------------------------------------------\n";
+const char *const STAT_LINE="---------------------------------------------------------------------\n";
 #endif
 const char *const DAMAGED="     !!!DAMAGED!!!     ";
 #endif //(KERNEL_PROFILING)
@@ -36,54 +36,88 @@ static inline void switch_to_process(KPROCESS* kprocess)
     pend_switch_context();
 }
 
-void kprocess_add_to_active_list(KPROCESS* kprocess)
+static inline unsigned int kprocess_level(KPROCESS* kprocess)
+{
+    if (kprocess->base_priority >= KPROCESS_READY_PRIORITIES - 1)
+        return KPROCESS_READY_PRIORITIES - 1;
+    return kprocess->base_priority;
+}
+
+static inline KPROCESS* kprocess_ready_head()
+{
+    unsigned int group;
+    if (__KERNEL->ready_groups == 0)
+        return NULL;
+    group = __builtin_clz(__KERNEL->ready_groups);
+    return __KERNEL->processes[(group << 5) + __builtin_clz(__KERNEL->ready_mask[group])];
+}
+
+static void kprocess_ready_insert(KPROCESS* kprocess)
 {
-    bool found = false;
-    KPROCESS* kprocess_to_save = kprocess;
     DLIST_ENUM de;
     KPROCESS* cur;
+    unsigned int level = kprocess_level(kprocess);
+    __KERNEL->ready_mask[level >> 5] |= (1u << 31) >> (level & 31);
+    __KERNEL->ready_groups |= (1u << 31) >> (level >> 5);
+    //last level is shared by all lowest priorities, sorted. Walk is limited by number of such processes
+    if (level == KPROCESS_READY_PRIORITIES - 1)
+    {
+        dlist_enum_start((DLIST**)&__KERNEL->processes[level], &de);
+        while (dlist_enum(&de, (DLIST**)&cur))
+            if (kprocess->base_priority < cur->base_priority)
+            {
+                dlist_add_before((DLIST**)&__KERNEL->processes[level], (DLIST*)cur, (DLIST*)kprocess);
+                return;
+            }
+    }
+    dlist_add_tail((DLIST**)&__KERNEL->processes[level], (DLIST*)kprocess);
+}
+
+static void kprocess_ready_remove(KPROCESS* kprocess)
+{
+    unsigned int level = kprocess_level(kprocess);
+    dlist_remove((DLIST**)&__KERNEL->processes[level], (DLIST*)kprocess);
+    if (__KERNEL->processes[level] == NULL)
+    {
+        __KERNEL->ready_mask[level >> 5] &= ~((1u << 31) >> (level & 31));
+        if (__KERNEL->ready_mask[level >> 5] == 0)
+            __KERNEL->ready_groups &= ~((1u << 31) >> (level >> 5));
+    }
+}
+
+void kprocess_add_to_active_list(KPROCESS* kprocess)
+{
+    KPROCESS* active = kprocess_ready_head();
 #if (KERNEL_PROCESS_STAT)
     ksystime_get_uptime_internal(&kprocess->uptime_start);
     dlist_remove((DLIST**)&__KERNEL->wait_processes, (DLIST*)kprocess);
 #endif
+    kprocess_ready_insert(kprocess);
     //return from core HALT
-    if (__KERNEL->processes == NULL)
+    if (active == NULL)
     {
-        dlist_add_head((DLIST**)&__KERNEL->processes, (DLIST*)kprocess);
         switch_to_process(kprocess);
         return;
     }
-    if (kprocess->base_priority < __KERNEL->processes->base_priority)
+    if (kprocess->base_priority < active->base_priority)
     {
-        kprocess_to_save = __KERNEL->processes;
-        dlist_remove_head((DLIST**)&__KERNEL->processes);
-        dlist_add_head((DLIST**)&__KERNEL->processes, (DLIST*)kprocess);
+        //preempted process goes after all processes with same priority
+        kprocess_ready_remove(active);
+        kprocess_ready_insert(active);
         switch_to_process(kprocess);
     }
-
-    //find place for saved kprocess
-    dlist_enum_start((DLIST**)&__KERNEL->processes, &de);
-    while (dlist_enum(&de, (DLIST**)&cur))
-        if (kprocess_to_save->base_priority < cur->base_priority)
-        {
-            dlist_add_before((DLIST**)&__KERNEL->processes, (DLIST*)cur, (DLIST*)kprocess_to_save);
-            found = true;
-            break;
-        }
-    if (!found)
-        dlist_add_tail((DLIST**)&__KERNEL->processes, (DLIST*)kprocess_to_save);
 }
 
 void kprocess_remove_from_active_list(KPROCESS* kprocess)
 {
     //freeze active task
-    if (kprocess == __KERNEL->processes)
+    if (kprocess == kprocess_ready_head())
     {
-        dlist_remove_head((DLIST**)&__KERNEL->processes);
-        switch_to_process(__KERNEL->processes);
+        kprocess_ready_remove(kprocess);
+        switch_to_process(kprocess_ready_head());
     }
     else
-        dlist_remove((DLIST**)&__KERNEL->processes, (DLIST*)kprocess);
+        kprocess_ready_remove(kprocess);
 #if (KERNEL_PROCESS_STAT)
     dlist_add_tail((DLIST**)&__KERNEL->wait_processes, (DLIST*)kprocess);
     SYSTIME time;
@@ -134,13 +168,17 @@ void kprocess_abnormal_exit()
 
 HANDLE kprocess_create(const REX* rex)
 {
-    unsigned int sys_size;
+    unsigned int sys_size, ipc_size;
     KPROCESS* process = kmalloc(sizeof(KPROCESS));
     //allocate kprocess object
     if (process != NULL)
     {
         memset(process, 0, sizeof(KPROCESS));
-        sys_size = sizeof(PROCESS) + KERNEL_IPC_COUNT * sizeof(IPC);
+        ipc_size = rex->ipc_size ? rex->ipc_size : KERNEL_IPC_COUNT;
+        //more IPCs can't be counted per hash
+        if (ipc_size > IPC_SIZE_MAX)
+            ipc_size = IPC_SIZE_MAX;
+        sys_size = sizeof(PROCESS) + ipc_size * sizeof(IPC);
         if ((rex->flags & REX_FLAG_PERSISTENT_NAME) == 0)
             sys_size += strlen(rex->name) + 1;
         sys_size = (sys_size + 3) & ~3;
@@ -156,7 +194,8 @@ HANDLE kprocess_create(const REX* rex)
             process->sp = (void*)((unsigned int)process->process + rex->size + sys_size);
             ksystime_timer_init_internal(&process->timer, kprocess_timeout, process);
             process->size = rex->size + sys_size;
-            kipc_init(process);
+            kipc_init(process, ipc_size);
+            process->kipc.blocking = (rex->flags & REX_FLAG_IPC_BLOCKING) != 0;
             process->process->stdout = process->process->stdin = INVALID_HANDLE;
             process->process->error = ERROR_OK;
 
@@ -164,8 +203,8 @@ HANDLE kprocess_create(const REX* rex)
                 process->process->name = rex->name;
             else
             {
-                strcpy(((char*)(process->process)) + sizeof(PROCESS) + KERNEL_IPC_COUNT * sizeof(IPC), rex->name);
-                process->process->name = (((const char*)(process->process)) + sizeof(PROCESS)) + KERNEL_IPC_COUNT * sizeof(IPC);
+                strcpy(((char*)(process->process)) + sizeof(PROCESS) + ipc_size * sizeof(IPC), rex->name);
+                process->process->name = (((const char*)(process->process)) + sizeof(PROCESS)) + ipc_size * sizeof(IPC);
             }
             pool_init(&process->process->pool, (void*)(process->process) + sys_size);
 
@@ -232,12 +271,15 @@ void kprocess_set_priority(HANDLE p, unsigned int priority)
     disable_interrupts();
     if (process->base_priority != priority)
     {
-        process->base_priority = priority;
+        //level depends on priority, so remove before change
         if ((process->flags & PROCESS_MODE_MASK) == PROCESS_MODE_ACTIVE)
         {
             kprocess_remove_from_active_list(process);
+            process->base_priority = priority;
             kprocess_add_to_active_list(process);
         }
+        else
+            process->base_priority = priority;
     }
     enable_interrupts();
 }
@@ -293,6 +335,7 @@ void kprocess_destroy(HANDLE p)
     dlist_remove((DLIST**)&__KERNEL->wait_processes, (DLIST*)process);
 #endif
     enable_interrupts();
+    kipc_destroy(process);
     //release memory, occupied by kprocess
     kfree(process->process);
     kfree(process);
@@ -339,10 +382,15 @@ bool kprocess_check_address(HANDLE p, void* addr, unsigned int size)
 
 void kprocess_init(const REX* rex)
 {
+    int i;
     __KERNEL->next_process = NULL;
     __KERNEL->active_process = NULL;
     __KERNEL->kerror = ERROR_OK;
-    dlist_clear((DLIST**)&__KERNEL->processes);
+    for (i = 0; i < KPROCESS_READY_PRIORITIES; ++i)
+        dlist_clear((DLIST**)&__KERNEL->processes[i]);
+    for (i = 0; i < KPROCESS_READY_GROUPS; ++i)
+        __KERNEL->ready_mask[i] = 0;
+    __KERNEL->ready_groups = 0;
 #if (KERNEL_PROCESS_STAT)
     dlist_clear((DLIST**)&__KERNEL->wait_processes);
 #endif
@@ -382,6 +430,7 @@ void process_stat(KPROCESS* kprocess)
     printk("%03d     ", kprocess->base_priority);
     printk("%4b  ", stack_used((unsigned int)pool_free_ptr(&kprocess->process->pool), (unsigned int)kprocess->process + kprocess->size));
     printk("%4b ", kprocess->size);
+    printk("%2d/%-2d ", kprocess->kipc.hwm, kprocess->process->ipcs.size - 1);
 
     if (err != ERROR_OK)
         printk(DAMAGED);
@@ -420,7 +469,7 @@ static inline void kernel_stat()
         kpool = kpool_at(i);
         kpool_stat(i, &stat);
         printk("%#08X                         ", kpool->base);
-        printk("%4b ", kpool->size);
+        printk("%4b       ", kpool->size);
 
         if (err != ERROR_OK)
         {
@@ -445,7 +494,7 @@ static inline void kernel_stat()
     printk("%-20.20s         ", __KERNEL_NAME);
 
     printk("%4b  ", stack_used(SRAM_BASE + SRAM_SIZE - KERNEL_STACK_MAX, SRAM_BASE + SRAM_SIZE));
-    printk("%4b ", total_size);
+    printk("%4b       ", total_size);
 
     if (damaged)
         printk(DAMAGED);
@@ -466,20 +515,24 @@ static inline void kernel_stat()
 void kprocess_info()
 {
     int cnt = 0;
+    unsigned int i;
     DLIST_ENUM de;
     KPROCESS* cur;
 #if (KERNEL_PROCESS_STAT)
-    printk("\n    name           priority  stack  size   used       free        uptime\n");
+    printk("\n    name           priority  stack  size  ipc    used       free        uptime\n");
 #else
-    printk("\n    name           priority  stack  size   used       free\n");
+    printk("\n    name           priority  stack  size  ipc    used       free\n");
 #endif
     printk(STAT_LINE);
     disable_interrupts();
-    dlist_enum_start((DLIST**)&__KERNEL->processes, &de);
-    while (dlist_enum(&de, (DLIST**)&cur))
+    for (i = 0; i < KPROCESS_READY_PRIORITIES; ++i)
     {
-        process_stat(cur);
-        ++cnt;
+        dlist_enum_start((DLIST**)&__KERNEL->processes[i], &de);
+        while (dlist_enum(&de, (DLIST**)&cur))
+        {
+            process_stat(cur);
+            ++cnt;
+        }
     }
 #if (KERNEL_PROCESS_STAT)
     dlist_enum_start((DLIST**)&__KERNEL->wait_processes, &de);
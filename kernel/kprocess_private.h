@@ -5,9 +5,15 @@
 #include "../userspace/systime.h"
 #include "../userspace/types.h"
 #include "../userspace/irq.h"
+#include "../userspace/ipc.h"
 #include "kernel_config.h"
 #include "dbg.h"
 
+//one FIFO of active processes per priority. All priorities from KPROCESS_READY_PRIORITIES - 1 and above share
+//last FIFO, which is sorted on insert. Only lowest priority processes (like init) are walked there
+#define KPROCESS_READY_PRIORITIES                               256
+#define KPROCESS_READY_GROUPS                                   (KPROCESS_READY_PRIORITIES / 32)
+
 typedef struct {
     int error;
     IRQ handler;
@@ -18,18 +24,42 @@ typedef struct {
 #endif
 }KIRQ;
 
+//timers of current second are split on slots by usec, all other - hashed by second
+#define KTIMER_SLOTS                                            16
+#define KTIMER_SLOT_SHIFT                                       16
+//must be power of 2
+#define KTIMER_WHEEL_SIZE                                       16
+
 typedef struct _KTIMER {
     DLIST list;
     SYSTIME time;
     void (*callback)(void*);
     void* param;
     bool active;
+    //slot list, timer is in
+    struct _KTIMER** head;
 } KTIMER;
 
+typedef struct {
+    DLIST list;
+    HANDLE process;
+    //wait for response after post
+    bool call;
+    IPC ipc;
+}KIPC_SEND;
+
 typedef struct {
     //process, we are waiting for. Can be INVALID_HANDLE, then waiting from any process
     HANDLE wait_process;
     unsigned int cmd, param1;
+    //max IPC queue usage
+    unsigned int hwm;
+    //sleep on full receiver queue instead of overflow
+    bool blocking;
+    //senders, blocked on our full queue
+    KIPC_SEND* senders;
+    //our IPC, if we are blocked on receiver queue
+    KIPC_SEND send;
 }KIPC;
 
 typedef struct _KPROCESS {
@@ -39,6 +39,18 @@ static int kpool_idx(void* ptr)
     return -1;
 }
 
+bool kstdlib_check_address(void* addr, unsigned int size)
+{
+    int idx;
+    KPOOL* kpool;
+    if (addr == NULL)
+        return true;
+    if ((idx = kpool_idx(addr)) < 0)
+        return false;
+    kpool = kpool_at(idx);
+    return (unsigned int)addr + size <= kpool->base + kpool->size;
+}
+
 void* kmalloc_internal(size_t size)
 {
     int idx;
@@ -56,12 +68,37 @@ void* kmalloc_internal(size_t size)
     return NULL;
 }
 
+//pools are searched with interrupts disabled. Long walk is split here, pending IRQ may change pool
+static void kpools_yield(void)
+{
+    //called from pool outside of kmalloc/krealloc/kfree, interrupts state is unknown
+    if (!__KERNEL->pools_masked)
+        return;
+    enable_interrupts();
+    disable_interrupts();
+}
+
+static inline bool kpools_mask()
+{
+    bool masked;
+    disable_interrupts();
+    masked = __KERNEL->pools_masked;
+    __KERNEL->pools_masked = true;
+    return masked;
+}
+
+static inline void kpools_unmask(bool masked)
+{
+    __KERNEL->pools_masked = masked;
+    enable_interrupts();
+}
+
 void* kmalloc(size_t size)
 {
     void* res;
-    disable_interrupts();
+    bool masked = kpools_mask();
     res = kmalloc_internal(size);
-    enable_interrupts();
+    kpools_unmask(masked);
     return res;
 }
 
@@ -102,9 +139,9 @@ void* krealloc_internal(void* ptr, size_t size)
 void* krealloc(void* ptr, size_t size)
 {
     void* res;
-    disable_interrupts();
+    bool masked = kpools_mask();
     res = krealloc_internal(ptr, size);
-    enable_interrupts();
+    kpools_unmask(masked);
     return res;
 }
 
@@ -121,9 +158,9 @@ void kfree_internal(void *ptr)
 
 void kfree(void *ptr)
 {
-    disable_interrupts();
+    bool masked = kpools_mask();
     kfree_internal(ptr);
-    enable_interrupts();
+    kpools_unmask(masked);
 }
 
 const STD_MEM __KSTD_MEM = {
@@ -161,6 +198,7 @@ void kstdlib_init()
     kpool0 = ((const LIB_ARRAY*)__GLOBAL->lib[LIB_ID_ARRAY])->lib_array_append(&ar, &__KSTD_MEM_STARTUP);
     __KERNEL->pools = ar;
     memcpy(&kpool0->pool, &pool, sizeof(POOL));
+    kpool0->pool.yield = kpools_yield;
     kpool0->base = SRAM_BASE + KERNEL_GLOBAL_SIZE + sizeof(KERNEL);
     kpool0->size = SRAM_SIZE - KERNEL_GLOBAL_SIZE - sizeof(KERNEL);
 }
@@ -184,5 +222,6 @@ void kstdlib_add_pool(unsigned int base, unsigned int size)
     kpool->base = base;
     kpool->size = size;
     pool_init(&kpool->pool, (void*)base);
+    kpool->pool.yield = kpools_yield;
     enable_interrupts();
 }
@@ -28,6 +28,7 @@ void* kmalloc_internal(size_t size);
 
 /**
     \brief allocate memory in system pool
+    \details Interrupts are disabled, but long search of pool is split to let pending IRQ in.
     \param size: data size in bytes
     \retval pointer on success, NULL on out of memory conditiion
 */
@@ -72,6 +73,8 @@ extern const STD_MEM __KSTD_MEM;
 void kstdlib_init();
 KPOOL* kpool_at(unsigned int idx);
 void kpool_stat(unsigned int idx, POOL_STAT* stat);
+//IO is allocated by kernel. NULL is allowed
+bool kstdlib_check_address(void* addr, unsigned int size);
 
 //called from svc
 void kstdlib_add_pool(unsigned int base, unsigned int size);
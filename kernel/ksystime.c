@@ -61,34 +61,100 @@ void ksystime_get_uptime(SYSTIME* res)
     enable_interrupts();
 }
 
+static inline void ksystime_timer_insert(KTIMER* timer)
+{
+    unsigned int slot;
+    if (timer->time.sec > __KERNEL->uptime.sec)
+        timer->head = &__KERNEL->timers_wheel[timer->time.sec & (KTIMER_WHEEL_SIZE - 1)];
+    else
+    {
+        //overdue timers goes to first slot
+        slot = (timer->time.sec == __KERNEL->uptime.sec) ? (timer->time.usec >> KTIMER_SLOT_SHIFT) : 0;
+        timer->head = &__KERNEL->timers[slot];
+        __KERNEL->timers_mask |= (1u << 31) >> slot;
+    }
+    dlist_add_tail((DLIST**)timer->head, (DLIST*)timer);
+}
+
+static inline void ksystime_timer_remove(KTIMER* timer)
+{
+    unsigned int slot;
+    dlist_remove((DLIST**)timer->head, (DLIST*)timer);
+    if ((*timer->head == NULL) && (timer->head >= __KERNEL->timers) && (timer->head < __KERNEL->timers + KTIMER_SLOTS))
+    {
+        slot = timer->head - __KERNEL->timers;
+        __KERNEL->timers_mask &= ~((1u << 31) >> slot);
+    }
+}
+
+//called on second pulse with interrupts disabled
+static inline void ksystime_next_second()
+{
+    unsigned int slot;
+    DLIST_ENUM de;
+    KTIMER* cur;
+    KTIMER** head;
+    //timers of last second are overdue now. Generally there are no one
+    while (__KERNEL->timers_mask & ~(1u << 31))
+    {
+        slot = __builtin_clz(__KERNEL->timers_mask & ~(1u << 31));
+        while ((cur = __KERNEL->timers[slot]) != NULL)
+        {
+            dlist_remove_head((DLIST**)&__KERNEL->timers[slot]);
+            cur->head = &__KERNEL->timers[0];
+            dlist_add_tail((DLIST**)&__KERNEL->timers[0], (DLIST*)cur);
+        }
+        __KERNEL->timers_mask = (__KERNEL->timers_mask & ~((1u << 31) >> slot)) | (1u << 31);
+    }
+    //load this second timers from wheel
+    head = &__KERNEL->timers_wheel[__KERNEL->uptime.sec & (KTIMER_WHEEL_SIZE - 1)];
+    dlist_enum_start((DLIST**)head, &de);
+    while (dlist_enum(&de, (DLIST**)&cur))
+        if (cur->time.sec <= __KERNEL->uptime.sec)
+        {
+            dlist_remove_current_inside_enum((DLIST**)head, &de, (DLIST*)cur);
+            ksystime_timer_insert(cur);
+        }
+}
+
 static inline void find_shoot_next()
 {
-    volatile KTIMER* timers_to_shoot = NULL;
-    volatile KTIMER* cur;
+    KTIMER* timers_to_shoot = NULL;
+    KTIMER* cur;
+    KTIMER* next;
+    DLIST_ENUM de;
     SYSTIME uptime;
+    unsigned int slot;
 
     disable_interrupts();
-    while (__KERNEL->timers)
+    //only first non-empty slot is checked, all other timers are later
+    while (__KERNEL->timers_mask)
     {
+        slot = __builtin_clz(__KERNEL->timers_mask);
         ksystime_get_uptime_internal(&uptime);
-        if (systime_compare(&__KERNEL->timers->time, &uptime) >= 0)
+        next = NULL;
+        dlist_enum_start((DLIST**)&__KERNEL->timers[slot], &de);
+        while (dlist_enum(&de, (DLIST**)&cur))
         {
-            cur = __KERNEL->timers;
-            cur->active = false;
-            dlist_remove_head((DLIST**)&__KERNEL->timers);
-            dlist_add_tail((DLIST**)&timers_to_shoot, (DLIST*)cur);
+            if (systime_compare(&cur->time, &uptime) >= 0)
+            {
+                dlist_remove_current_inside_enum((DLIST**)&__KERNEL->timers[slot], &de, (DLIST*)cur);
+                cur->active = false;
+                dlist_add_tail((DLIST**)&timers_to_shoot, (DLIST*)cur);
+            }
+            else if ((next == NULL) || (systime_compare(&cur->time, &next->time) > 0))
+                next = cur;
         }
         //add to this second events
-        else if (__KERNEL->timers->time.sec == uptime.sec)
+        if (next != NULL)
         {
             __KERNEL->uptime.usec += __KERNEL->cb_ktimer.elapsed(__KERNEL->cb_ktimer_param);
             __KERNEL->cb_ktimer.stop(__KERNEL->cb_ktimer_param);
-            __KERNEL->hpet_value = __KERNEL->timers->time.usec - __KERNEL->uptime.usec;
+            __KERNEL->hpet_value = next->time.usec - __KERNEL->uptime.usec;
             __KERNEL->cb_ktimer.start(__KERNEL->hpet_value, __KERNEL->cb_ktimer_param);
             break;
         }
-        else
-            break;
+        __KERNEL->timers_mask &= ~((1u << 31) >> slot);
     }
     enable_interrupts();
     while (timers_to_shoot)
@@ -107,6 +173,7 @@ void ksystime_second_pulse()
     __KERNEL->cb_ktimer.stop(__KERNEL->cb_ktimer_param);
     __KERNEL->cb_ktimer.start(FREE_RUN, __KERNEL->cb_ktimer_param);
     __KERNEL->uptime.usec = 0;
+    ksystime_next_second();
     enable_interrupts();
 
     find_shoot_next();
@@ -144,34 +211,26 @@ void ksystime_hpet_setup(const CB_SVC_TIMER *cb_ktimer, void *cb_ktimer_param)
 void ksystime_timer_start_internal(KTIMER* timer, SYSTIME *time)
 {
     SYSTIME uptime;
-    DLIST_ENUM de;
-    KTIMER* cur;
-    bool found = false;
+    bool first;
     ksystime_get_uptime(&uptime);
     timer->time.sec = time->sec;
     timer->time.usec = time->usec;
     systime_add(&uptime, &timer->time, &timer->time);
     disable_interrupts();
-    dlist_enum_start((DLIST**)&__KERNEL->timers, &de);
-    while (dlist_enum(&de, (DLIST**)&cur))
-        if (systime_compare(&cur->time, &timer->time) < 0)
-        {
-            dlist_add_before((DLIST**)&__KERNEL->timers, (DLIST*)cur, (DLIST*)timer);
-            found = true;
-            break;
-        }
-    if (!found)
-        dlist_add_tail((DLIST**)&__KERNEL->timers, (DLIST*)timer);
+    ksystime_timer_insert(timer);
     timer->active = true;
+    //HPET reprogramming is only required if timer is in first slot
+    first = (__KERNEL->timers_mask != 0) && (timer->head == &__KERNEL->timers[__builtin_clz(__KERNEL->timers_mask)]);
     enable_interrupts();
-    find_shoot_next();
+    if (first)
+        find_shoot_next();
 }
 
 void ksystime_timer_stop_internal(KTIMER* timer)
 {
     if (timer->active)
     {
-        dlist_remove((DLIST**)&__KERNEL->timers, (DLIST*)timer);
+        ksystime_timer_remove(timer);
         timer->active = false;
     }
 }
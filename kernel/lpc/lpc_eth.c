@@ -55,6 +55,9 @@
 #define ETH_TDES1_TBS2_POS                          16
 #define ETH_TDES1_TBS2_MASK                         (0x1fff << 16)
 
+#define ETH_DMA_BUS_MODE_DSL_POS                    2
+#define ETH_DMA_BUS_MODE_DSL_MASK                   (0x1f << 2)
+
 
 #define ETH_RDES0_OWN                               (1 << 31)
 #define ETH_RDES0_AFM                               (1 << 30)
@@ -132,27 +135,86 @@ uint16_t eth_phy_read(uint8_t phy_addr, uint8_t reg_addr)
     return LPC_ETHERNET->MAC_MII_DATA & 0xffff;
 }
 
+static inline unsigned int lpc_eth_rx_next(unsigned int i)
+{
+    return (i + 1 < ETH_RX_RING_SIZE) ? i + 1 : 0;
+}
+
+#if (ETH_RX_POLLING)
+//collect frames, released by DMA, in one chain. Rx interrupt stays masked, while stack is polling
+static void lpc_eth_rx_batch(EXO* exo, unsigned int budget, bool irq)
+{
+    IO* head = NULL;
+    IO* tail = NULL;
+    IO* io;
+    uint32_t ctl;
+    unsigned int count = 0;
+    unsigned int flags = 0;
+    //frame, released after scan, will raise status again
+    LPC_ETHERNET->DMA_STAT = ETHERNET_DMA_STAT_RI_Msk;
+    while ((count < budget) && ((io = exo->eth.rx[exo->eth.cur_rx]) != NULL) && (((ctl = exo->eth.rx_des[exo->eth.cur_rx].ctl) & ETH_RDES0_OWN) == 0))
+    {
+        io->data_size = (ctl & ETH_RDES0_FL_MASK) >> ETH_RDES0_FL_POS;
+        if (tail == NULL)
+            head = io;
+        else
+            tail->next = io;
+        tail = io;
+        exo->eth.rx[exo->eth.cur_rx] = NULL;
+        exo->eth.cur_rx = lpc_eth_rx_next(exo->eth.cur_rx);
+        ++count;
+    }
+    //nothing is pending: don't mask on spurious interrupt
+    if (count && (irq || (count >= ETH_RX_POLL_THRESHOLD)))
+    {
+        exo->eth.rx_polling = true;
+        LPC_ETHERNET->DMA_INT_EN &= ~ETHERNET_DMA_INT_EN_RIE_Msk;
+        flags |= ETH_RX_POLL;
+    }
+    else
+    {
+        //ring is drained, back to interrupt mode
+        __disable_irq();
+        exo->eth.rx_polling = false;
+        LPC_ETHERNET->DMA_INT_EN |= ETHERNET_DMA_INT_EN_RIE_Msk;
+        __enable_irq();
+    }
+    if (head == NULL)
+        return;
+    if (irq)
+        iio_complete_ex(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, ETH_POLL), exo->eth.phy_addr, head, flags);
+    else
+        kexo_io_ex(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, ETH_POLL), exo->eth.phy_addr, head, flags);
+}
+#endif //ETH_RX_POLLING
+
+static inline unsigned int lpc_eth_tx_next(unsigned int i)
+{
+    return (i + 1 < ETH_TX_RING_SIZE) ? i + 1 : 0;
+}
+
+//TX descriptors are in ring mode, last one closes ring
+static inline uint32_t lpc_eth_tx_ter(unsigned int i)
+{
+    return (i == ETH_TX_RING_SIZE - 1) ? ETH_TDES0_TER : 0;
+}
+
+static unsigned int lpc_eth_des_index(ETH_DESCRIPTOR* des, unsigned int addr, unsigned int size)
+{
+    unsigned int i = (addr - (unsigned int)des) / sizeof(ETH_DESCRIPTOR);
+    return i < size ? i : 0;
+}
+
 static void lpc_eth_flush(EXO* exo)
 {
     IO* io;
+    unsigned int i;
 
     //flush TxFIFO controller
     LPC_ETHERNET->DMA_OP_MODE |= ETHERNET_DMA_OP_MODE_FTF_Msk;
     while(LPC_ETHERNET->DMA_OP_MODE & ETHERNET_DMA_OP_MODE_FTF_Msk) {}
-#if (ETH_DOUBLE_BUFFERING)
-    int i;
-    for (i = 0; i < 2; ++i)
+    for (i = 0; i < ETH_RX_RING_SIZE; ++i)
     {
-        exo->eth.rx_des[0].size = ETH_RDES1_RCH;
-        exo->eth.rx_des[0].buf2_ndes = &exo->eth.rx_des[1];
-        exo->eth.rx_des[1].size = ETH_RDES1_RCH;
-        exo->eth.rx_des[1].buf2_ndes = &exo->eth.rx_des[0];
-
-        exo->eth.tx_des[0].ctl = ETH_TDES0_TCH | ETH_TDES0_IC;
-        exo->eth.tx_des[0].buf2_ndes = &exo->eth.tx_des[1];
-        exo->eth.tx_des[1].ctl = ETH_TDES0_TCH | ETH_TDES0_IC;
-        exo->eth.tx_des[1].buf2_ndes = &exo->eth.tx_des[0];
-
         __disable_irq();
         exo->eth.rx_des[i].ctl = 0;
         io = exo->eth.rx[i];
@@ -160,32 +222,26 @@ static void lpc_eth_flush(EXO* exo)
         __enable_irq();
         if (io != NULL)
             kexo_io_ex(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), exo->eth.phy_addr, io, ERROR_IO_CANCELLED);
-
+    }
+    for (i = 0; i < ETH_TX_RING_SIZE; ++i)
+    {
         __disable_irq();
-        exo->eth.tx_des[i].ctl = ETH_TDES0_TCH | ETH_TDES0_IC;;
+        exo->eth.tx_des[i].ctl = lpc_eth_tx_ter(i) | ETH_TDES0_IC;
         io = exo->eth.tx[i];
         exo->eth.tx[i] = NULL;
         __enable_irq();
         if (io != NULL)
             kexo_io_ex(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_WRITE), exo->eth.phy_addr, io, ERROR_IO_CANCELLED);
     }
-    exo->eth.cur_rx = (LPC_ETHERNET->DMA_CURHOST_REC_BUF == (unsigned int)(&exo->eth.rx_des[0]) ? 0 : 1);
-    exo->eth.cur_tx = (LPC_ETHERNET->DMA_CURHOST_TRANS_BUF == (unsigned int)(&exo->eth.tx_des[0]) ? 0 : 1);
-#else
-    __disable_irq();
-    io = exo->eth.rx;
-    exo->eth.rx = NULL;
-    __enable_irq();
-    if (io != NULL)
-        kexo_io_ex(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), exo->eth.phy_addr, io, ERROR_IO_CANCELLED);
-
+#if (ETH_RX_POLLING)
     __disable_irq();
-    io = exo->eth.tx;
-    exo->eth.tx = NULL;
+    exo->eth.rx_polling = false;
+    LPC_ETHERNET->DMA_INT_EN |= ETHERNET_DMA_INT_EN_RIE_Msk;
     __enable_irq();
-    if (io != NULL)
-        kexo_io_ex(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_WRITE), exo->eth.phy_addr, io, ERROR_IO_CANCELLED);
-#endif
+#endif //ETH_RX_POLLING
+    //DMA continues from descriptor, where it was stopped
+    exo->eth.cur_rx = exo->eth.post_rx = lpc_eth_des_index(exo->eth.rx_des, LPC_ETHERNET->DMA_CURHOST_REC_DES, ETH_RX_RING_SIZE);
+    exo->eth.cur_tx = exo->eth.post_tx = lpc_eth_des_index(exo->eth.tx_des, LPC_ETHERNET->DMA_CURHOST_TRANS_DES, ETH_TX_RING_SIZE);
 }
 
 static void lpc_eth_conn_check(EXO* exo)
@@ -242,59 +298,37 @@ static void lpc_eth_conn_check(EXO* exo)
 
 void lpc_eth_isr(int vector, void* param)
 {
-#if (ETH_DOUBLE_BUFFERING)
-    int i;
-#endif //ETH_DOUBLE_BUFFERING
     uint32_t sta;
     EXO* exo = (EXO*)param;
     sta = LPC_ETHERNET->DMA_STAT;
+    //status is cleared before ring scan: frame, completed during scan, will raise it again
+#if (ETH_RX_POLLING)
+    //ring is owned by poll, while rx interrupt is masked
+    if ((sta & ETHERNET_DMA_STAT_RI_Msk) && !exo->eth.rx_polling)
+        lpc_eth_rx_batch(exo, ETH_RX_RING_SIZE, true);
+#else
     if (sta & ETHERNET_DMA_STAT_RI_Msk)
     {
-#if (ETH_DOUBLE_BUFFERING)
-        for (i = 0; i < 2; ++i)
-        {
-            if ((exo->eth.rx[exo->eth.cur_rx] != NULL) && ((exo->eth.rx_des[exo->eth.cur_rx].ctl & ETH_RDES0_OWN) == 0))
-            {
-                exo->eth.rx[exo->eth.cur_rx]->data_size = (exo->eth.rx_des[exo->eth.cur_rx].ctl & ETH_RDES0_FL_MASK) >> ETH_RDES0_FL_POS;
-                iio_complete(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), exo->eth.phy_addr, exo->eth.rx[exo->eth.cur_rx]);
-                exo->eth.rx[exo->eth.cur_rx] = NULL;
-                exo->eth.cur_rx = (exo->eth.cur_rx + 1) & 1;
-            }
-            else
-                break;
-        }
-#else
-        if (exo->eth.rx != NULL)
+        LPC_ETHERNET->DMA_STAT = ETHERNET_DMA_STAT_RI_Msk;
+        //complete all frames, released by DMA
+        while ((exo->eth.rx[exo->eth.cur_rx] != NULL) && ((exo->eth.rx_des[exo->eth.cur_rx].ctl & ETH_RDES0_OWN) == 0))
         {
-            exo->eth.rx->data_size = (exo->eth.rx_des.ctl & ETH_RDES0_FL_MASK) >> ETH_RDES0_FL_POS;
-            iio_complete(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), exo->eth.phy_addr, exo->eth.rx);
-            exo->eth.rx = NULL;
+            exo->eth.rx[exo->eth.cur_rx]->data_size = (exo->eth.rx_des[exo->eth.cur_rx].ctl & ETH_RDES0_FL_MASK) >> ETH_RDES0_FL_POS;
+            iio_complete(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), exo->eth.phy_addr, exo->eth.rx[exo->eth.cur_rx]);
+            exo->eth.rx[exo->eth.cur_rx] = NULL;
+            exo->eth.cur_rx = lpc_eth_rx_next(exo->eth.cur_rx);
         }
-#endif
-        LPC_ETHERNET->DMA_STAT = ETHERNET_DMA_STAT_RI_Msk;
     }
+#endif //ETH_RX_POLLING
     if (sta & ETHERNET_DMA_STAT_TI_Msk)
     {
-#if (ETH_DOUBLE_BUFFERING)
-        for (i = 0; i < 2; ++i)
-        {
-            if ((exo->eth.tx[exo->eth.cur_tx] != NULL) && ((exo->eth.tx_des[exo->eth.cur_tx].ctl & ETH_TDES0_OWN) == 0))
-            {
-                iio_complete(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_WRITE), exo->eth.phy_addr, exo->eth.tx[exo->eth.cur_tx]);
-                exo->eth.tx[exo->eth.cur_tx] = NULL;
-                exo->eth.cur_tx = (exo->eth.cur_tx + 1) & 1;
-            }
-            else
-                break;
-        }
-#else
-        if (exo->eth.tx != NULL)
+        LPC_ETHERNET->DMA_STAT = ETHERNET_DMA_STAT_TI_Msk;
+        while ((exo->eth.tx[exo->eth.cur_tx] != NULL) && ((exo->eth.tx_des[exo->eth.cur_tx].ctl & ETH_TDES0_OWN) == 0))
         {
-            iio_complete(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_WRITE), exo->eth.phy_addr, exo->eth.tx);
-            exo->eth.tx = NULL;
+            iio_complete(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_WRITE), exo->eth.phy_addr, exo->eth.tx[exo->eth.cur_tx]);
+            exo->eth.tx[exo->eth.cur_tx] = NULL;
+            exo->eth.cur_tx = lpc_eth_tx_next(exo->eth.cur_tx);
         }
-#endif
-        LPC_ETHERNET->DMA_STAT = ETHERNET_DMA_STAT_TI_Msk;
     }
     LPC_ETHERNET->DMA_STAT = ETHERNET_DMA_STAT_NIS_Msk;
 }
@@ -326,7 +360,7 @@ static void lpc_eth_close(EXO* exo)
 
 static inline void lpc_eth_open(EXO* exo, unsigned int phy_addr, ETH_CONN_TYPE conn, HANDLE tcpip)
 {
-    unsigned int clock;
+    unsigned int clock, i;
 
     exo->eth.timer = ksystime_soft_timer_create(KERNEL_HANDLE, 0, HAL_ETH);
     exo->eth.timeout = false;
@@ -357,32 +391,27 @@ static inline void lpc_eth_open(EXO* exo, unsigned int phy_addr, ETH_CONN_TYPE c
     //reset DMA
     LPC_ETHERNET->DMA_BUS_MODE |= ETHERNET_DMA_BUS_MODE_SWR_Msk;
     while(LPC_ETHERNET->DMA_BUS_MODE & ETHERNET_DMA_BUS_MODE_SWR_Msk) {}
+    //8 words descriptors: skip 4 words between unchained (ring) descriptors
+    LPC_ETHERNET->DMA_BUS_MODE = (LPC_ETHERNET->DMA_BUS_MODE & ~ETH_DMA_BUS_MODE_DSL_MASK) | (4 << ETH_DMA_BUS_MODE_DSL_POS);
 
-    //setup descriptors
-#if (ETH_DOUBLE_BUFFERING)
-    memset(exo->eth.tx_des, 0, sizeof(ETH_DESCRIPTOR) * 2);
-    memset(exo->eth.rx_des, 0, sizeof(ETH_DESCRIPTOR) * 2);
-    exo->eth.rx_des[0].size = ETH_RDES1_RCH;
-    exo->eth.rx_des[0].buf2_ndes = &exo->eth.rx_des[1];
-    exo->eth.rx_des[1].size = ETH_RDES1_RCH;
-    exo->eth.rx_des[1].buf2_ndes = &exo->eth.rx_des[0];
-
-    exo->eth.tx_des[0].ctl = ETH_TDES0_TCH | ETH_TDES0_IC;
-    exo->eth.tx_des[0].buf2_ndes = &exo->eth.tx_des[1];
-    exo->eth.tx_des[1].ctl = ETH_TDES0_TCH | ETH_TDES0_IC;
-    exo->eth.tx_des[1].buf2_ndes = &exo->eth.tx_des[0];
-
-    exo->eth.cur_rx = exo->eth.cur_tx = 0;
-#else
-    memset(&exo->eth.tx_des, 0, sizeof(ETH_DESCRIPTOR));
-    memset(&exo->eth.rx_des, 0, sizeof(ETH_DESCRIPTOR));
-    exo->eth.rx_des.size = ETH_RDES1_RCH;
-    exo->eth.rx_des.buf2_ndes = &exo->eth.rx_des;
-    exo->eth.tx_des.ctl = ETH_TDES0_TCH;
-    exo->eth.tx_des.buf2_ndes = &exo->eth.tx_des;
-#endif
-    LPC_ETHERNET->DMA_TRANS_DES_ADDR = (unsigned int)&exo->eth.tx_des;
-    LPC_ETHERNET->DMA_REC_DES_ADDR = (unsigned int)&exo->eth.rx_des;
+    //setup descriptors. RX descriptors are chained
+    memset(exo->eth.tx_des, 0, sizeof(ETH_DESCRIPTOR) * ETH_TX_RING_SIZE);
+    memset(exo->eth.rx_des, 0, sizeof(ETH_DESCRIPTOR) * ETH_RX_RING_SIZE);
+    for (i = 0; i < ETH_RX_RING_SIZE; ++i)
+    {
+        exo->eth.rx_des[i].size = ETH_RDES1_RCH;
+        exo->eth.rx_des[i].buf2_ndes = &exo->eth.rx_des[lpc_eth_rx_next(i)];
+    }
+    //TX descriptors are in ring mode: buf2 is used for second segment of IO chain
+    for (i = 0; i < ETH_TX_RING_SIZE; ++i)
+        exo->eth.tx_des[i].ctl = lpc_eth_tx_ter(i) | ETH_TDES0_IC;
+    exo->eth.cur_rx = exo->eth.post_rx = 0;
+    exo->eth.cur_tx = exo->eth.post_tx = 0;
+#if (ETH_RX_POLLING)
+    exo->eth.rx_polling = false;
+#endif //ETH_RX_POLLING
+    LPC_ETHERNET->DMA_TRANS_DES_ADDR = (unsigned int)exo->eth.tx_des;
+    LPC_ETHERNET->DMA_REC_DES_ADDR = (unsigned int)exo->eth.rx_des;
 
     //setup MAC
     LPC_ETHERNET->MAC_ADDR0_HIGH = (exo->eth.mac.u8[5] << 8) | (exo->eth.mac.u8[4] << 0) |  (1 << 31);
@@ -428,93 +457,80 @@ static inline void lpc_eth_open(EXO* exo, unsigned int phy_addr, ETH_CONN_TYPE c
 
 static inline void lpc_eth_read(EXO* exo, IPC* ipc)
 {
-    IO* io = (IO*)ipc->param2;
+    unsigned int i;
+    IO* io;
     if (!exo->eth.connected)
     {
         kerror(ERROR_NOT_ACTIVE);
         return;
     }
-#if (ETH_DOUBLE_BUFFERING)
-    int i = -1;
-    uint8_t cur_rx = exo->eth.cur_rx;
-
-    if (exo->eth.rx[cur_rx] == NULL)
-        i = cur_rx;
-    else if (exo->eth.rx[(cur_rx + 1) & 1] == NULL)
-        i = (cur_rx + 1) & 1;
-    if (i < 0)
+    //chain of IOs can be posted at once
+    for (io = (IO*)ipc->param2; io != NULL; io = (IO*)ipc->param2)
     {
-        kerror(ERROR_IN_PROGRESS);
-        return;
-    }
-    exo->eth.rx_des[i].buf1 = io_data(io);
-    exo->eth.rx_des[i].size &= ~ETH_RDES1_RBS1_MASK;
-    exo->eth.rx_des[i].size |= (((ipc->param3 + 3) << ETH_RDES1_RBS1_POS) & ETH_RDES1_RBS1_MASK);
-    __disable_irq();
-    exo->eth.rx[i] = io;
-    //give descriptor to DMA
-    exo->eth.rx_des[i].ctl = ETH_RDES0_OWN;
-    __enable_irq();
-#else
-    if (exo->eth.rx != NULL)
-    {
-        kerror(ERROR_IN_PROGRESS);
-        return;
+        i = exo->eth.post_rx;
+        if (exo->eth.rx[i] != NULL)
+        {
+            //rest of chain is returned
+            kerror(ERROR_IN_PROGRESS);
+            break;
+        }
+        ipc->param2 = (unsigned int)io->next;
+        io->next = NULL;
+        exo->eth.rx_des[i].buf1 = io_data(io);
+        exo->eth.rx_des[i].size &= ~ETH_RDES1_RBS1_MASK;
+        exo->eth.rx_des[i].size |= (((ipc->param3 + 3) << ETH_RDES1_RBS1_POS) & ETH_RDES1_RBS1_MASK);
+        __disable_irq();
+        exo->eth.rx[i] = io;
+        //give descriptor to DMA
+        exo->eth.rx_des[i].ctl = ETH_RDES0_OWN;
+        __enable_irq();
+        exo->eth.post_rx = lpc_eth_rx_next(i);
     }
-    exo->eth.rx_des.buf1 = io_data(io);
-    exo->eth.rx = io;
-    exo->eth.rx_des.size &= ~ETH_RDES1_RBS1_MASK;
-    exo->eth.rx_des.size |= (((ipc->param3 + 3) << ETH_RDES1_RBS1_POS) & ETH_RDES1_RBS1_MASK);
-    //give descriptor to DMA
-    exo->eth.rx_des.ctl = ETH_RDES0_OWN;
-#endif
     //enable and poll DMA. Value is doesn't matter
     LPC_ETHERNET->DMA_REC_POLL_DEMAND = 1;
-    kerror(ERROR_SYNC);
+    if (io == NULL)
+        kerror(ERROR_SYNC);
+}
+
+static inline uint32_t lpc_eth_tx_size(IO* io)
+{
+    uint32_t size = (io->data_size << ETH_TDES1_TBS1_POS) & ETH_TDES1_TBS1_MASK;
+    if (io->next != NULL)
+        size |= (io->next->data_size << ETH_TDES1_TBS2_POS) & ETH_TDES1_TBS2_MASK;
+    return size;
 }
 
 static inline void lpc_eth_write(EXO* exo, IPC* ipc)
 {
+    unsigned int i;
     IO* io = (IO*)ipc->param2;
     if (!exo->eth.connected)
     {
         kerror(ERROR_NOT_ACTIVE);
         return;
     }
-#if (ETH_DOUBLE_BUFFERING)
-    int i = -1;
-    uint8_t cur_tx = exo->eth.cur_tx;
-
-    if (exo->eth.tx[cur_tx] == NULL)
-        i = cur_tx;
-    else if (exo->eth.tx[(cur_tx + 1) & 1] == NULL)
-        i = (cur_tx + 1) & 1;
-    if (i < 0)
+    //only 2 segments per descriptor
+    if ((io->next != NULL) && (io->next->next != NULL))
+    {
+        kerror(ERROR_NOT_SUPPORTED);
+        return;
+    }
+    i = exo->eth.post_tx;
+    if (exo->eth.tx[i] != NULL)
     {
         kerror(ERROR_IN_PROGRESS);
         return;
     }
     exo->eth.tx_des[i].buf1 = io_data(io);
-    exo->eth.tx_des[i].size = ((io->data_size << ETH_TDES1_TBS1_POS) & ETH_TDES1_TBS1_MASK);
-    exo->eth.tx_des[i].ctl = ETH_TDES0_TCH | ETH_TDES0_FS | ETH_TDES0_LS | ETH_TDES0_IC;
+    exo->eth.tx_des[i].buf2_ndes = io->next != NULL ? io_data(io->next) : NULL;
+    exo->eth.tx_des[i].size = lpc_eth_tx_size(io);
+    exo->eth.tx_des[i].ctl = lpc_eth_tx_ter(i) | ETH_TDES0_FS | ETH_TDES0_LS | ETH_TDES0_IC;
     __disable_irq();
     exo->eth.tx[i] = io;
     //give descriptor to DMA
     exo->eth.tx_des[i].ctl |= ETH_TDES0_OWN;
     __enable_irq();
-#else
-    if (exo->eth.tx != NULL)
-    {
-        kerror(ERROR_IN_PROGRESS);
-        return;
-    }
-    exo->eth.tx_des.buf1 = io_data(io);
-    exo->eth.tx = io;
-    exo->eth.tx_des.size = ((io->data_size << ETH_TDES1_TBS1_POS) & ETH_TDES1_TBS1_MASK);
-    //give descriptor to DMA
-    exo->eth.tx_des.ctl = ETH_TDES0_TCH | ETH_TDES0_FS | ETH_TDES0_LS | ETH_TDES0_IC;
-    exo->eth.tx_des.ctl |= ETH_TDES0_OWN;
-#endif
+    exo->eth.post_tx = lpc_eth_tx_next(i);
     //enable and poll DMA. Value is doesn't matter
     LPC_ETHERNET->DMA_TRANS_POLL_DEMAND = 1;
     kerror(ERROR_SYNC);
@@ -534,16 +550,15 @@ static inline void lpc_eth_get_mac(EXO* exo, IPC* ipc)
 
 void lpc_eth_init(EXO* exo)
 {
+    unsigned int i;
     exo->eth.tcpip = INVALID_HANDLE;
     exo->eth.conn = ETH_NO_LINK;
     exo->eth.connected = false;
     exo->eth.mac.u32.hi = exo->eth.mac.u32.lo = 0;
-#if (ETH_DOUBLE_BUFFERING)
-    exo->eth.rx[0] = exo->eth.tx[0] = NULL;
-    exo->eth.rx[1] = exo->eth.tx[1] = NULL;
-#else
-    exo->eth.rx = exo->eth.tx = NULL;
-#endif
+    for (i = 0; i < ETH_RX_RING_SIZE; ++i)
+        exo->eth.rx[i] = NULL;
+    for (i = 0; i < ETH_TX_RING_SIZE; ++i)
+        exo->eth.tx[i] = NULL;
     exo->eth.processing = 0;
 }
 
@@ -569,6 +584,12 @@ void lpc_eth_request(EXO* exo, IPC* ipc)
     case IPC_WRITE:
         lpc_eth_write(exo, ipc);
         break;
+#if (ETH_RX_POLLING)
+    case ETH_POLL:
+        if (exo->eth.rx_polling)
+            lpc_eth_rx_batch(exo, ipc->param2, false);
+        break;
+#endif //ETH_RX_POLLING
     case IPC_TIMEOUT:
         if (exo->eth.processing > 1)
             exo->eth.timeout = true;
@@ -581,6 +602,14 @@ void lpc_eth_request(EXO* exo, IPC* ipc)
     case ETH_GET_MAC:
         lpc_eth_get_mac(exo, ipc);
         break;
+    case ETH_GET_FEATURES:
+        //checksums are calculated by stack
+        ipc->param2 = 0;
+        break;
+    case ETH_GET_RING_SIZE:
+        ipc->param2 = ETH_RX_RING_SIZE;
+        ipc->param3 = ETH_TX_RING_SIZE;
+        break;
     default:
         kerror(ERROR_NOT_SUPPORTED);
         break;
@@ -35,25 +35,21 @@ typedef struct {
 #pragma pack(pop)
 
 typedef struct {
-#if (ETH_DOUBLE_BUFFERING)
-    IO* tx[2];
-    IO* rx[2];
-    ETH_DESCRIPTOR tx_des[2], rx_des[2];
-#else
-    ETH_DESCRIPTOR tx_des, rx_des;
-    IO* tx;
-    IO* rx;
-#endif
+    IO* tx[ETH_TX_RING_SIZE];
+    IO* rx[ETH_RX_RING_SIZE];
+    ETH_DESCRIPTOR tx_des[ETH_TX_RING_SIZE], rx_des[ETH_RX_RING_SIZE];
     ETH_CONN_TYPE conn;
     HANDLE tcpip, timer;
     bool connected;
     MAC mac;
     uint8_t phy_addr;
-#if (ETH_DOUBLE_BUFFERING)
-    uint8_t cur_rx, cur_tx;
-#endif
+    //cur - next to complete, post - next to give to DMA
+    uint8_t cur_rx, cur_tx, post_rx, post_tx;
     unsigned int processing;
     bool timeout;
+#if (ETH_RX_POLLING)
+    bool rx_polling;
+#endif //ETH_RX_POLLING
 } ETH_DRV;
 
 void lpc_eth_init(EXO* exo);
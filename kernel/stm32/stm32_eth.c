@@ -19,6 +19,12 @@
 #include <string.h>
 #include "stm32_exo_private.h"
 
+#if (ETH_CHECKSUM_OFFLOAD)
+#define ETH_TDES_CIC                    ETH_TDES_CIC_ALL
+#else
+#define ETH_TDES_CIC                    ETH_TDES_CIC_DISABLE
+#endif //ETH_CHECKSUM_OFFLOAD
+
 void eth_phy_write(uint8_t phy_addr, uint8_t reg_addr, uint16_t data)
 {
     while (ETH->MACMIIAR & ETH_MACMIIAR_MB) {}
@@ -39,16 +45,106 @@ uint16_t eth_phy_read(uint8_t phy_addr, uint8_t reg_addr)
     return ETH->MACMIIDR & ETH_MACMIIDR_MD;
 }
 
+static inline unsigned int stm32_eth_rx_next(unsigned int i)
+{
+    return (i + 1 < ETH_RX_RING_SIZE) ? i + 1 : 0;
+}
+
+#if (ETH_RX_POLLING)
+//collect frames, released by DMA, in one chain. Rx interrupt stays masked, while stack is polling
+static void stm32_eth_rx_batch(EXO* exo, unsigned int budget, bool irq)
+{
+    IO* head = NULL;
+    IO* tail = NULL;
+    IO* io;
+    uint32_t ctl;
+#if (ETH_CHECKSUM_OFFLOAD)
+    ETH_RX_STACK* stack;
+#endif //ETH_CHECKSUM_OFFLOAD
+    unsigned int count = 0;
+    unsigned int flags = 0;
+    //frame, released after scan, will raise status again
+    ETH->DMASR = ETH_DMASR_RS;
+    while ((count < budget) && ((io = exo->eth.rx[exo->eth.cur_rx]) != NULL) && (((ctl = exo->eth.rx_des[exo->eth.cur_rx].ctl) & ETH_RDES_OWN) == 0))
+    {
+        io->data_size = (ctl & ETH_RDES_FL_MASK) >> ETH_RDES_FL_POS;
+#if (ETH_CHECKSUM_OFFLOAD)
+        //IPv4/IPv6 frame without header or payload checksum error. Flag of every frame is on its stack
+        stack = io_push(io, sizeof(ETH_RX_STACK));
+        stack->flags = ((ctl & (ETH_RDES_FT | ETH_RDES_IPHCE | ETH_RDES_PCE)) == ETH_RDES_FT) ? ETH_RX_CHECKSUM_OK : 0;
+#endif //ETH_CHECKSUM_OFFLOAD
+        if (tail == NULL)
+            head = io;
+        else
+            tail->next = io;
+        tail = io;
+        exo->eth.rx[exo->eth.cur_rx] = NULL;
+        exo->eth.cur_rx = stm32_eth_rx_next(exo->eth.cur_rx);
+        ++count;
+    }
+    //nothing is pending: don't mask on spurious interrupt
+    if (count && (irq || (count >= ETH_RX_POLL_THRESHOLD)))
+    {
+        exo->eth.rx_polling = true;
+        ETH->DMAIER &= ~ETH_DMAIER_RIE;
+        flags |= ETH_RX_POLL;
+    }
+    else
+    {
+        //ring is drained, back to interrupt mode
+        __disable_irq();
+        exo->eth.rx_polling = false;
+        ETH->DMAIER |= ETH_DMAIER_RIE;
+        __enable_irq();
+    }
+    if (head == NULL)
+        return;
+    if (irq)
+        iio_complete_ex(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, ETH_POLL), exo->eth.phy_addr, head, flags);
+    else
+        kexo_io_ex(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, ETH_POLL), exo->eth.phy_addr, head, flags);
+}
+#endif //ETH_RX_POLLING
+
+static inline void stm32_eth_rx_complete(EXO* exo, IO* io, uint32_t ctl)
+{
+    unsigned int flags = 0;
+    io->data_size = (ctl & ETH_RDES_FL_MASK) >> ETH_RDES_FL_POS;
+#if (ETH_CHECKSUM_OFFLOAD)
+    //IPv4/IPv6 frame without header or payload checksum error
+    if ((ctl & (ETH_RDES_FT | ETH_RDES_IPHCE | ETH_RDES_PCE)) == ETH_RDES_FT)
+        flags = ETH_RX_CHECKSUM_OK;
+#endif //ETH_CHECKSUM_OFFLOAD
+    iio_complete_ex(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), exo->eth.phy_addr, io, io->data_size | flags);
+}
+
+
+static inline unsigned int stm32_eth_tx_next(unsigned int i)
+{
+    return (i + 1 < ETH_TX_RING_SIZE) ? i + 1 : 0;
+}
+
+//TX descriptors are in ring mode, last one closes ring
+static inline uint32_t stm32_eth_tx_ter(unsigned int i)
+{
+    return (i == ETH_TX_RING_SIZE - 1) ? ETH_TDES_TER : 0;
+}
+
+static unsigned int stm32_eth_des_index(ETH_DESCRIPTORS* des, unsigned int addr, unsigned int size)
+{
+    unsigned int i = (addr - (unsigned int)des) / sizeof(ETH_DESCRIPTORS);
+    return i < size ? i : 0;
+}
+
 static void stm32_eth_flush(EXO* exo)
 {
     IO* io;
+    unsigned int i;
 
     //flush TxFIFO controller
     ETH->DMAOMR |= ETH_DMAOMR_FTF;
     while(ETH->DMAOMR & ETH_DMAOMR_FTF) {}
-#if (ETH_DOUBLE_BUFFERING)
-    int i;
-    for (i = 0; i < 2; ++i)
+    for (i = 0; i < ETH_RX_RING_SIZE; ++i)
     {
         __disable_irq();
         exo->eth.rx_des[i].ctl = 0;
@@ -57,32 +153,26 @@ static void stm32_eth_flush(EXO* exo)
         __enable_irq();
         if (io != NULL)
             kexo_io_ex(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), exo->eth.phy_addr, io, ERROR_IO_CANCELLED);
-
+    }
+    for (i = 0; i < ETH_TX_RING_SIZE; ++i)
+    {
         __disable_irq();
-        exo->eth.tx_des[i].ctl = 0;
+        exo->eth.tx_des[i].ctl = stm32_eth_tx_ter(i);
         io = exo->eth.tx[i];
         exo->eth.tx[i] = NULL;
         __enable_irq();
         if (io != NULL)
             kexo_io_ex(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_WRITE), exo->eth.phy_addr, io, ERROR_IO_CANCELLED);
     }
-    exo->eth.cur_rx = (ETH->DMACHRDR == (unsigned int)(&exo->eth.rx_des[0]) ? 0 : 1);
-    exo->eth.cur_tx = (ETH->DMACHTDR == (unsigned int)(&exo->eth.tx_des[0]) ? 0 : 1);
-#else
+#if (ETH_RX_POLLING)
     __disable_irq();
-    io = exo->eth.rx;
-    exo->eth.rx = NULL;
+    exo->eth.rx_polling = false;
+    ETH->DMAIER |= ETH_DMAIER_RIE;
     __enable_irq();
-    if (io != NULL)
-        kexo_io_ex(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), exo->eth.phy_addr, io, ERROR_IO_CANCELLED);
-
-    __disable_irq();
-    io = exo->eth.tx;
-    exo->eth.tx = NULL;
-    __enable_irq();
-    if (io != NULL)
-        kexo_io_ex(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_WRITE), exo->eth.phy_addr, io, ERROR_IO_CANCELLED);
-#endif
+#endif //ETH_RX_POLLING
+    //DMA continues from descriptor, where it was stopped
+    exo->eth.cur_rx = exo->eth.post_rx = stm32_eth_des_index(exo->eth.rx_des, ETH->DMACHRDR, ETH_RX_RING_SIZE);
+    exo->eth.cur_tx = exo->eth.post_tx = stm32_eth_des_index(exo->eth.tx_des, ETH->DMACHTDR, ETH_TX_RING_SIZE);
 }
 
 static void stm32_eth_conn_check(EXO* exo)
@@ -132,57 +222,36 @@ static void stm32_eth_conn_check(EXO* exo)
 
 void stm32_eth_isr(int vector, void* param)
 {
-    int i;
     uint32_t sta;
     EXO* exo = param;
     sta = ETH->DMASR;
+    //status is cleared before ring scan: frame, completed during scan, will raise it again
+#if (ETH_RX_POLLING)
+    //ring is owned by poll, while rx interrupt is masked
+    if ((sta & ETH_DMASR_RS) && !exo->eth.rx_polling)
+        stm32_eth_rx_batch(exo, ETH_RX_RING_SIZE, true);
+#else
     if (sta & ETH_DMASR_RS)
     {
-#if (ETH_DOUBLE_BUFFERING)
-        for (i = 0; i < 2; ++i)
-        {
-            if ((exo->eth.rx[exo->eth.cur_rx] != NULL) && ((exo->eth.rx_des[exo->eth.cur_rx].ctl & ETH_RDES_OWN) == 0))
-            {
-                exo->eth.rx[exo->eth.cur_rx]->data_size = (exo->eth.rx_des[exo->eth.cur_rx].ctl & ETH_RDES_FL_MASK) >> ETH_RDES_FL_POS;
-                iio_complete(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), exo->eth.phy_addr, exo->eth.rx[exo->eth.cur_rx]);
-                exo->eth.rx[exo->eth.cur_rx] = NULL;
-                exo->eth.cur_rx = (exo->eth.cur_rx + 1) & 1;
-            }
-            else
-                break;
-        }
-#else
-        if (exo->eth.rx != NULL)
+        ETH->DMASR = ETH_DMASR_RS;
+        //complete all frames, released by DMA
+        while ((exo->eth.rx[exo->eth.cur_rx] != NULL) && ((exo->eth.rx_des[exo->eth.cur_rx].ctl & ETH_RDES_OWN) == 0))
         {
-            exo->eth.rx->data_size = (exo->eth.rx_des.ctl & ETH_RDES_FL_MASK) >> ETH_RDES_FL_POS;
-            iio_complete(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), exo->eth.phy_addr, exo->eth.rx);
-            exo->eth.rx = NULL;
+            stm32_eth_rx_complete(exo, exo->eth.rx[exo->eth.cur_rx], exo->eth.rx_des[exo->eth.cur_rx].ctl);
+            exo->eth.rx[exo->eth.cur_rx] = NULL;
+            exo->eth.cur_rx = stm32_eth_rx_next(exo->eth.cur_rx);
         }
-#endif
-        ETH->DMASR = ETH_DMASR_RS;
     }
+#endif //ETH_RX_POLLING
     if (sta & ETH_DMASR_TS)
     {
-#if (ETH_DOUBLE_BUFFERING)
-        for (i = 0; i < 2; ++i)
-        {
-            if ((exo->eth.tx[exo->eth.cur_tx] != NULL) && ((exo->eth.tx_des[exo->eth.cur_tx].ctl & ETH_TDES_OWN) == 0))
-            {
-                iio_complete(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_WRITE), exo->eth.phy_addr, exo->eth.tx[exo->eth.cur_tx]);
-                exo->eth.tx[exo->eth.cur_tx] = NULL;
-                exo->eth.cur_tx = (exo->eth.cur_tx + 1) & 1;
-            }
-            else
-                break;
-        }
-#else
-        if (exo->eth.tx != NULL)
+        ETH->DMASR = ETH_DMASR_TS;
+        while ((exo->eth.tx[exo->eth.cur_tx] != NULL) && ((exo->eth.tx_des[exo->eth.cur_tx].ctl & ETH_TDES_OWN) == 0))
         {
-            iio_complete(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_WRITE), exo->eth.phy_addr, exo->eth.tx);
-            exo->eth.tx = NULL;
+            iio_complete(exo->eth.tcpip, HAL_IO_CMD(HAL_ETH, IPC_WRITE), exo->eth.phy_addr, exo->eth.tx[exo->eth.cur_tx]);
+            exo->eth.tx[exo->eth.cur_tx] = NULL;
+            exo->eth.cur_tx = stm32_eth_tx_next(exo->eth.cur_tx);
         }
-#endif
-        ETH->DMASR = ETH_DMASR_TS;
     }
     ETH->DMASR = ETH_DMASR_NIS;
 }
@@ -213,7 +282,7 @@ static void stm32_eth_close(EXO* exo)
 
 static inline void stm32_eth_open(EXO* exo, unsigned int phy_addr, ETH_CONN_TYPE conn, HANDLE tcpip)
 {
-    unsigned int clock;
+    unsigned int clock, i;
 
     exo->eth.phy_addr = phy_addr;
     exo->eth.cc = 0;
@@ -230,33 +299,31 @@ static inline void stm32_eth_open(EXO* exo, unsigned int phy_addr, ETH_CONN_TYPE
     ETH->DMABMR |= ETH_DMABMR_SR;
     while(ETH->DMABMR & ETH_DMABMR_SR) {}
 
-    //setup DMA
-#if (ETH_DOUBLE_BUFFERING)
-    exo->eth.rx_des[0].ctl = 0;
-    exo->eth.rx_des[0].size = ETH_RDES_RCH;
-    exo->eth.rx_des[0].buf2_ndes = &exo->eth.rx_des[1];
-    exo->eth.rx_des[1].ctl = 0;
-    exo->eth.rx_des[1].size = ETH_RDES_RCH;
-    exo->eth.rx_des[1].buf2_ndes = &exo->eth.rx_des[0];
-
-    exo->eth.tx_des[0].ctl = ETH_TDES_TCH | ETH_TDES_IC;
-    exo->eth.tx_des[0].buf2_ndes = &exo->eth.tx_des[1];
-    exo->eth.tx_des[1].ctl = ETH_TDES_TCH | ETH_TDES_IC;
-    exo->eth.tx_des[1].buf2_ndes = &exo->eth.tx_des[0];
-
-    exo->eth.cur_rx = exo->eth.cur_tx = 0;
-#else
-    exo->eth.rx_des.ctl = 0;
-    exo->eth.rx_des.size = ETH_RDES_RCH;
-    exo->eth.rx_des.buf2_ndes = &exo->eth.rx_des;
-    exo->eth.tx_des.ctl = ETH_TDES_TCH;
-    exo->eth.tx_des.buf2_ndes = &exo->eth.tx_des;
-#endif
-    ETH->DMATDLAR = (unsigned int)&exo->eth.tx_des;
-    ETH->DMARDLAR = (unsigned int)&exo->eth.rx_des;
+    //setup DMA. RX descriptors are chained
+    for (i = 0; i < ETH_RX_RING_SIZE; ++i)
+    {
+        exo->eth.rx_des[i].ctl = 0;
+        exo->eth.rx_des[i].size = ETH_RDES_RCH;
+        exo->eth.rx_des[i].buf2_ndes = &exo->eth.rx_des[stm32_eth_rx_next(i)];
+    }
+    //TX descriptors are in ring mode: buf2 is used for second segment of IO chain
+    for (i = 0; i < ETH_TX_RING_SIZE; ++i)
+        exo->eth.tx_des[i].ctl = stm32_eth_tx_ter(i) | ETH_TDES_IC;
+    exo->eth.cur_rx = exo->eth.post_rx = 0;
+    exo->eth.cur_tx = exo->eth.post_tx = 0;
+#if (ETH_RX_POLLING)
+    exo->eth.rx_polling = false;
+#endif //ETH_RX_POLLING
+    ETH->DMATDLAR = (unsigned int)exo->eth.tx_des;
+    ETH->DMARDLAR = (unsigned int)exo->eth.rx_des;
 
     //disable receiver/transmitter before link established
     ETH->MACCR = 0x8000;
+#if (ETH_CHECKSUM_OFFLOAD)
+    //rx checksum check. Tx insertion requires whole frame in FIFO
+    ETH->MACCR |= ETH_MACCR_IPCO;
+    ETH->DMAOMR |= ETH_DMAOMR_TSF;
+#endif //ETH_CHECKSUM_OFFLOAD
     //setup MAC
     ETH->MACA0HR = (exo->eth.mac.u8[5] << 8) | (exo->eth.mac.u8[4] << 0) |  (1 << 31);
     ETH->MACA0LR = (exo->eth.mac.u8[3] << 24) | (exo->eth.mac.u8[2] << 16) | (exo->eth.mac.u8[1] << 8) | (exo->eth.mac.u8[0] << 0);
@@ -295,93 +362,80 @@ static inline void stm32_eth_open(EXO* exo, unsigned int phy_addr, ETH_CONN_TYPE
 
 static inline void stm32_eth_read(EXO* exo, IPC* ipc)
 {
-    IO* io = (IO*)ipc->param2;
+    unsigned int i;
+    IO* io;
     if (!exo->eth.connected)
     {
         kerror(ERROR_NOT_ACTIVE);
         return;
     }
-#if (ETH_DOUBLE_BUFFERING)
-    int i = -1;
-    uint8_t cur_rx = exo->eth.cur_rx;
-
-    if (exo->eth.rx[cur_rx] == NULL)
-        i = cur_rx;
-    else if (exo->eth.rx[(cur_rx + 1) & 1] == NULL)
-        i = (cur_rx + 1) & 1;
-    if (i < 0)
+    //chain of IOs can be posted at once
+    for (io = (IO*)ipc->param2; io != NULL; io = (IO*)ipc->param2)
     {
-        kerror(ERROR_IN_PROGRESS);
-        return;
-    }
-    exo->eth.rx_des[i].buf1 = io_data(io);
-    exo->eth.rx_des[i].size &= ~ETH_RDES_RBS1_MASK;
-    exo->eth.rx_des[i].size |= ((ipc->param3 << ETH_RDES_RBS1_POS) & ETH_RDES_RBS1_MASK);
-    __disable_irq();
-    exo->eth.rx[i] = io;
-    //give descriptor to DMA
-    exo->eth.rx_des[i].ctl = ETH_RDES_OWN;
-    __enable_irq();
-#else
-    if (exo->eth.rx != NULL)
-    {
-        kerror(ERROR_IN_PROGRESS);
-        return;
+        i = exo->eth.post_rx;
+        if (exo->eth.rx[i] != NULL)
+        {
+            //rest of chain is returned
+            kerror(ERROR_IN_PROGRESS);
+            break;
+        }
+        ipc->param2 = (unsigned int)io->next;
+        io->next = NULL;
+        exo->eth.rx_des[i].buf1 = io_data(io);
+        exo->eth.rx_des[i].size &= ~ETH_RDES_RBS1_MASK;
+        exo->eth.rx_des[i].size |= ((ipc->param3 << ETH_RDES_RBS1_POS) & ETH_RDES_RBS1_MASK);
+        __disable_irq();
+        exo->eth.rx[i] = io;
+        //give descriptor to DMA
+        exo->eth.rx_des[i].ctl = ETH_RDES_OWN;
+        __enable_irq();
+        exo->eth.post_rx = stm32_eth_rx_next(i);
     }
-    exo->eth.rx_des.buf1 = io_data(io);
-    exo->eth.rx = io;
-    exo->eth.rx_des.size &= ~ETH_RDES_RBS1_MASK;
-    exo->eth.rx_des.size |= ((ipc->param3 << ETH_RDES_RBS1_POS) & ETH_RDES_RBS1_MASK);
-    //give descriptor to DMA
-    exo->eth.rx_des.ctl = ETH_RDES_OWN;
-#endif
     //enable and poll DMA. Value is doesn't matter
     ETH->DMARPDR = 0;
-    kerror(ERROR_SYNC);
+    if (io == NULL)
+        kerror(ERROR_SYNC);
+}
+
+static inline uint32_t stm32_eth_tx_size(IO* io)
+{
+    uint32_t size = (io->data_size << ETH_TDES_TBS1_POS) & ETH_TDES_TBS1_MASK;
+    if (io->next != NULL)
+        size |= (io->next->data_size << ETH_TDES_TBS2_POS) & ETH_TDES_TBS2_MASK;
+    return size;
 }
 
 static inline void stm32_eth_write(EXO* exo, IPC* ipc)
 {
+    unsigned int i;
     IO* io = (IO*)ipc->param2;
     if (!exo->eth.connected)
     {
         kerror(ERROR_NOT_ACTIVE);
         return;
     }
-#if (ETH_DOUBLE_BUFFERING)
-    int i = -1;
-    uint8_t cur_tx = exo->eth.cur_tx;
-
-    if (exo->eth.tx[cur_tx] == NULL)
-        i = cur_tx;
-    else if (exo->eth.tx[(cur_tx + 1) & 1] == NULL)
-        i = (cur_tx + 1) & 1;
-    if (i < 0)
+    //only 2 segments per descriptor
+    if ((io->next != NULL) && (io->next->next != NULL))
+    {
+        kerror(ERROR_NOT_SUPPORTED);
+        return;
+    }
+    i = exo->eth.post_tx;
+    if (exo->eth.tx[i] != NULL)
     {
         kerror(ERROR_IN_PROGRESS);
         return;
     }
     exo->eth.tx_des[i].buf1 = io_data(io);
-    exo->eth.tx_des[i].size = ((io->data_size << ETH_TDES_TBS1_POS) & ETH_TDES_TBS1_MASK);
-    exo->eth.tx_des[i].ctl = ETH_TDES_TCH | ETH_TDES_FS | ETH_TDES_LS | ETH_TDES_IC;
+    exo->eth.tx_des[i].buf2_ndes = io->next != NULL ? io_data(io->next) : NULL;
+    exo->eth.tx_des[i].size = stm32_eth_tx_size(io);
+    exo->eth.tx_des[i].ctl = stm32_eth_tx_ter(i) | ETH_TDES_FS | ETH_TDES_LS | ETH_TDES_IC | ETH_TDES_CIC;
     __disable_irq();
     exo->eth.tx[i] = io;
     //give descriptor to DMA
     exo->eth.tx_des[i].ctl |= ETH_TDES_OWN;
     __enable_irq();
-#else
-    if (exo->eth.tx != NULL)
-    {
-        kerror(ERROR_IN_PROGRESS);
-        return;
-    }
-    exo->eth.tx_des.buf1 = io_data(io);
-    exo->eth.tx = io;
-    exo->eth.tx_des.size = ((io->data_size << ETH_TDES_TBS1_POS) & ETH_TDES_TBS1_MASK);
-    //give descriptor to DMA
-    exo->eth.tx_des.ctl = ETH_TDES_TCH | ETH_TDES_FS | ETH_TDES_LS | ETH_TDES_IC;
-    exo->eth.tx_des.ctl |= ETH_TDES_OWN;
-#endif
+    exo->eth.post_tx = stm32_eth_tx_next(i);
     //enable and poll DMA. Value is doesn't matter
     ETH->DMATPDR = 0;
     kerror(ERROR_SYNC);
@@ -401,16 +455,15 @@ static inline void stm32_eth_get_mac(EXO* exo, IPC* ipc)
 
 void stm32_eth_init(EXO* exo)
 {
+    unsigned int i;
     exo->eth.tcpip = INVALID_HANDLE;
     exo->eth.conn = ETH_NO_LINK;
     exo->eth.connected = false;
     exo->eth.mac.u32.hi = exo->eth.mac.u32.lo = 0;
-#if (ETH_DOUBLE_BUFFERING)
-    exo->eth.rx[0] = exo->eth.tx[0] = NULL;
-    exo->eth.rx[1] = exo->eth.tx[1] = NULL;
-#else
-    exo->eth.rx = exo->eth.tx = NULL;
-#endif
+    for (i = 0; i < ETH_RX_RING_SIZE; ++i)
+        exo->eth.rx[i] = NULL;
+    for (i = 0; i < ETH_TX_RING_SIZE; ++i)
+        exo->eth.tx[i] = NULL;
 }
 
 void stm32_eth_request(EXO* exo, IPC* ipc)
@@ -431,6 +484,18 @@ void stm32_eth_request(EXO* exo, IPC* ipc)
         ipc->param2 = 0;
         ipc->param3 = ERROR_OK;
         break;
+    case ETH_GET_FEATURES:
+#if (ETH_CHECKSUM_OFFLOAD)
+        ipc->param2 = ETH_FEATURE_TX_CHECKSUM | ETH_FEATURE_RX_CHECKSUM;
+#else
+        ipc->param2 = 0;
+#endif //ETH_CHECKSUM_OFFLOAD
+        ipc->param3 = ERROR_OK;
+        break;
+    case ETH_GET_RING_SIZE:
+        ipc->param2 = ETH_RX_RING_SIZE;
+        ipc->param3 = ETH_TX_RING_SIZE;
+        break;
     default:
         if (exo->eth.tcpip == INVALID_HANDLE)
         {
@@ -453,6 +518,12 @@ void stm32_eth_request(EXO* exo, IPC* ipc)
         case IPC_WRITE:
             stm32_eth_write(exo, ipc);
             break;
+#if (ETH_RX_POLLING)
+        case ETH_POLL:
+            if (exo->eth.rx_polling)
+                stm32_eth_rx_batch(exo, ipc->param2, false);
+            break;
+#endif //ETH_RX_POLLING
         case IPC_TIMEOUT:
             if (exo->eth.cc == 1)
                 stm32_eth_conn_check(exo);
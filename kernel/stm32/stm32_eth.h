@@ -105,15 +105,9 @@ typedef struct {
 #define ETH_RDES_RCH                    (1 << 14)
 
 typedef struct {
-#if (ETH_DOUBLE_BUFFERING)
-    IO* tx[2];
-    IO* rx[2];
-    ETH_DESCRIPTORS tx_des[2], rx_des[2];
-#else
-    ETH_DESCRIPTORS tx_des, rx_des;
-    IO* tx;
-    IO* rx;
-#endif
+    IO* tx[ETH_TX_RING_SIZE];
+    IO* rx[ETH_RX_RING_SIZE];
+    ETH_DESCRIPTORS tx_des[ETH_TX_RING_SIZE], rx_des[ETH_RX_RING_SIZE];
     ETH_CONN_TYPE conn;
     unsigned int cc;
     HANDLE timer;
@@ -122,9 +116,11 @@ typedef struct {
     bool connected;
     MAC mac;
     uint8_t phy_addr;
-#if (ETH_DOUBLE_BUFFERING)
-    uint8_t cur_rx, cur_tx;
-#endif
+    //cur - next to complete, post - next to give to DMA
+    uint8_t cur_rx, cur_tx, post_rx, post_tx;
+#if (ETH_RX_POLLING)
+    bool rx_polling;
+#endif //ETH_RX_POLLING
 } ETH_DRV;
 
 void stm32_eth_init(EXO* exo);
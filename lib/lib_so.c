@@ -114,7 +114,7 @@ unsigned int lib_so_count(SO* so, const STD_MEM* std_mem)
     unsigned int res = lib_array_size(so->ar, std_mem);
     if (so->first_free == SO_FREE)
         return res;
-    for (idx = so->first_free; idx != SO_FREE; idx = SO_INDEX(SO_AT(so, std_mem, idx)))
+    for (idx = so->first_free; idx != SO_FREE; idx = *(unsigned int*)SO_DATA(so, std_mem, idx))
         --res;
     return res;
 }
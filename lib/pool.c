@@ -21,13 +21,23 @@
 
 #endif //(KERNEL_RANGE_CHECKING)
 
-#define MIN_SLOT_FULL_SIZE                                        (SLOT_HEADER_SIZE + sizeof(int) + SLOT_FOOTER_SIZE)
+//free slot must hold at least pointer to next free
+#define MIN_SLOT_FULL_SIZE                                        (SLOT_HEADER_SIZE + sizeof(void*) + SLOT_FOOTER_SIZE)
 
 #define NEXT_SLOT(ptr)                                            (*(void**)((unsigned int)(ptr) - SLOT_HEADER_SIZE))
 #define NEXT_FREE(ptr)                                            (*(void**)(ptr))
 #define NUM(ptr)                                                    (unsigned int)(ptr)
-#define ALIGN_SIZE                                                (sizeof(int))
+#define ALIGN_SIZE                                                (sizeof(void*))
 #define ALIGN(var)                                                (((var) + (ALIGN_SIZE - 1)) & ~(ALIGN_SIZE - 1))
+#define CACHE_MAX                                                 (POOL_CACHE_CLASSES * POOL_CACHE_GRANULARITY)
+//cached slot holds next cached and mark after it
+#define CACHED(ptr)                                               (*(unsigned int*)(NUM(ptr) + sizeof(void*)))
+#define CACHE_MIN                                                 ALIGN(sizeof(void*) + sizeof(unsigned int))
+
+static const unsigned int CACHED_MARK =                           0xcacecace;
+
+//long walk of free slots is split by pool yield
+#define YIELD_STEPS                                               16
 
 #if (KERNEL_RANGE_CHECKING)
 
@@ -79,11 +89,49 @@ void pool_init(POOL* pool, void* data)
     NEXT_SLOT(pool->first_slot) = NULL;
     SET_MARK(pool->first_slot);
     pool->free_slot = NULL;
+    memset(pool->cache, 0, sizeof(pool->cache));
+    pool->gen = pool->steps = 0;
+    pool->yield = NULL;
+}
+
+static void pool_release(POOL* pool, void* ptr);
+
+//true, if free slots were changed during yield. Walk must be restarted. Restarted walk is not split anymore, so it always ends
+static inline bool pool_yield(POOL* pool, bool* split, unsigned int gen)
+{
+    if (!(*split) || pool->yield == NULL || ++pool->steps < YIELD_STEPS)
+        return false;
+    pool->steps = 0;
+    pool->yield();
+    if (pool->gen == gen)
+        return false;
+    *split = false;
+    return true;
+}
+
+//return cached slots back to pool
+static bool pool_flush(POOL* pool)
+{
+    int i;
+    void* cur;
+    bool split;
+    bool res = false;
+    for (i = 0; i < POOL_CACHE_CLASSES; ++i)
+        while ((cur = pool->cache[i]) != NULL)
+        {
+            pool->cache[i] = NEXT_FREE(cur);
+            pool_release(pool, cur);
+            res = true;
+            //cache is popped from head, nothing to restart
+            split = true;
+            pool_yield(pool, &split, pool->gen);
+        }
+    return res;
 }
 
 static bool grow(POOL* pool, size_t size, void* sp)
 {
-    register void *new_last;
+    register void *new_last, *last;
     if (NEXT_SLOT(pool->last_slot) != NULL)
     {
         error(ERROR_POOL_CORRUPTED);
@@ -98,66 +146,109 @@ static bool grow(POOL* pool, size_t size, void* sp)
         return false;
     }
     //_brk implementation
-    CLEAR_MARK(pool->last_slot);
-    NEXT_SLOT(pool->last_slot) = new_last;
+    last = pool->last_slot;
+    CLEAR_MARK(last);
+    NEXT_SLOT(last) = new_last;
     NEXT_SLOT(new_last) = NULL;
-    SET_MARK(pool->last_slot);
+    SET_MARK(last);
     SET_MARK(new_last);
-
-    pool_free(pool, pool->last_slot);
+    //pool is consistent before release, it can yield
     pool->last_slot = new_last;
+    ++pool->gen;
+    pool_release(pool, last);
     return true;
 }
 
+//first fit thru free slots
+static void* pool_fit(POOL* pool, size_t len)
+{
+    register void *free_before, *next_slot, *new_slot, *cur;
+    unsigned int gen;
+    bool split = true;
+    gen = pool->gen;
+    free_before = NULL;
+    cur = pool->free_slot;
+    while (cur != NULL)
+    {
+        if (pool_yield(pool, &split, gen))
+        {
+            gen = pool->gen;
+            free_before = NULL;
+            cur = pool->free_slot;
+            continue;
+        }
+        next_slot = NEXT_SLOT(cur);
+        new_slot = (void*)(NUM(cur) + SLOT_HEADER_SIZE + len + SLOT_FOOTER_SIZE);
+        //enough space (before next slot)?
+        if (NUM(new_slot) <= NUM(next_slot))
+        {
+            //enough space to split and make free slot after
+            if (NUM(new_slot) + MIN_SLOT_FULL_SIZE <= NUM(next_slot))
+            {
+                CLEAR_MARK(cur);
+                NEXT_SLOT(new_slot) = next_slot;
+                NEXT_SLOT(cur) = new_slot;
+
+                NEXT_FREE(new_slot) = NEXT_FREE(cur);
+                NEXT_FREE(cur) = new_slot;
+                SET_MARK(cur);
+                SET_MARK(new_slot);
+            }
+            //remove current from free slot list
+            if (free_before)
+                NEXT_FREE(free_before) = NEXT_FREE(cur);
+            else
+                pool->free_slot = NEXT_FREE(cur);
+            ++pool->gen;
+            //flushed cached slot can be marked
+            if (len >= CACHE_MIN)
+                CACHED(cur) = 0;
+            return cur;
+        }
+        free_before = cur;
+        cur = NEXT_FREE(cur);
+    }
+    return NULL;
+}
+
 void* pool_malloc(POOL* pool, size_t size, void* sp)
 {
     size_t len;
-    register void *free_before, *next_slot, *new_slot, *cur;
+    void *cur;
     int i;
 
     //optimize for ARM 32bit align
     len = ALIGN(size);
     if (size == 0)
         return NULL;
+    //fast path: same size slot was recently freed
+    if (len <= CACHE_MAX)
+    {
+        i = (len + POOL_CACHE_GRANULARITY - 1) / POOL_CACHE_GRANULARITY - 1;
+        if ((cur = pool->cache[i]) != NULL)
+        {
+            pool->cache[i] = NEXT_FREE(cur);
+            CACHED(cur) = 0;
+            return cur;
+        }
+    }
     if (NUM(pool->last_slot) + len < NUM(pool->last_slot))
     {
         error(ERROR_OUT_OF_MEMORY);
         return NULL;
     }
 
-    for (i = 0; i < 2; ++i)
+    for (i = 0; i < 3; ++i)
     {
-        //forward thru empty slots
-        for (free_before = NULL, cur = pool->free_slot; cur != NULL; free_before = cur, cur = NEXT_FREE(cur))
-        {
-            next_slot = NEXT_SLOT(cur);
-            new_slot = (void*)(NUM(cur) + SLOT_HEADER_SIZE + len + SLOT_FOOTER_SIZE);
-            //enough space (before next slot)?
-            if (NUM(new_slot) <= NUM(next_slot))
-            {
-                //enough space to split and make free slot after
-                if (NUM(new_slot) + MIN_SLOT_FULL_SIZE <= NUM(next_slot))
-                {
-                    CLEAR_MARK(cur);
-                    NEXT_SLOT(new_slot) = next_slot;
-                    NEXT_SLOT(cur) = new_slot;
-
-                    NEXT_FREE(new_slot) = NEXT_FREE(cur);
-                    NEXT_FREE(cur) = new_slot;
-                    SET_MARK(cur);
-                    SET_MARK(new_slot);
-                }
-                //remove current from free slot list
-                if (free_before)
-                    NEXT_FREE(free_before) = NEXT_FREE(cur);
-                else
-                    pool->free_slot = NEXT_FREE(cur);
-                return cur;
-            }
-        }
+        if ((cur = pool_fit(pool, len)) != NULL)
+            return cur;
         //try to allocate more space
-        if (!grow(pool, len, sp))
+        if (i == 0 && grow(pool, len, sp))
+            continue;
+        //last chance: merge cached slots back to pool
+        if (i == 2 || !pool_flush(pool))
             break;
+        error(ERROR_OK);
     }
     return NULL;
 }
@@ -173,7 +264,8 @@ void* pool_realloc(POOL* pool, void* ptr, size_t size, void *sp)
 {
     register void *next, *p, *n;
     void *res;
-    unsigned int cur_size;
+    unsigned int cur_size, gen;
+    bool split = true;
     unsigned int len = ALIGN(size);
     int i;
 
@@ -190,8 +282,18 @@ void* pool_realloc(POOL* pool, void* ptr, size_t size, void *sp)
     for (i = 0; i < 2; ++i)
     {
         //next is free? append!
+        gen = pool->gen;
         for (p = NULL, n = pool->free_slot; n && n <= next; p = n, n = NEXT_FREE(n))
         {
+            if (pool_yield(pool, &split, gen))
+            {
+                //our slot and next after it are not moved by others, restart walk only
+                gen = pool->gen;
+                p = NULL;
+                n = pool->free_slot;
+                if (n == NULL || n > next)
+                    break;
+            }
             if (n == next)
             {
                 CLEAR_MARK(ptr);
@@ -201,6 +303,7 @@ void* pool_realloc(POOL* pool, void* ptr, size_t size, void *sp)
                     NEXT_FREE(p) = NEXT_FREE(n);
                 else
                     pool->free_slot = NEXT_FREE(n);
+                ++pool->gen;
                 next = NEXT_SLOT(ptr);
                 SET_MARK(ptr);
                 break;
@@ -226,7 +329,7 @@ void* pool_realloc(POOL* pool, void* ptr, size_t size, void *sp)
             NEXT_SLOT(ptr) = n;
             SET_MARK(ptr);
             SET_MARK(n);
-            pool_free(pool, n);
+            pool_release(pool, n);
         }
         return ptr;
     }
@@ -243,14 +346,59 @@ void* pool_realloc(POOL* pool, void* ptr, size_t size, void *sp)
 
 void pool_free(POOL* pool, void* ptr)
 {
-    register void* free_before;
-    register void* free_after;
-
+    unsigned int size, cls;
+    void* cur;
     if (ptr == NULL)
         return;
+    size = pool_slot_size(pool, ptr);
+    //small slot goes to cache. Class is rounded down, so any cached slot is enough for class size
+    if (size >= CACHE_MIN && size < CACHE_MAX + POOL_CACHE_GRANULARITY)
+    {
+        cls = size / POOL_CACHE_GRANULARITY - 1;
+        //double free check. Marked slot is cached, flushed to pool or mark is just user data
+        if (CACHED(ptr) == CACHED_MARK)
+        {
+            for (cur = pool->cache[cls]; cur != NULL; cur = NEXT_FREE(cur))
+                if (cur == ptr)
+                {
+                    error(ERROR_POOL_CORRUPTED);
+                    return;
+                }
+            //flushed slot is checked against free list
+            pool_release(pool, ptr);
+            return;
+        }
+        CACHED(ptr) = CACHED_MARK;
+        NEXT_FREE(ptr) = pool->cache[cls];
+        pool->cache[cls] = ptr;
+        return;
+    }
+    pool_release(pool, ptr);
+}
+
+static void pool_release(POOL* pool, void* ptr)
+{
+    register void* free_before;
+    register void* free_after;
+    unsigned int gen;
+    bool split = true;
 
     //find free slots before and after our ptr
-    for (free_before = NULL, free_after = pool->free_slot; free_after != NULL && NUM(ptr) > NUM(free_after); free_before = free_after, free_after = NEXT_FREE(free_after)) {}
+    gen = pool->gen;
+    free_before = NULL;
+    free_after = pool->free_slot;
+    while (free_after != NULL && NUM(ptr) > NUM(free_after))
+    {
+        if (pool_yield(pool, &split, gen))
+        {
+            gen = pool->gen;
+            free_before = NULL;
+            free_after = pool->free_slot;
+            continue;
+        }
+        free_before = free_after;
+        free_after = NEXT_FREE(free_after);
+    }
 
     if (
          //pointer in free slots list?
@@ -266,6 +414,7 @@ void pool_free(POOL* pool, void* ptr)
         return;
     }
 
+    ++pool->gen;
     NEXT_FREE(ptr) = free_after;
     if (free_before != NULL)
         NEXT_FREE(free_before) = ptr;
@@ -305,6 +454,7 @@ void* pool_free_ptr(POOL* pool)
 bool pool_check(POOL* pool, void* sp)
 {
     register void *before, *cur;
+    int i;
     //basic check
     if (pool->first_slot == NULL || pool->last_slot == NULL ||
          NUM(pool->first_slot) > NUM(pool->last_slot) ||
@@ -391,6 +541,15 @@ bool pool_check(POOL* pool, void* sp)
         }
 #endif //(KERNEL_RANGE_CHECKING)
     }
+
+    //check cached slots
+    for (i = 0; i < POOL_CACHE_CLASSES; ++i)
+        for (cur = pool->cache[i]; cur != NULL; cur = NEXT_FREE(cur))
+            if (NUM(cur) < NUM(pool->first_slot) || NUM(cur) >= NUM(pool->last_slot) || NUM(NEXT_SLOT(cur)) <= NUM(cur))
+            {
+                error(ERROR_POOL_CORRUPTED);
+                return false;
+            }
     return true;
 }
 
@@ -398,6 +557,7 @@ void pool_stat(POOL* pool, POOL_STAT* stat, void* sp)
 {
     void *cur, *cur_free;
     unsigned int size;
+    int i;
     memset(stat, 0, sizeof(POOL_STAT));
     if (pool_check(pool, sp))
     {
@@ -420,6 +580,16 @@ void pool_stat(POOL* pool, POOL_STAT* stat, void* sp)
                 stat->used += size;
             }
         }
+        //cached slots are used for pool, but free for user
+        for (i = 0; i < POOL_CACHE_CLASSES; ++i)
+            for (cur = pool->cache[i]; cur != NULL; cur = NEXT_FREE(cur))
+            {
+                size = NUM(NEXT_SLOT(cur)) - NUM(cur) - SLOT_HEADER_SIZE - SLOT_FOOTER_SIZE;
+                ++stat->cached_slots;
+                stat->cached += size;
+                --stat->used_slots;
+                stat->used -= size;
+            }
     }
     //space between last_slot and sp possibly can grow
     if (NUM(sp) >= NUM(pool->last_slot) + sizeof(unsigned int) + MIN_SLOT_FULL_SIZE)
@@ -430,6 +600,8 @@ void pool_stat(POOL* pool, POOL_STAT* stat, void* sp)
             stat->largest_free = size;
         stat->free += size;
     }
+    if (stat->free)
+        stat->fragmentation = (stat->free - stat->largest_free) * 100 / stat->free;
 }
 
 #endif //KERNEL_PROFILING
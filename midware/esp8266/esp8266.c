@@ -37,6 +37,7 @@ HANDLE esp8266_create(uint32_t process_size, uint32_t priority)
     rex.priority = priority;
     rex.flags = PROCESS_FLAGS_ACTIVE;
     rex.fn = esp8266s_main;
+    rex.ipc_size = 0;
     return process_create(&rex);
 }
 
@@ -7,27 +7,100 @@
 #include "arps.h"
 #include "tcpips_private.h"
 #include "../../userspace/stdio.h"
+#include "../../userspace/stdlib.h"
 #include "../../userspace/endian.h"
 #include "../../userspace/error.h"
 #include "macs.h"
 #include "ips.h"
 
-#define ARP_CACHE_ITEM(tcpips, i)                    ((ARP_CACHE_ENTRY*)array_at((tcpips)->arps.cache, i))
+#define ARP_CACHE_ITEM(tcpips, i)                    (&(tcpips)->arps.cache[i])
+#define ARP_NONE                                     0xffff
 
-typedef struct {
-    IP ip;
-    //zero MAC means unresolved yet
-    MAC mac;
-    //time to live. Zero means static ARP
-    unsigned int ttl;
-} ARP_CACHE_ENTRY;
+#ifndef ARP_CACHE_NEGATIVE_TIMEOUT
+#define ARP_CACHE_NEGATIVE_TIMEOUT                   20
+#endif //ARP_CACHE_NEGATIVE_TIMEOUT
+//request resend while incomplete. RFC 1122: no more than 1 request per second, timer granularity is 1 second
+#define ARP_REQUEST_INTERVAL                         2
 
 static const MAC __MAC_BROADCAST =                  {{0xff, 0xff, 0xff, 0xff, 0xff, 0xff}};
 static const MAC __MAC_REQUEST =                    {{0x00, 0x00, 0x00, 0x00, 0x00, 0x00}};
 
+static void arps_list_add(TCPIPS* tcpips, ARP_LIST* list, uint16_t idx)
+{
+    ARP_CACHE_ENTRY* arp = ARP_CACHE_ITEM(tcpips, idx);
+    arp->prev = ARP_NONE;
+    arp->next = list->head;
+    if (list->head != ARP_NONE)
+        ARP_CACHE_ITEM(tcpips, list->head)->prev = idx;
+    else
+        list->tail = idx;
+    list->head = idx;
+}
+
+static void arps_list_remove(TCPIPS* tcpips, ARP_LIST* list, uint16_t idx)
+{
+    ARP_CACHE_ENTRY* arp = ARP_CACHE_ITEM(tcpips, idx);
+    if (arp->prev != ARP_NONE)
+        ARP_CACHE_ITEM(tcpips, arp->prev)->next = arp->next;
+    else
+        list->head = arp->next;
+    if (arp->next != ARP_NONE)
+        ARP_CACHE_ITEM(tcpips, arp->next)->prev = arp->prev;
+    else
+        list->tail = arp->prev;
+}
+
+static ARP_LIST* arps_list(TCPIPS* tcpips, uint8_t state)
+{
+    switch (state)
+    {
+    case ARP_STATE_FREE:
+        return &tcpips->arps.free;
+    case ARP_STATE_INCOMPLETE:
+        return &tcpips->arps.incomplete;
+    case ARP_STATE_RESOLVED:
+    case ARP_STATE_UNREACHABLE:
+        return &tcpips->arps.lru;
+    default:
+        return NULL;
+    }
+}
+
+static void arps_set_state(TCPIPS* tcpips, uint16_t idx, uint8_t state)
+{
+    ARP_LIST* list;
+    ARP_CACHE_ENTRY* arp = ARP_CACHE_ITEM(tcpips, idx);
+    if ((list = arps_list(tcpips, arp->state)) != NULL)
+        arps_list_remove(tcpips, list, idx);
+    arp->state = state;
+    if ((list = arps_list(tcpips, state)) != NULL)
+        arps_list_add(tcpips, list, idx);
+}
+
+static inline unsigned int arps_hash(const IP* ip)
+{
+    uint32_t res = ip->u32.ip;
+    res ^= res >> 16;
+    res ^= res >> 8;
+    return res & (ARP_HASH_SIZE - 1);
+}
+
 void arps_init(TCPIPS* tcpips)
 {
-    array_create(&tcpips->arps.cache, sizeof(ARP_CACHE_ENTRY), 1);
+    unsigned int i;
+    for (i = 0; i < ARP_HASH_SIZE; ++i)
+        tcpips->arps.hash[i] = ARP_NONE;
+    tcpips->arps.lru.head = tcpips->arps.lru.tail = ARP_NONE;
+    tcpips->arps.incomplete.head = tcpips->arps.incomplete.tail = ARP_NONE;
+    tcpips->arps.free.head = tcpips->arps.free.tail = ARP_NONE;
+    tcpips->arps.cache = malloc(ARP_CACHE_SIZE_MAX * sizeof(ARP_CACHE_ENTRY));
+    if (tcpips->arps.cache == NULL)
+        return;
+    for (i = 0; i < ARP_CACHE_SIZE_MAX; ++i)
+    {
+        ARP_CACHE_ITEM(tcpips, i)->state = ARP_STATE_FREE;
+        arps_list_add(tcpips, &tcpips->arps.free, i);
+    }
 }
 
 static void arps_cmd_request(TCPIPS* tcpips, const IP* ip)
@@ -100,23 +173,30 @@ static inline void arps_cmd_reply(TCPIPS* tcpips, MAC* mac, IP* ip)
     macs_tx(tcpips, io, mac, ETHERTYPE_ARP);
 }
 
-static int arps_index(TCPIPS* tcpips, const IP* ip)
+static uint16_t arps_index(TCPIPS* tcpips, const IP* ip)
 {
-    int i;
-    for (i = 0; i < array_size(tcpips->arps.cache); ++i)
+    uint16_t idx;
+    for (idx = tcpips->arps.hash[arps_hash(ip)]; idx != ARP_NONE; idx = ARP_CACHE_ITEM(tcpips, idx)->hash_next)
     {
-        if (ARP_CACHE_ITEM(tcpips, i)->ip.u32.ip == ip->u32.ip)
-            return i;
+        if (ARP_CACHE_ITEM(tcpips, idx)->ip.u32.ip == ip->u32.ip)
+            return idx;
     }
-    return -1;
+    return ARP_NONE;
 }
 
-static void arps_remove_item(TCPIPS* tcpips, int idx)
+static void arps_unlink(TCPIPS* tcpips, uint16_t idx)
 {
-    IP ip;
-    ip.u32.ip = 0;
-    if (mac_compare(&ARP_CACHE_ITEM(tcpips, idx)->mac, &__MAC_REQUEST))
-        ip.u32.ip = ARP_CACHE_ITEM(tcpips, idx)->ip.u32.ip;
+    uint16_t* cur;
+    for (cur = &tcpips->arps.hash[arps_hash(&ARP_CACHE_ITEM(tcpips, idx)->ip)]; *cur != idx; cur = &ARP_CACHE_ITEM(tcpips, *cur)->hash_next) {}
+    *cur = ARP_CACHE_ITEM(tcpips, idx)->hash_next;
+    arps_set_state(tcpips, idx, ARP_STATE_FREE);
+}
+
+static void arps_remove_item(TCPIPS* tcpips, uint16_t idx)
+{
+    //inform route on incomplete ARP if not resolved
+    if (ARP_CACHE_ITEM(tcpips, idx)->state == ARP_STATE_INCOMPLETE)
+        routes_not_resolved(tcpips, ARP_CACHE_ITEM(tcpips, idx));
 #if (ARP_DEBUG)
     else
     {
@@ -125,93 +205,62 @@ static void arps_remove_item(TCPIPS* tcpips, int idx)
         printf(" removed\n");
     }
 #endif
-    array_remove(&tcpips->arps.cache, idx);
-
-    //inform route on incomplete ARP if not resolved
-    if (ip.u32.ip)
-        routes_not_resolved(tcpips, &ip);
+    arps_unlink(tcpips, idx);
 }
 
-static void arps_insert_item(TCPIPS* tcpips, const IP* ip, const MAC* mac, unsigned int timeout)
+//free entry or least recently used one. Static and incomplete are never evicted
+static uint16_t arps_allocate_item(TCPIPS* tcpips, const IP* ip)
 {
-    int i, idx;
-    unsigned int ttl;
-    //don't add dups
-    if (arps_index(tcpips, ip) >= 0)
-        return;
-    //remove first non-static if no place
-    if (array_size(tcpips->arps.cache) == ARP_CACHE_SIZE_MAX)
-    {
-        //first is static, can't remove
-        if (ARP_CACHE_ITEM(tcpips, 0)->ttl == 0)
-            return;
-        arps_remove_item(tcpips, 0);
-    }
-    idx = array_size(tcpips->arps.cache);
-    ttl = 0;
-    //add all static routes to the end of cache
-    if (timeout)
+    unsigned int hash;
+    uint16_t idx = tcpips->arps.free.head;
+    if (idx == ARP_NONE)
     {
-        ttl = tcpips->seconds + timeout;
-        for (i = 0; i < array_size(tcpips->arps.cache); ++i)
-            if ((ARP_CACHE_ITEM(tcpips, i)->ttl > ttl) || (ARP_CACHE_ITEM(tcpips, i)->ttl == 0))
-            {
-                idx = i;
-                break;
-            }
-    }
-    if (array_insert(&tcpips->arps.cache, idx))
-    {
-        ARP_CACHE_ITEM(tcpips, idx)->ip.u32.ip = ip->u32.ip;
-        ARP_CACHE_ITEM(tcpips, idx)->mac.u32.hi = mac->u32.hi;
-        ARP_CACHE_ITEM(tcpips, idx)->mac.u32.lo = mac->u32.lo;
-        ARP_CACHE_ITEM(tcpips, idx)->ttl = ttl;
-    }
-#if (ARP_DEBUG)
-    if (mac->u32.hi && mac->u32.lo)
-    {
-        printf("ARP: route added ");
-        ip_print(ip);
-        printf(" -> ");
-        mac_print(mac);
-        printf("\n");
+        idx = tcpips->arps.lru.tail;
+        if (idx == ARP_NONE)
+            return ARP_NONE;
+        arps_remove_item(tcpips, idx);
     }
-#endif
+    hash = arps_hash(ip);
+    ARP_CACHE_ITEM(tcpips, idx)->ip.u32.ip = ip->u32.ip;
+    ARP_CACHE_ITEM(tcpips, idx)->tx_head = NULL;
+    ARP_CACHE_ITEM(tcpips, idx)->tx_count = 0;
+    ARP_CACHE_ITEM(tcpips, idx)->hash_next = tcpips->arps.hash[hash];
+    tcpips->arps.hash[hash] = idx;
+    return idx;
 }
 
-static void arps_update_item(TCPIPS* tcpips, const IP* ip, const MAC* mac)
+static void arps_update_item(TCPIPS* tcpips, const IP* ip, const MAC* mac, bool insert)
 {
-    int idx = arps_index(tcpips, ip);
-    if (idx < 0)
+    ARP_CACHE_ENTRY* arp;
+    bool pending;
+    uint16_t idx = arps_index(tcpips, ip);
+    if (idx == ARP_NONE)
+    {
+        if (!insert || (idx = arps_allocate_item(tcpips, ip)) == ARP_NONE)
+            return;
+    }
+    arp = ARP_CACHE_ITEM(tcpips, idx);
+    if (arp->state == ARP_STATE_STATIC)
         return;
-    ARP_CACHE_ITEM(tcpips, idx)->mac.u32.hi = mac->u32.hi;
-    ARP_CACHE_ITEM(tcpips, idx)->mac.u32.lo = mac->u32.lo;
-    ARP_CACHE_ITEM(tcpips, idx)->ttl = tcpips->seconds + ARP_CACHE_TIMEOUT;
+    pending = (arp->state == ARP_STATE_INCOMPLETE);
+    arp->mac.u32.hi = mac->u32.hi;
+    arp->mac.u32.lo = mac->u32.lo;
+    arp->ttl = tcpips->seconds + ARP_CACHE_TIMEOUT;
+    arps_set_state(tcpips, idx, ARP_STATE_RESOLVED);
 #if (ARP_DEBUG)
-    printf("ARP: route resolved ");
+    printf("ARP: route %s ", pending ? "resolved" : "added");
     ip_print(ip);
     printf(" -> ");
     mac_print(mac);
     printf("\n");
 #endif
-}
-
-static bool arps_lookup(TCPIPS* tcpips, const IP* ip, MAC* mac)
-{
-    int idx = arps_index(tcpips, ip);
-    if (idx >= 0)
-    {
-        mac->u32.hi = ARP_CACHE_ITEM(tcpips, idx)->mac.u32.hi;
-        mac->u32.lo = ARP_CACHE_ITEM(tcpips, idx)->mac.u32.lo;
-        return true;
-    }
-    mac->u32.hi = 0;
-    mac->u32.lo = 0;
-    return false;
+    if (pending)
+        routes_resolved(tcpips, arp);
 }
 
 void arps_link_changed(TCPIPS* tcpips, bool link)
 {
+    uint16_t idx;
     if (link)
     {
         //announce IP
@@ -221,40 +270,76 @@ void arps_link_changed(TCPIPS* tcpips, bool link)
     else
     {
         //flush ARP cache, except static routes
-        while (array_size(tcpips->arps.cache) && ARP_CACHE_ITEM(tcpips, 0)->ttl)
-            arps_remove_item(tcpips, 0);
+        while ((idx = tcpips->arps.incomplete.head) != ARP_NONE)
+            arps_remove_item(tcpips, idx);
+        while ((idx = tcpips->arps.lru.head) != ARP_NONE)
+            arps_remove_item(tcpips, idx);
     }
 }
 
 void arps_timer(TCPIPS* tcpips, unsigned int seconds)
 {
-    while (array_size(tcpips->arps.cache) && ARP_CACHE_ITEM(tcpips, 0)->ttl && (ARP_CACHE_ITEM(tcpips, 0)->ttl <= seconds))
-        arps_remove_item(tcpips, 0);
+    uint16_t idx, next;
+    ARP_CACHE_ENTRY* arp;
+    //resolved and unreachable are aged on lookup
+    for (idx = tcpips->arps.incomplete.head; idx != ARP_NONE; idx = next)
+    {
+        arp = ARP_CACHE_ITEM(tcpips, idx);
+        next = arp->next;
+        if (arp->ttl <= seconds)
+        {
+#if (ARP_DEBUG)
+            printf("ARP: ");
+            ip_print(&arp->ip);
+            printf(" unreachable\n");
+#endif
+            arp->ttl = seconds + ARP_CACHE_NEGATIVE_TIMEOUT;
+            arps_set_state(tcpips, idx, ARP_STATE_UNREACHABLE);
+            routes_not_resolved(tcpips, arp);
+        }
+        else if (seconds >= arp->requested + ARP_REQUEST_INTERVAL)
+        {
+            arp->requested = seconds;
+            arps_cmd_request(tcpips, &arp->ip);
+        }
+    }
 }
 
 static inline void arps_add_static(TCPIPS* tcpips, IPC* ipc)
 {
     IP ip;
-    MAC mac;
-    int idx;
+    uint16_t idx;
     ip.u32.ip = ipc->param1;
-    mac.u32.hi = ipc->param2;
-    mac.u32.lo = ipc->param3;
     idx = arps_index(tcpips, &ip);
-    if (idx >= 0)
+    if (idx != ARP_NONE)
     {
         error(ERROR_ALREADY_CONFIGURED);
         return;
     }
-    arps_insert_item(tcpips, &ip, &mac, 0);
+    idx = arps_allocate_item(tcpips, &ip);
+    if (idx == ARP_NONE)
+    {
+        error(ERROR_OUT_OF_MEMORY);
+        return;
+    }
+    ARP_CACHE_ITEM(tcpips, idx)->mac.u32.hi = ipc->param2;
+    ARP_CACHE_ITEM(tcpips, idx)->mac.u32.lo = ipc->param3;
+    arps_set_state(tcpips, idx, ARP_STATE_STATIC);
+#if (ARP_DEBUG)
+    printf("ARP: static route added ");
+    ip_print(&ip);
+    printf(" -> ");
+    mac_print(&ARP_CACHE_ITEM(tcpips, idx)->mac);
+    printf("\n");
+#endif
     ipc->param2 = 0;
 }
 
 static inline void arps_remove(TCPIPS* tcpips, IP* ip)
 {
-    int idx;
+    uint16_t idx;
     idx = arps_index(tcpips, ip);
-    if (idx < 0)
+    if (idx == ARP_NONE)
     {
         error(ERROR_ALREADY_CONFIGURED);
         return;
@@ -264,39 +349,56 @@ static inline void arps_remove(TCPIPS* tcpips, IP* ip)
 
 static void arps_flush(TCPIPS* tcpips)
 {
-    while (array_size(tcpips->arps.cache))
-        arps_remove_item(tcpips, 0);
+    unsigned int i;
+    for (i = 0; i < ARP_CACHE_SIZE_MAX && tcpips->arps.cache != NULL; ++i)
+        if (ARP_CACHE_ITEM(tcpips, i)->state != ARP_STATE_FREE)
+            arps_remove_item(tcpips, i);
 }
 
 #if (ARP_DEBUG)
 static inline void arps_show_table(TCPIPS* tcpips)
 {
-    int i;
+    unsigned int i;
+    bool empty = true;
     ARP_CACHE_ENTRY* arp;
-    if (array_size(tcpips->arps.cache) == 0)
-    {
-        printf("ARP: table is empty\n");
-        return;
-    }
-    printf("       IP             MAC          TTL\n");
-    printf("-----------------------------------------\n");
-    for (i = 0; i < array_size(tcpips->arps.cache); ++i)
+    for (i = 0; i < ARP_CACHE_SIZE_MAX && tcpips->arps.cache != NULL; ++i)
     {
         arp = ARP_CACHE_ITEM(tcpips, i);
+        if (arp->state == ARP_STATE_FREE)
+            continue;
+        if (empty)
+        {
+            printf("       IP             MAC          TTL\n");
+            printf("-----------------------------------------\n");
+            empty = false;
+        }
         printf("  ");
         ip_print(&arp->ip);
         printf("  ");
-        if (mac_compare(&arp->mac, &__MAC_REQUEST))
+        switch (arp->state)
+        {
+        case ARP_STATE_INCOMPLETE:
             printf("REQUESTING ");
-        else
+            break;
+        case ARP_STATE_UNREACHABLE:
+            printf("UNREACHABLE");
+            break;
+        default:
             mac_print(&arp->mac);
+        }
         printf("  ");
-        if (arp->ttl)
+        if (arp->state == ARP_STATE_STATIC)
+            printf("STATIC");
+        else if (arp->ttl > tcpips->seconds)
             printf("  %d", arp->ttl - tcpips->seconds);
         else
-            printf("STATIC");
+            printf("EXPIRED");
         printf("\n");
     }
+    if (empty)
+        printf("ARP: table is empty\n");
+    printf("ARP: %d frames queued, dropped: %d overflow, %d unresolved\n",
+           tcpips->routes.queued, tcpips->routes.drops_overflow, tcpips->routes.drops_unresolved);
 }
 #endif //ARP_DEBUG
 
@@ -346,17 +448,18 @@ void arps_rx(TCPIPS* tcpips, IO *io)
         {
             arps_cmd_reply(tcpips, &arp->src_mac, &arp->src_ip);
             //insert in cache
-            arps_insert_item(tcpips, &arp->src_ip, &arp->src_mac, ARP_CACHE_TIMEOUT);
+            arps_update_item(tcpips, &arp->src_ip, &arp->src_mac, true);
         }
         //announcment
-        if (arp->dst_ip.u32.ip == arp->src_ip.u32.ip && mac_compare(&arp->dst_mac, &__MAC_REQUEST))
-            arps_insert_item(tcpips, &arp->src_ip, &arp->src_mac, ARP_CACHE_TIMEOUT);
+        else if (arp->dst_ip.u32.ip == arp->src_ip.u32.ip && mac_compare(&arp->dst_mac, &__MAC_REQUEST))
+            arps_update_item(tcpips, &arp->src_ip, &arp->src_mac, true);
+        //RFC 826: update sender, if already in cache
+        else
+            arps_update_item(tcpips, &arp->src_ip, &arp->src_mac, false);
         break;
     case ARP_REPLY:
         if (mac_compare(&tcpips->macs.mac, &arp->dst_mac))
         {
-            arps_update_item(tcpips, &arp->src_ip, &arp->src_mac);
-            routes_resolved(tcpips, &arp->src_ip, &arp->src_mac);
 #if (ARP_DEBUG_FLOW)
             printf("ARP: reply from ");
             ip_print(&arp->src_ip);
@@ -364,24 +467,73 @@ void arps_rx(TCPIPS* tcpips, IO *io)
             mac_print(&arp->src_mac);
             printf("\n");
 #endif
+            arps_update_item(tcpips, &arp->src_ip, &arp->src_mac, false);
         }
         break;
     }
     tcpips_release_io(tcpips, io);
 }
 
-bool arps_resolve(TCPIPS* tcpips, const IP* ip, MAC* mac)
+ARP_RESOLVE_STATUS arps_resolve(TCPIPS* tcpips, const IP* ip, MAC* mac, ARP_CACHE_ENTRY** pending)
 {
+    uint16_t idx;
+    ARP_CACHE_ENTRY* arp;
     if (ip->u32.ip == BROADCAST)
     {
         mac->u32.lo = __MAC_BROADCAST.u32.lo;
         mac->u32.hi = __MAC_BROADCAST.u32.hi;
-        return true;
+        return ARP_RESOLVED;
+    }
+    idx = arps_index(tcpips, ip);
+    if (idx != ARP_NONE)
+    {
+        arp = ARP_CACHE_ITEM(tcpips, idx);
+        switch (arp->state)
+        {
+        case ARP_STATE_RESOLVED:
+            if (arp->ttl <= tcpips->seconds)
+                break;
+            //move to LRU head
+            if (tcpips->arps.lru.head != idx)
+            {
+                arps_list_remove(tcpips, &tcpips->arps.lru, idx);
+                arps_list_add(tcpips, &tcpips->arps.lru, idx);
+            }
+            //fall through
+        case ARP_STATE_STATIC:
+            mac->u32.hi = arp->mac.u32.hi;
+            mac->u32.lo = arp->mac.u32.lo;
+            return ARP_RESOLVED;
+        case ARP_STATE_INCOMPLETE:
+            //already requested, resend is rate limited by timer
+            *pending = arp;
+            return ARP_PENDING;
+        default:
+            if (arp->ttl > tcpips->seconds)
+                return ARP_UNREACHABLE;
+            break;
+        }
     }
-    if (arps_lookup(tcpips, ip, mac))
-        return true;
+    else if ((idx = arps_allocate_item(tcpips, ip)) == ARP_NONE)
+        return ARP_UNREACHABLE;
     //request mac
-    arps_insert_item(tcpips, ip, &__MAC_REQUEST, ARP_CACHE_INCOMPLETE_TIMEOUT);
+    arp = ARP_CACHE_ITEM(tcpips, idx);
+    arp->mac.u32.hi = __MAC_REQUEST.u32.hi;
+    arp->mac.u32.lo = __MAC_REQUEST.u32.lo;
+    arp->ttl = tcpips->seconds + ARP_CACHE_INCOMPLETE_TIMEOUT;
+    arp->requested = tcpips->seconds;
+    arps_set_state(tcpips, idx, ARP_STATE_INCOMPLETE);
     arps_cmd_request(tcpips, ip);
-    return false;
+    *pending = arp;
+    return ARP_PENDING;
+}
+
+//incomplete, requested earlier than others, with frames queued
+ARP_CACHE_ENTRY* arps_oldest_pending(TCPIPS* tcpips)
+{
+    uint16_t idx;
+    for (idx = tcpips->arps.incomplete.tail; idx != ARP_NONE; idx = ARP_CACHE_ITEM(tcpips, idx)->prev)
+        if (ARP_CACHE_ITEM(tcpips, idx)->tx_count)
+            return ARP_CACHE_ITEM(tcpips, idx);
+    return NULL;
 }
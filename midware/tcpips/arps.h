@@ -9,7 +9,6 @@
 
 #include "tcpips.h"
 #include "../../userspace/eth.h"
-#include "../../userspace/array.h"
 #include "../../userspace/ipc.h"
 #include "../../userspace/arp.h"
 #include <stdint.h>
@@ -39,8 +38,52 @@ typedef struct {
 #define RARP_REQUEST                    3
 #define RARP_REPLY                      4
 
+#ifndef ARP_HASH_SIZE
+#define ARP_HASH_SIZE                   16
+#endif //ARP_HASH_SIZE
+
+typedef enum {
+    ARP_STATE_FREE = 0,
+    ARP_STATE_STATIC,
+    //request is sent, no answer yet
+    ARP_STATE_INCOMPLETE,
+    ARP_STATE_RESOLVED,
+    //negative cache: no answer on recent request
+    ARP_STATE_UNREACHABLE
+} ARP_STATE;
+
+typedef enum {
+    ARP_RESOLVED = 0,
+    //sender must queue packet for asynchronous answer
+    ARP_PENDING,
+    //sender must drop packet
+    ARP_UNREACHABLE
+} ARP_RESOLVE_STATUS;
+
+typedef struct {
+    IP ip;
+    MAC mac;
+    //expiration time. Not used for static
+    unsigned int ttl;
+    //last request time of incomplete
+    unsigned int requested;
+    //frames, waiting for resolve of incomplete, linked by io->queue. Owned by route
+    IO* tx_head;
+    IO* tx_tail;
+    //indexes in cache, ARP_NONE terminated
+    uint16_t hash_next, prev, next;
+    uint8_t state, tx_count;
+} ARP_CACHE_ENTRY;
+
+typedef struct {
+    uint16_t head, tail;
+} ARP_LIST;
+
 typedef struct {
-    ARRAY* cache;
+    ARP_CACHE_ENTRY* cache;
+    uint16_t hash[ARP_HASH_SIZE];
+    //resolved and unreachable, most recently used first. Static are not listed
+    ARP_LIST lru, incomplete, free;
 } ARPS;
 
 //from tcpip
@@ -52,7 +95,8 @@ void arps_request(TCPIPS* tcpips, IPC* ipc);
 //from mac
 void arps_rx(TCPIPS* tcpips, IO* io);
 
-//from route. If false returned, sender must queue request for asynchronous answer
-bool arps_resolve(TCPIPS* tcpips, const IP* ip, MAC* mac);
+//from route
+ARP_RESOLVE_STATUS arps_resolve(TCPIPS* tcpips, const IP* ip, MAC* mac, ARP_CACHE_ENTRY** pending);
+ARP_CACHE_ENTRY* arps_oldest_pending(TCPIPS* tcpips);
 
 #endif // ARPS_H
@@ -32,7 +32,8 @@ static void icmps_tx(TCPIPS* tcpips, IO* io, const IP* dst)
 {
     ICMP_HEADER* icmp = io_data(io);
     short2be(icmp->checksum_be, 0);
-    short2be(icmp->checksum_be, ip_checksum(io_data(io), io->data_size));
+    if (!ips_tx_checksum_offload(tcpips, io))
+        short2be(icmp->checksum_be, ip_checksum(io_data(io), io->data_size));
     ips_tx(tcpips, io, dst);
 }
 
@@ -114,14 +115,24 @@ static void icmps_rx_error(TCPIPS* tcpips, IO* io, ICMP_ERROR code)
 #if (ICMP_ECHO)
 static inline void icmps_rx_echo(TCPIPS* tcpips, IO* io, IP* src)
 {
+    uint8_t hdr[2];
     ICMP_HEADER_ID_SEQ* icmp = io_data(io);
 #if (ICMP_DEBUG)
     printf("ICMP: ECHO from ");
     ip_print(src);
     printf("\n");
 #endif
+    hdr[0] = icmp->type;
+    hdr[1] = icmp->code;
     icmp->type = ICMP_CMD_ECHO_REPLY;
-    icmps_tx(tcpips, io, src);
+    if (ips_tx_checksum_offload(tcpips, io))
+    {
+        icmps_tx(tcpips, io, src);
+        return;
+    }
+    //only type is changed, no need to walk over echo data
+    short2be(icmp->checksum_be, ip_checksum_update(be2short(icmp->checksum_be), hdr, &icmp->type, 2));
+    ips_tx(tcpips, io, src);
 }
 #endif
 
@@ -140,6 +151,7 @@ static inline void icmps_rx_echo_reply(TCPIPS* tcpips, IO* io, IP* src)
         return;
     }
     icmps_echo_complete(tcpips, (memcmp(((uint8_t*)io_data(io)) + sizeof(ICMP_HEADER), __ICMP_DATA_MAGIC, ICMP_DATA_MAGIC_SIZE)) ? ERROR_CRC : ERROR_OK);
+    ips_release_io(tcpips, io);
 }
 
 static inline void icmps_rx_destination_unreachable(TCPIPS* tcpips, IO* io)
@@ -192,7 +204,10 @@ static inline void icmps_tx_echo(TCPIPS* tcpips)
     ICMP_HEADER_ID_SEQ* icmp;
     IO* io = ips_allocate_io(tcpips, ICMP_DATA_MAGIC_SIZE + sizeof(ICMP_HEADER), PROTO_ICMP);
     if (io == NULL)
+    {
         icmps_echo_complete(tcpips, get_last_error());
+        return;
+    }
     icmp = io_data(io);
     icmp->type = ICMP_CMD_ECHO;
     icmp->code = 0;
@@ -278,7 +293,7 @@ void icmps_rx(TCPIPS* tcpips, IO *io, IP* src)
         ips_release_io(tcpips, io);
         return;
     }
-    if (ip_checksum(io_data(io), io->data_size))
+    if (!tcpips->rx_checksum_ok && ip_checksum(io_data(io), io->data_size))
     {
         ips_release_io(tcpips, io);
         return;
@@ -49,7 +49,6 @@ void ips_init(TCPIPS* tcpips)
 
 #if (IP_FRAGMENTATION)
     tcpips->ips.io_allocated = 0;
-    array_create(&tcpips->ips.free_io, sizeof(IO*), 1);
     array_create(&tcpips->ips.assembly_io, sizeof(IPS_ASSEMBLY), 1);
 #endif //IP_FRAGMENTATION
 }
@@ -58,12 +57,7 @@ void ips_init(TCPIPS* tcpips)
 static IO* ips_allocate_long(TCPIPS* tcpips)
 {
     IO* io = NULL;
-    if (array_size(tcpips->ips.free_io))
-    {
-        io = *((IO**)array_at(tcpips->ips.free_io, array_size(tcpips->ips.free_io) - 1));
-        array_remove(&tcpips->ips.free_io, array_size(tcpips->ips.free_io) - 1);
-    }
-    else if (tcpips->ips.io_allocated < IP_MAX_LONG_PACKETS)
+    if (tcpips->ips.io_allocated < IP_MAX_LONG_PACKETS)
     {
         io = io_create(LONG_IP_FRAME_MAX_SIZE);
         if (io != NULL)
@@ -76,11 +70,8 @@ static IO* ips_allocate_long(TCPIPS* tcpips)
 
 static void ips_release_long(TCPIPS* tcpips, IO* io)
 {
-    IO** iop;
-    io_reset(io);
-    iop = array_append(&tcpips->ips.free_io);
-    if (iop)
-        *iop = io;
+    io_destroy(io);
+    --tcpips->ips.io_allocated;
 }
 
 static inline IPS_ASSEMBLY* ips_allocate_assembly(TCPIPS* tcpips, const IP* src, uint16_t id)
@@ -348,11 +339,23 @@ static void ips_tx_internal(TCPIPS* tcpips, IO* io, const IP* dst, unsigned int
     hdr->dst.u32.ip = dst->u32.ip;
     //update checksum
     short2be(hdr->header_crc_be, 0);
-    short2be(hdr->header_crc_be, ip_checksum(io_data(io), hdr_size));
+    if (!(tcpips->eth_features & ETH_FEATURE_TX_CHECKSUM))
+        short2be(hdr->header_crc_be, ip_checksum(io_data(io), hdr_size));
 
     routes_tx(tcpips, io, dst);
 }
 
+bool ips_tx_checksum_offload(TCPIPS* tcpips, IO* io)
+{
+#if (IP_FRAGMENTATION)
+    IP_STACK* ip_stack = io_stack(io);
+    //MAC bypasses payload of fragmented frames
+    if (ip_stack->is_long)
+        return false;
+#endif //IP_FRAGMENTATION
+    return (tcpips->eth_features & ETH_FEATURE_TX_CHECKSUM) != 0;
+}
+
 void ips_tx(TCPIPS* tcpips, IO* io, const IP* dst)
 {
     IP_HEADER* hdr;
@@ -460,6 +463,7 @@ static inline void ips_insert_fragment(TCPIPS* tcpips, IO* io, unsigned int offs
     IP_HEADER* hdr;
     IPS_ASSEMBLY* as;
     IO* assembled;
+    bool rx_checksum_ok;
     IP_STACK* ip_stack = io_stack(io);
     hdr = (IP_HEADER*)(((uint8_t*)io_data(io)) - ip_stack->hdr_size);
     as = ips_find_assembly(tcpips, &hdr->src, be2short(hdr->id_be));
@@ -522,16 +526,20 @@ static inline void ips_insert_fragment(TCPIPS* tcpips, IO* io, unsigned int offs
         ip_stack->proto = hdr->proto;
         ip_stack->is_long = true;
         //update header
-        io->data_offset += ip_stack->hdr_size;
-        io->data_size -= ip_stack->hdr_size;
+        assembled->data_offset += ip_stack->hdr_size;
+        assembled->data_size -= ip_stack->hdr_size;
         //total len
-        short2be(hdr->total_len_be, io->data_size);
+        short2be(hdr->total_len_be, assembled->data_size + ip_stack->hdr_size);
         //flags, offset
         hdr->flags_offset_be[0] = hdr->flags_offset_be[1] = 0;
         //update checksum
         short2be(hdr->header_crc_be, 0);
-        short2be(hdr->header_crc_be, ip_checksum(io_data(assembled), ip_stack->hdr_size));
+        short2be(hdr->header_crc_be, ip_checksum(hdr, ip_stack->hdr_size));
+        //MAC checked only frame of last fragment, never whole datagram
+        rx_checksum_ok = tcpips->rx_checksum_ok;
+        tcpips->rx_checksum_ok = false;
         ips_process(tcpips, assembled, &hdr->src);
+        tcpips->rx_checksum_ok = rx_checksum_ok;
     }
 }
 #endif //IP_FRAGMENTATION
@@ -559,7 +567,7 @@ void ips_rx(TCPIPS* tcpips, IO* io)
 #endif //IP_FRAGMENTATION
 #if (IP_CHECKSUM)
     //drop if checksum is invalid
-    if (ip_checksum(io_data(io), ip_stack->hdr_size))
+    if (!tcpips->rx_checksum_ok && ip_checksum(io_data(io), ip_stack->hdr_size))
     {
         tcpips_release_io(tcpips, io);
         return;
@@ -25,7 +25,6 @@ typedef struct {
 #endif //IP_FIREWALL
 #if (IP_FRAGMENTATION)
     unsigned int io_allocated;
-    ARRAY* free_io;
     ARRAY* assembly_io;
 #endif //IP_FRAGMENTATION
 } IPS;
@@ -74,6 +73,8 @@ IO* ips_allocate_io(TCPIPS* tcpips, unsigned int size, uint8_t proto);
 //release previously allocated io. IO is not actually freed, just put in queue of free ios
 void ips_release_io(TCPIPS* tcpips, IO* io);
 void ips_tx(TCPIPS* tcpips, IO* io, const IP* dst);
+//transport checksum of allocated io is inserted by MAC. Leave checksum field zero
+bool ips_tx_checksum_offload(TCPIPS* tcpips, IO* io);
 
 //from mac
 void ips_rx(TCPIPS* tcpips, IO* io);
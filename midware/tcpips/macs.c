@@ -9,15 +9,40 @@
 #include "../../userspace/stdio.h"
 #include "../../userspace/endian.h"
 #include "../../userspace/error.h"
+#include "../../userspace/stdlib.h"
+#include "../../userspace/systime.h"
 #include "arps.h"
 #include <string.h>
 
+#if (MAC_PCAP)
+//libpcap file format, host byte order
+#define PCAP_MAGIC                      0xa1b2c3d4
+#define PCAP_VERSION_MAJOR              2
+#define PCAP_VERSION_MINOR              4
+#define PCAP_LINKTYPE_ETHERNET          1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version_major, version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs, snaplen, network;
+} PCAP_HEADER;
+
+typedef struct {
+    uint32_t ts_sec, ts_usec, incl_len, orig_len;
+} PCAP_RECORD;
+#endif //MAC_PCAP
+
 void macs_init(TCPIPS* tcpips)
 {
     memset(&tcpips->macs.mac, 0, sizeof(MAC));
 #if (MAC_FIREWALL)
     tcpips->macs.firewall_enabled = false;
 #endif //MAC_FIREWALL
+#if (MAC_PCAP)
+    tcpips->macs.pcap_buf = NULL;
+    tcpips->macs.pcap_io = NULL;
+#endif //MAC_PCAP
 }
 
 #if (MAC_FIREWALL)
@@ -44,6 +69,135 @@ void macs_disable_firewall(TCPIPS* tcpips)
 }
 #endif //MAC_FIREWALL
 
+#if (MAC_PCAP)
+static void macs_pcap_put(TCPIPS* tcpips, const void* data, unsigned int size)
+{
+    unsigned int tail, chunk;
+    tail = (tcpips->macs.pcap_head + tcpips->macs.pcap_size) % MAC_PCAP_BUF_SIZE;
+    chunk = MAC_PCAP_BUF_SIZE - tail;
+    if (chunk > size)
+        chunk = size;
+    memcpy(tcpips->macs.pcap_buf + tail, data, chunk);
+    memcpy(tcpips->macs.pcap_buf, (const uint8_t*)data + chunk, size - chunk);
+    tcpips->macs.pcap_size += size;
+}
+
+static void macs_pcap_flush(TCPIPS* tcpips, bool force)
+{
+    unsigned int size, chunk;
+    IO* io = tcpips->macs.pcap_io;
+    if (io == NULL)
+        return;
+    size = tcpips->macs.pcap_size;
+    if (size > tcpips->macs.pcap_read_size)
+        size = tcpips->macs.pcap_read_size;
+    //hold reader until half of block is ready, rest is sent by timer
+    if (!force && (size < tcpips->macs.pcap_read_size / 2) && (tcpips->macs.pcap_size < MAC_PCAP_BUF_SIZE / 2))
+        return;
+    chunk = MAC_PCAP_BUF_SIZE - tcpips->macs.pcap_head;
+    if (chunk > size)
+        chunk = size;
+    memcpy(io_data(io), tcpips->macs.pcap_buf + tcpips->macs.pcap_head, chunk);
+    memcpy((uint8_t*)io_data(io) + chunk, tcpips->macs.pcap_buf, size - chunk);
+    tcpips->macs.pcap_head = (tcpips->macs.pcap_head + size) % MAC_PCAP_BUF_SIZE;
+    tcpips->macs.pcap_size -= size;
+    io->data_size = size;
+    tcpips->macs.pcap_io = NULL;
+    io_complete(tcpips->macs.pcap_process, HAL_IO_CMD(HAL_MAC, IPC_READ), 0, io);
+}
+
+static void macs_pcap_capture(TCPIPS* tcpips, IO* io)
+{
+    PCAP_RECORD rec;
+    SYSTIME uptime;
+    rec.orig_len = io->data_size;
+    rec.incl_len = rec.orig_len;
+    if (rec.incl_len > tcpips->macs.pcap_snaplen)
+        rec.incl_len = tcpips->macs.pcap_snaplen;
+    //reader is too slow. Drop whole record to keep stream consistent
+    if (tcpips->macs.pcap_size + sizeof(PCAP_RECORD) + rec.incl_len > MAC_PCAP_BUF_SIZE)
+    {
+        ++tcpips->macs.pcap_drops;
+        return;
+    }
+    get_uptime(&uptime);
+    rec.ts_sec = uptime.sec;
+    rec.ts_usec = uptime.usec;
+    macs_pcap_put(tcpips, &rec, sizeof(PCAP_RECORD));
+    macs_pcap_put(tcpips, io_data(io), rec.incl_len);
+    macs_pcap_flush(tcpips, false);
+}
+
+static void macs_pcap_start(TCPIPS* tcpips, unsigned int snaplen)
+{
+    PCAP_HEADER hdr;
+    if (tcpips->macs.pcap_buf != NULL)
+    {
+        error(ERROR_ALREADY_CONFIGURED);
+        return;
+    }
+    if ((tcpips->macs.pcap_buf = malloc(MAC_PCAP_BUF_SIZE)) == NULL)
+        return;
+    if (snaplen == 0)
+        snaplen = MAC_PCAP_SNAPLEN;
+    if (snaplen > MAC_PCAP_BUF_SIZE / 2)
+        snaplen = MAC_PCAP_BUF_SIZE / 2;
+    tcpips->macs.pcap_head = tcpips->macs.pcap_size = tcpips->macs.pcap_drops = 0;
+    tcpips->macs.pcap_snaplen = snaplen;
+
+    hdr.magic = PCAP_MAGIC;
+    hdr.version_major = PCAP_VERSION_MAJOR;
+    hdr.version_minor = PCAP_VERSION_MINOR;
+    hdr.thiszone = 0;
+    hdr.sigfigs = 0;
+    hdr.snaplen = snaplen;
+    hdr.network = PCAP_LINKTYPE_ETHERNET;
+    macs_pcap_put(tcpips, &hdr, sizeof(PCAP_HEADER));
+}
+
+static void macs_pcap_stop(TCPIPS* tcpips, IPC* ipc)
+{
+    if (tcpips->macs.pcap_buf == NULL)
+    {
+        error(ERROR_NOT_CONFIGURED);
+        return;
+    }
+    //pending reader gets rest of stream, empty block is end of stream. Unread records are lost
+    macs_pcap_flush(tcpips, true);
+    free(tcpips->macs.pcap_buf);
+    tcpips->macs.pcap_buf = NULL;
+    ipc->param2 = tcpips->macs.pcap_drops;
+}
+
+static void macs_pcap_read(TCPIPS* tcpips, IPC* ipc)
+{
+    IO* io = (IO*)ipc->param2;
+    if (tcpips->macs.pcap_buf == NULL)
+    {
+        error(ERROR_NOT_CONFIGURED);
+        return;
+    }
+    if (tcpips->macs.pcap_io != NULL)
+    {
+        error(ERROR_IN_PROGRESS);
+        return;
+    }
+    tcpips->macs.pcap_io = io;
+    tcpips->macs.pcap_process = ipc->process;
+    tcpips->macs.pcap_read_size = io_get_free(io);
+    if (tcpips->macs.pcap_read_size > (unsigned int)ipc->param3)
+        tcpips->macs.pcap_read_size = ipc->param3;
+    error(ERROR_SYNC);
+    macs_pcap_flush(tcpips, false);
+}
+
+void macs_timer(TCPIPS* tcpips, unsigned int seconds)
+{
+    if (tcpips->macs.pcap_buf != NULL && tcpips->macs.pcap_size)
+        macs_pcap_flush(tcpips, true);
+}
+#endif //MAC_PCAP
+
 void macs_request(TCPIPS* tcpips, IPC* ipc)
 {
 #if (MAC_FIREWALL)
@@ -61,6 +215,17 @@ void macs_request(TCPIPS* tcpips, IPC* ipc)
         macs_disable_firewall(tcpips);
         break;
 #endif //MAC_FIREWALL
+#if (MAC_PCAP)
+    case MAC_PCAP_START:
+        macs_pcap_start(tcpips, ipc->param2);
+        break;
+    case MAC_PCAP_STOP:
+        macs_pcap_stop(tcpips, ipc);
+        break;
+    case IPC_READ:
+        macs_pcap_read(tcpips, ipc);
+        break;
+#endif //MAC_PCAP
     default:
         error(ERROR_NOT_SUPPORTED);
         break;
@@ -84,6 +249,10 @@ void macs_rx(TCPIPS* tcpips, IO* io)
         tcpips_release_io(tcpips, io);
         return;
     }
+#if (MAC_PCAP)
+    if (tcpips->macs.pcap_buf != NULL)
+        macs_pcap_capture(tcpips, io);
+#endif //MAC_PCAP
     lentype = be2short(hdr->lentype_be);
 
 #if (MAC_FILTER)
@@ -172,5 +341,9 @@ void macs_tx(TCPIPS* tcpips, IO* io, const MAC* dst, uint16_t lentype)
     hdr->src.u32.lo = tcpips->macs.mac.u32.lo;
     short2be(hdr->lentype_be, lentype);
 
+#if (MAC_PCAP)
+    if (tcpips->macs.pcap_buf != NULL)
+        macs_pcap_capture(tcpips, io);
+#endif //MAC_PCAP
     tcpips_tx(tcpips, io);
 }
@@ -12,12 +12,33 @@
 #include "sys_config.h"
 #include <stdint.h>
 
+#ifndef MAC_PCAP
+#define MAC_PCAP                        0
+#endif //MAC_PCAP
+
+#if (MAC_PCAP)
+#ifndef MAC_PCAP_BUF_SIZE
+#define MAC_PCAP_BUF_SIZE               4096
+#endif //MAC_PCAP_BUF_SIZE
+
+#ifndef MAC_PCAP_SNAPLEN
+#define MAC_PCAP_SNAPLEN                128
+#endif //MAC_PCAP_SNAPLEN
+#endif //MAC_PCAP
+
 typedef struct {
     MAC mac;
 #if (MAC_FIREWALL)
     MAC src;
     bool firewall_enabled;
 #endif //MAC_FIREWALL
+#if (MAC_PCAP)
+    //allocated only while capture is running
+    uint8_t* pcap_buf;
+    unsigned int pcap_head, pcap_size, pcap_snaplen, pcap_drops, pcap_read_size;
+    HANDLE pcap_process;
+    IO* pcap_io;
+#endif //MAC_PCAP
 } MACS;
 
 //from tcpip process
@@ -26,6 +47,9 @@ void macs_open(TCPIPS* tcpips);
 void macs_request(TCPIPS* tcpips, IPC* ipc);
 void macs_link_changed(TCPIPS* tcpips, bool link);
 void macs_rx(TCPIPS* tcpips, IO* io);
+#if (MAC_PCAP)
+void macs_timer(TCPIPS* tcpips, unsigned int seconds);
+#endif //MAC_PCAP
 
 IO* macs_allocate_io(TCPIPS* tcpips);
 void macs_tx(TCPIPS* tcpips, IO* io, const MAC* dst, uint16_t lentype);
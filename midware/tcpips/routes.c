@@ -10,27 +10,49 @@
 #include "macs.h"
 #include "icmps.h"
 
-#define ROUTE_QUEUE_ITEM(tcpips, i)                    ((ROUTE_QUEUE_ENTRY*)array_at((tcpips)->routes.tx_queue, i))
-
-typedef struct {
-    IO* io;
-    IP ip;
-} ROUTE_QUEUE_ENTRY;
+//frames queued to one neighbor. Oldest is dropped on overflow
+#ifndef ROUTE_QUEUE_DEPTH
+#define ROUTE_QUEUE_DEPTH                              3
+#endif //ROUTE_QUEUE_DEPTH
+//frames queued to all neighbors. Must be less than TCPIP_MAX_FRAMES_COUNT, so unresolved neighbor can't starve stack
+#ifndef ROUTE_QUEUE_MAX
+#define ROUTE_QUEUE_MAX                                (TCPIP_MAX_FRAMES_COUNT / 2)
+#endif //ROUTE_QUEUE_MAX
 
 void routes_init(TCPIPS* tcpips)
 {
-    array_create(&tcpips->routes.tx_queue, sizeof(ROUTE_QUEUE_ENTRY), 1);
+    tcpips->routes.queued = 0;
+    tcpips->routes.drops_overflow = tcpips->routes.drops_unresolved = 0;
+}
+
+static IO* routes_dequeue(TCPIPS* tcpips, ARP_CACHE_ENTRY* arp)
+{
+    IO* io = arp->tx_head;
+    arp->tx_head = io->queue;
+    io->queue = NULL;
+    --arp->tx_count;
+    --tcpips->routes.queued;
+    return io;
+}
+
+//detach whole neighbor queue
+static IO* routes_flush(TCPIPS* tcpips, ARP_CACHE_ENTRY* arp)
+{
+    IO* io = arp->tx_head;
+    tcpips->routes.queued -= arp->tx_count;
+    arp->tx_head = NULL;
+    arp->tx_count = 0;
+    return io;
 }
 
 bool routes_drop(TCPIPS* tcpips)
 {
-    if (array_size(tcpips->routes.tx_queue))
-    {
-        tcpips_release_io(tcpips, ROUTE_QUEUE_ITEM(tcpips, 0)->io);
-        array_remove(&tcpips->routes.tx_queue, 0);
-        return true;
-    }
-    return false;
+    ARP_CACHE_ENTRY* arp = arps_oldest_pending(tcpips);
+    if (arp == NULL)
+        return false;
+    tcpips_release_io(tcpips, routes_dequeue(tcpips, arp));
+    ++tcpips->routes.drops_overflow;
+    return true;
 }
 
 void routes_link_changed(TCPIPS* tcpips, bool link)
@@ -42,46 +64,80 @@ void routes_link_changed(TCPIPS* tcpips, bool link)
     }
 }
 
-void routes_resolved(TCPIPS* tcpips, const IP* ip, const MAC* mac)
+void routes_resolved(TCPIPS* tcpips, ARP_CACHE_ENTRY* arp)
 {
-    int i;
-    for (i = 0; i < array_size(tcpips->routes.tx_queue); ++i)
-        if (ROUTE_QUEUE_ITEM(tcpips, i)->ip.u32.ip == ip->u32.ip)
-        {
-            //forward to MAC
-            macs_tx(tcpips, ROUTE_QUEUE_ITEM(tcpips, i)->io, mac, ETHERTYPE_IP);
-            array_remove(&tcpips->routes.tx_queue, i);
-        }
+    IO* io;
+    IO* next;
+    //forward to MAC
+    for (io = routes_flush(tcpips, arp); io != NULL; io = next)
+    {
+        next = io->queue;
+        io->queue = NULL;
+        macs_tx(tcpips, io, &arp->mac, ETHERTYPE_IP);
+    }
 }
 
-void routes_not_resolved(TCPIPS* tcpips, const IP* ip)
+void routes_not_resolved(TCPIPS* tcpips, ARP_CACHE_ENTRY* arp)
 {
-    int i;
-    for (i = 0; i < array_size(tcpips->routes.tx_queue); ++i)
-        if (ROUTE_QUEUE_ITEM(tcpips, i)->ip.u32.ip == ip->u32.ip)
-        {
+    IO* io;
+    IO* next;
+    for (io = routes_flush(tcpips, arp); io != NULL; io = next)
+    {
+        next = io->queue;
+        io->queue = NULL;
 #if (ICMP)
-            icmps_no_route(tcpips, ROUTE_QUEUE_ITEM(tcpips, i)->io);
+        icmps_no_route(tcpips, io);
 #endif //ICMP
-            //drop if not resolved
-            tcpips_release_io(tcpips, ROUTE_QUEUE_ITEM(tcpips, i)->io);
-            array_remove(&tcpips->routes.tx_queue, i);
+        //drop if not resolved
+        tcpips_release_io(tcpips, io);
+        ++tcpips->routes.drops_unresolved;
+    }
+}
+
+static void routes_enqueue(TCPIPS* tcpips, IO* io, ARP_CACHE_ENTRY* arp)
+{
+    if (arp->tx_count >= ROUTE_QUEUE_DEPTH || tcpips->routes.queued >= ROUTE_QUEUE_MAX)
+    {
+        //no room for new neighbor
+        if (arp->tx_count == 0)
+        {
+            tcpips_release_io(tcpips, io);
+            ++tcpips->routes.drops_overflow;
+            return;
         }
+        //drop oldest to this neighbor
+        tcpips_release_io(tcpips, routes_dequeue(tcpips, arp));
+        ++tcpips->routes.drops_overflow;
+    }
+    io->queue = NULL;
+    if (arp->tx_head == NULL)
+        arp->tx_head = io;
+    else
+        arp->tx_tail->queue = io;
+    arp->tx_tail = io;
+    ++arp->tx_count;
+    ++tcpips->routes.queued;
 }
 
 void routes_tx(TCPIPS* tcpips, IO* io, const IP* target)
 {
-    ROUTE_QUEUE_ENTRY* item;
     //for gateway support forward should be declared here
     MAC mac;
-    if (arps_resolve(tcpips, target, &mac))
-        macs_tx(tcpips, io, &mac, ETHERTYPE_IP);
-    else
+    ARP_CACHE_ENTRY* arp;
+    switch (arps_resolve(tcpips, target, &mac, &arp))
     {
+    case ARP_RESOLVED:
+        macs_tx(tcpips, io, &mac, ETHERTYPE_IP);
+        break;
+    case ARP_PENDING:
         //queue before address is resolved
-        array_append(&tcpips->routes.tx_queue);
-        item = ROUTE_QUEUE_ITEM(tcpips, array_size(tcpips->routes.tx_queue) - 1);
-        item->io = io;
-        item->ip.u32.ip = target->u32.ip;
+        routes_enqueue(tcpips, io, arp);
+        break;
+    default:
+#if (ICMP)
+        icmps_no_route(tcpips, io);
+#endif //ICMP
+        tcpips_release_io(tcpips, io);
+        break;
     }
 }
@@ -12,12 +12,15 @@
  */
 
 #include "tcpips.h"
+#include "arps.h"
 #include "../../userspace/eth.h"
 #include "../../userspace/ip.h"
-#include "../../userspace/array.h"
 
 typedef struct {
-    ARRAY* tx_queue;
+    //frames, waiting for ARP resolve. Queues are kept on incomplete ARP entry
+    unsigned int queued;
+    //statistics: dropped on queue overflow, dropped on resolve failure
+    unsigned int drops_overflow, drops_unresolved;
 } ROUTES;
 
 //called from tcpip
@@ -26,8 +29,8 @@ bool routes_drop(TCPIPS* tcpips);
 void routes_link_changed(TCPIPS* tcpips, bool link);
 
 //called from arp
-void routes_resolved(TCPIPS* tcpips, const IP* ip, const MAC* mac);
-void routes_not_resolved(TCPIPS* tcpips, const IP* ip);
+void routes_resolved(TCPIPS* tcpips, ARP_CACHE_ENTRY* arp);
+void routes_not_resolved(TCPIPS* tcpips, ARP_CACHE_ENTRY* arp);
 
 //called from ip
 void routes_tx(TCPIPS* tcpips, IO* io, const IP* target);
@@ -12,6 +12,7 @@
 #include "../../userspace/stdio.h"
 #include "../../userspace/systime.h"
 #include "../../userspace/sys.h"
+#include "../../userspace/endian.h"
 #include "sys_config.h"
 #include "macs.h"
 #include "arps.h"
@@ -23,6 +24,11 @@
 
 #define FRAME_MAX_SIZE                          (TCPIP_MTU + sizeof(MAC_HEADER) + sizeof(IP_STACK))
 
+//frames per poll of driver rx ring in ETH_RX_POLLING mode
+#ifndef TCPIP_RX_POLL_BUDGET
+#define TCPIP_RX_POLL_BUDGET                    ETH_RX_RING_SIZE
+#endif //TCPIP_RX_POLL_BUDGET
+
 const IP __LOCALHOST =                          {{127, 0, 0, 1}};
 const IP __BROADCAST =                          {{255, 255, 255, 255}};
 
@@ -55,49 +61,40 @@ static void print_conn_status(TCPIPS* tcpips, const char* head, ETH_CONN_TYPE co
 }
 #endif
 
-static IO* tcpips_allocate_io_internal(TCPIPS* tcpips)
+static IO* tcpips_tx_dequeue(TCPIPS* tcpips, TCPIP_TX_CLASS cls)
 {
-    IO* io = NULL;
-    if (array_size(tcpips->free_io))
-    {
-        io = *((IO**)array_at(tcpips->free_io, array_size(tcpips->free_io) - 1));
-        array_remove(&tcpips->free_io, array_size(tcpips->free_io) - 1);
-    }
+    IO* io;
+    TCPIP_TX_QUEUE* queue = &tcpips->tx_queue[cls];
+    if (queue->count == 0)
+        return NULL;
+    io = queue->io[queue->head];
+    queue->head = (queue->head + 1) % TCPIP_TX_QUEUE_SIZE;
+    --queue->count;
     return io;
 }
 
+//classes share queue size, so control ring never overflows while bulk is evicted
+static inline bool tcpips_tx_full(TCPIPS* tcpips)
+{
+    return tcpips->tx_queue[TCPIP_TX_CONTROL].count + tcpips->tx_queue[TCPIP_TX_BULK].count >= TCPIP_TX_QUEUE_SIZE;
+}
+
 IO* tcpips_allocate_io(TCPIPS* tcpips)
 {
-    IO* io = tcpips_allocate_io_internal(tcpips);
-    if (io == NULL)
+    IO* io;
+    if (tcpips->io_allocated >= TCPIP_MAX_FRAMES_COUNT)
     {
-        if (tcpips->io_allocated < TCPIP_MAX_FRAMES_COUNT)
-        {
-            io = io_create(FRAME_MAX_SIZE + tcpips->eth_header_size);
-            if (io != NULL)
-            {
-                ++tcpips->io_allocated;
-                io->data_offset += tcpips->eth_header_size;
-            }
-#if (TCPIP_DEBUG_ERRORS)
-            else
-                printf("TCPIP: out of memory\n");
-#endif
-        }
         //try to drop first in queue, waiting for resolve
-        else if (routes_drop(tcpips))
+        if (routes_drop(tcpips))
         {
-            io = tcpips_allocate_io_internal(tcpips);
 #if (TCPIP_DEBUG)
             printf("TCPIP warning: io dropped from route queue\n");
 #endif
         }
-        else if (array_size(tcpips->tx_queue))
+        //bulk is dropped before control
+        else if ((io = tcpips_tx_dequeue(tcpips, TCPIP_TX_BULK)) != NULL || (io = tcpips_tx_dequeue(tcpips, TCPIP_TX_CONTROL)) != NULL)
         {
-            io = *((IO**)array_at(tcpips->tx_queue, 0));
-            array_remove(&tcpips->tx_queue, 0);
             tcpips_release_io(tcpips, io);
-            io = tcpips_allocate_io_internal(tcpips);
 #if (TCPIP_DEBUG)
             printf("TCPIP warning: io dropped from tx queue\n");
 #endif
@@ -108,43 +105,142 @@ IO* tcpips_allocate_io(TCPIPS* tcpips)
 #if (TCPIP_DEBUG_ERRORS)
             printf("TCPIP: too many ios\n");
 #endif
+            return NULL;
         }
     }
+    //IO buffers are shared with drivers through kernel IO pool
+    io = io_create(FRAME_MAX_SIZE + tcpips->eth_header_size);
+    if (io == NULL)
+    {
+#if (TCPIP_DEBUG_ERRORS)
+        printf("TCPIP: out of memory\n");
+#endif
+        return NULL;
+    }
+    ++tcpips->io_allocated;
+    io->data_offset += tcpips->eth_header_size;
     return io;
 }
 
+//keep rx ring of driver filled
+static void tcpips_rx_fill(TCPIPS* tcpips)
+{
+    IO* io;
+    IO* head = NULL;
+    while (tcpips->connected && (tcpips->rx_count < tcpips->eth_rx_ring))
+    {
+        //only last rx frame is allowed to drop queued tx
+        if (tcpips->rx_count && (tcpips->io_allocated >= TCPIP_MAX_FRAMES_COUNT))
+            break;
+        io = tcpips_allocate_io(tcpips);
+        if (io == NULL)
+            break;
+        ++tcpips->rx_count;
+        io->next = head;
+        head = io;
+    }
+    //whole chain is posted in single request
+    if (head != NULL)
+        io_read(tcpips->eth, HAL_IO_REQ(HAL_ETH, IPC_READ), tcpips->eth_handle, head, FRAME_MAX_SIZE);
+}
+
 void tcpips_release_io(TCPIPS* tcpips, IO* io)
 {
-    IO** iop;
-    io_reset(io);
-    io->data_offset += tcpips->eth_header_size;
-    iop = array_append(&tcpips->free_io);
-    if (iop)
-        *iop = io;
+    io_destroy(io);
+    --tcpips->io_allocated;
 }
 
-static void tcpips_rx_next(TCPIPS* tcpips)
+static TCPIP_TX_CLASS tcpips_tx_class(IO* io)
 {
-    IO* io = tcpips_allocate_io(tcpips);
-    if (io == NULL)
-        return;
-    io_read(tcpips->eth, HAL_IO_REQ(HAL_ETH, IPC_READ), tcpips->eth_handle, io, FRAME_MAX_SIZE);
+    MAC_HEADER* mac = io_data(io);
+    IP_HEADER* ip = (IP_HEADER*)(mac + 1);
+    uint8_t* tcp;
+    unsigned int hdr_size;
+    switch (be2short(mac->lentype_be))
+    {
+    case ETHERTYPE_ARP:
+        return TCPIP_TX_CONTROL;
+    case ETHERTYPE_IP:
+        break;
+    default:
+        return TCPIP_TX_BULK;
+    }
+    switch (ip->proto)
+    {
+    case PROTO_ICMP:
+        return TCPIP_TX_CONTROL;
+    case PROTO_TCP:
+        //TCP header is in head segment of first fragment
+        hdr_size = (ip->ver_ihl & 0xf) << 2;
+        if ((be2short(ip->flags_offset_be) & 0x1fff) || (io->data_size < sizeof(MAC_HEADER) + hdr_size + 20))
+            break;
+        tcp = (uint8_t*)ip + hdr_size;
+        //data offset and flags. FIN is kept in order with data
+        if (((tcp[13] & TCP_FLAG_FIN) == 0) && (be2short(ip->total_len_be) == hdr_size + ((tcp[12] >> 4) << 2)))
+            return TCPIP_TX_CONTROL;
+        break;
+    default:
+        break;
+    }
+    return TCPIP_TX_BULK;
 }
 
 void tcpips_tx(TCPIPS* tcpips, IO *io)
 {
-#if (ETH_DOUBLE_BUFFERING)
-    if (++tcpips->tx_count > 2)
-#else
-    if (++tcpips->tx_count > 1)
+    TCPIP_TX_CLASS cls;
+    TCPIP_TX_QUEUE* queue;
+    if (tcpips->tx_count < tcpips->eth_tx_ring)
+    {
+        ++tcpips->tx_count;
+        io_write(tcpips->eth, HAL_IO_REQ(HAL_ETH, IPC_WRITE), tcpips->eth_handle, io);
+        return;
+    }
+    cls = tcpips_tx_class(io);
+    //oldest bulk is dropped on overflow, control only if no bulk is queued
+    if (tcpips_tx_full(tcpips))
+    {
+#if (TCPIP_DEBUG)
+        printf("TCPIP warning: tx queue overflow\n");
 #endif
+        if (tcpips->tx_queue[TCPIP_TX_BULK].count)
+            tcpips_release_io(tcpips, tcpips_tx_dequeue(tcpips, TCPIP_TX_BULK));
+        else if (cls == TCPIP_TX_BULK)
+        {
+            tcpips_release_io(tcpips, io);
+            return;
+        }
+        else
+            tcpips_release_io(tcpips, tcpips_tx_dequeue(tcpips, TCPIP_TX_CONTROL));
+    }
+    queue = &tcpips->tx_queue[cls];
+    queue->io[(queue->head + queue->count++) % TCPIP_TX_QUEUE_SIZE] = io;
+}
+
+static void tcpips_tx_requeue(TCPIPS* tcpips, IO* io)
+{
+    TCPIP_TX_CLASS cls = tcpips_tx_class(io);
+    TCPIP_TX_QUEUE* queue;
+    //rejected frame is sent first. On overflow newest bulk is dropped, control only if no bulk is queued
+    if (tcpips_tx_full(tcpips))
     {
-        //add to queue
-        array_append(&tcpips->tx_queue);
-        *((IO**)array_at(tcpips->tx_queue, array_size(tcpips->tx_queue) - 1)) = io;
+        queue = &tcpips->tx_queue[TCPIP_TX_BULK];
+        if (queue->count)
+            tcpips_release_io(tcpips, queue->io[(queue->head + --queue->count) % TCPIP_TX_QUEUE_SIZE]);
+        else if (cls == TCPIP_TX_BULK)
+        {
+            tcpips_release_io(tcpips, io);
+            return;
+        }
+        else
+        {
+            queue = &tcpips->tx_queue[TCPIP_TX_CONTROL];
+            tcpips_release_io(tcpips, queue->io[(queue->head + --queue->count) % TCPIP_TX_QUEUE_SIZE]);
+        }
     }
-    else
-        io_write(tcpips->eth, HAL_IO_REQ(HAL_ETH, IPC_WRITE), tcpips->eth_handle, io);
+    queue = &tcpips->tx_queue[cls];
+    queue->head = (queue->head + TCPIP_TX_QUEUE_SIZE - 1) % TCPIP_TX_QUEUE_SIZE;
+    queue->io[queue->head] = io;
+    ++queue->count;
 }
 
 static inline void tcpips_open(TCPIPS* tcpips, unsigned int eth_handle, HANDLE eth, ETH_CONN_TYPE conn, HANDLE app)
@@ -162,6 +258,8 @@ static inline void tcpips_open(TCPIPS* tcpips, unsigned int eth_handle, HANDLE e
     tcpips->app = app;
     ack(tcpips->eth, HAL_REQ(HAL_ETH, IPC_OPEN), tcpips->eth_handle, conn, 0);
     tcpips->eth_header_size = eth_get_header_size(tcpips->eth, tcpips->eth_handle);
+    tcpips->eth_features = eth_get_features(tcpips->eth, tcpips->eth_handle);
+    eth_get_ring_size(tcpips->eth, tcpips->eth_handle, &tcpips->eth_rx_ring, &tcpips->eth_tx_ring);
 }
 
 static void tcpips_close_internal(TCPIPS* tcpips)
@@ -183,36 +281,103 @@ static inline void tcpips_close(TCPIPS* tcpips)
 
 static inline void tcpips_eth_rx(TCPIPS* tcpips, IO* io, int param3)
 {
-    if (tcpips->connected)
-        tcpips_rx_next(tcpips);
+    IO* next;
     if (param3 < 0)
     {
-        tcpips_release_io(tcpips, io);
+        //rest of posted chain is returned on error
+        for (; io != NULL; io = next)
+        {
+            next = io->next;
+            io->next = NULL;
+            --tcpips->rx_count;
+            tcpips_release_io(tcpips, io);
+        }
+        //driver ring is shorter than reported, retry will fail
+        if (param3 == ERROR_IN_PROGRESS)
+        {
+            if (tcpips->rx_count)
+                tcpips->eth_rx_ring = tcpips->rx_count;
+            return;
+        }
+        tcpips_rx_fill(tcpips);
         return;
     }
+    --tcpips->rx_count;
+    tcpips_rx_fill(tcpips);
+#if (TCPIP_DEBUG_RX_STATS)
+    ++tcpips->rx_frames;
+    ++tcpips->rx_irqs;
+    ++tcpips->rx_ipcs;
+#endif //TCPIP_DEBUG_RX_STATS
+    tcpips->rx_checksum_ok = (tcpips->eth_features & ETH_FEATURE_RX_CHECKSUM) && (param3 & ETH_RX_CHECKSUM_OK);
     //forward to MAC
     macs_rx(tcpips, io);
+    tcpips->rx_checksum_ok = false;
+    //ring was not filled due to frames shortage
+    tcpips_rx_fill(tcpips);
+}
+
+static inline void tcpips_eth_rx_batch(TCPIPS* tcpips, IO* io, unsigned int param3)
+{
+    IO* next;
+    for (next = io; next != NULL; next = next->next)
+        --tcpips->rx_count;
+    tcpips_rx_fill(tcpips);
+#if (TCPIP_DEBUG_RX_STATS)
+    ++tcpips->rx_ipcs;
+    if (!tcpips->rx_poll_pending)
+        ++tcpips->rx_irqs;
+    tcpips->rx_poll_pending = false;
+#endif //TCPIP_DEBUG_RX_STATS
+    for (; io != NULL; io = next)
+    {
+        next = io->next;
+        io->next = NULL;
+#if (TCPIP_DEBUG_RX_STATS)
+        ++tcpips->rx_frames;
+#endif //TCPIP_DEBUG_RX_STATS
+        //checksum flag of every frame is on its stack
+        if (tcpips->eth_features & ETH_FEATURE_RX_CHECKSUM)
+        {
+            tcpips->rx_checksum_ok = (((ETH_RX_STACK*)io_stack(io))->flags & ETH_RX_CHECKSUM_OK) != 0;
+            io_pop(io, sizeof(ETH_RX_STACK));
+        }
+        macs_rx(tcpips, io);
+    }
+    tcpips->rx_checksum_ok = false;
+    tcpips_rx_fill(tcpips);
+    //rx interrupt is masked by driver
+    if (param3 & ETH_RX_POLL)
+    {
+#if (TCPIP_DEBUG_RX_STATS)
+        tcpips->rx_poll_pending = true;
+#endif //TCPIP_DEBUG_RX_STATS
+        ipc_post_inline(tcpips->eth, HAL_CMD(HAL_ETH, ETH_POLL), tcpips->eth_handle, TCPIP_RX_POLL_BUDGET, 0);
+    }
 }
 
 static inline void tcpips_eth_tx_complete(TCPIPS* tcpips, IO* io, int param3)
 {
     IO* queue_io;
-    tcpips_release_io(tcpips, io);
-#if (ETH_DOUBLE_BUFFERING)
-    if (--tcpips->tx_count >= 2)
-#else
-    if (--tcpips->tx_count >= 1)
-#endif
+    if ((param3 == ERROR_IN_PROGRESS) && (tcpips->tx_count > 1))
     {
-        //send next in queue
-        queue_io = *((IO**)array_at(tcpips->tx_queue, 0));
-        array_remove(&tcpips->tx_queue, 0);
-        io_write(tcpips->eth, HAL_IO_REQ(HAL_ETH, IPC_WRITE), tcpips->eth_handle, queue_io);
+        //driver ring is shorter than reported, resend after next completion
+        tcpips->eth_tx_ring = --tcpips->tx_count;
+        tcpips_tx_requeue(tcpips, io);
+        return;
     }
+    tcpips_release_io(tcpips, io);
+    //send next in queue, control first
+    if ((queue_io = tcpips_tx_dequeue(tcpips, TCPIP_TX_CONTROL)) != NULL || (queue_io = tcpips_tx_dequeue(tcpips, TCPIP_TX_BULK)) != NULL)
+        io_write(tcpips->eth, HAL_IO_REQ(HAL_ETH, IPC_WRITE), tcpips->eth_handle, queue_io);
+    else
+        --tcpips->tx_count;
+    tcpips_rx_fill(tcpips);
 }
 
 static void tcpips_link_changed_internal(TCPIPS* tcpips, ETH_CONN_TYPE conn)
 {
+    IO* io;
     bool was_connected = tcpips->connected;
     tcpips->conn = conn;
     tcpips->connected = ((conn != ETH_NO_LINK) && (conn != ETH_REMOTE_FAULT));
@@ -220,21 +385,12 @@ static void tcpips_link_changed_internal(TCPIPS* tcpips, ETH_CONN_TYPE conn)
         return;
 
     if (tcpips->connected)
-    {
-        tcpips_rx_next(tcpips);
-#if (ETH_DOUBLE_BUFFERING)
-        tcpips_rx_next(tcpips);
-#endif
-    }
+        tcpips_rx_fill(tcpips);
     else
     {
         //flush TX queue
-        while (array_size(tcpips->tx_queue))
-        {
-            tcpips_release_io(tcpips, array_at(tcpips->tx_queue, 0));
-            array_remove(&tcpips->tx_queue, 0);
-            --tcpips->tx_count;
-        }
+        while ((io = tcpips_tx_dequeue(tcpips, TCPIP_TX_CONTROL)) != NULL || (io = tcpips_tx_dequeue(tcpips, TCPIP_TX_BULK)) != NULL)
+            tcpips_release_io(tcpips, io);
     }
     macs_link_changed(tcpips, tcpips->connected);
     arps_link_changed(tcpips, tcpips->connected);
@@ -273,21 +429,24 @@ static inline void tcpips_eth_remote_close(TCPIPS* tcpips)
 
 void tcpips_init(TCPIPS* tcpips)
 {
+    unsigned int i;
     tcpips->app = INVALID_HANDLE;
     tcpips->timer = INVALID_HANDLE;
     tcpips->conn = ETH_NO_LINK;
     tcpips->connected = false;
     tcpips->io_allocated = 0;
     tcpips->eth_header_size = 0;
-#if (ETH_DOUBLE_BUFFERING)
-    //2 rx + 2 tx + 1 for processing
-    array_create(&tcpips->free_io, sizeof(IO*), 5);
-#else
-    //1 rx + 1 tx + 1 for processing
-    array_create(&tcpips->free_io, sizeof(IO*), 3);
-#endif
-    array_create(&tcpips->tx_queue, sizeof(IO*), 1);
+    tcpips->eth_features = 0;
+    tcpips->eth_rx_ring = tcpips->eth_tx_ring = 1;
+    tcpips->rx_checksum_ok = false;
+    for (i = 0; i < TCPIP_TX_CLASSES; ++i)
+        tcpips->tx_queue[i].head = tcpips->tx_queue[i].count = 0;
     tcpips->tx_count = 0;
+    tcpips->rx_count = 0;
+#if (TCPIP_DEBUG_RX_STATS)
+    tcpips->rx_frames = tcpips->rx_irqs = tcpips->rx_ipcs = 0;
+    tcpips->rx_poll_pending = false;
+#endif //TCPIP_DEBUG_RX_STATS
     macs_init(tcpips);
     arps_init(tcpips);
     routes_init(tcpips);
@@ -312,9 +471,17 @@ static inline void tcpips_timer(TCPIPS* tcpips)
     if (tcpips->connected)
     {
         ++tcpips->seconds;
+        tcpips_rx_fill(tcpips);
+#if (TCPIP_DEBUG_RX_STATS)
+        printf("TCPIP rx: %d frames, %d irq, %d ipc\n", tcpips->rx_frames, tcpips->rx_irqs, tcpips->rx_ipcs);
+        tcpips->rx_frames = tcpips->rx_irqs = tcpips->rx_ipcs = 0;
+#endif //TCPIP_DEBUG_RX_STATS
         //forward to others
         arps_timer(tcpips, tcpips->seconds);
         icmps_timer(tcpips, tcpips->seconds);
+#if (MAC_PCAP)
+        macs_timer(tcpips, tcpips->seconds);
+#endif //MAC_PCAP
 #if (IP_FRAGMENTATION)
         ips_timer(tcpips, tcpips->seconds);
 #endif //IP_FRAGMENTATION
@@ -360,6 +527,9 @@ static inline void tcpips_driver_event(TCPIPS* tcpips, IPC* ipc)
     case IPC_WRITE:
         tcpips_eth_tx_complete(tcpips, (IO*)ipc->param2, (int)ipc->param3);
         break;
+    case ETH_POLL:
+        tcpips_eth_rx_batch(tcpips, (IO*)ipc->param2, ipc->param3);
+        break;
     case ETH_NOTIFY_LINK_CHANGED:
         tcpips_link_changed(tcpips, ipc->param2);
         break;
@@ -22,16 +22,41 @@
 #include "dhcps.h"
 #include "sys_config.h"
 
+//frames of all tx classes, waiting for free driver descriptor
+#ifndef TCPIP_TX_QUEUE_SIZE
+#define TCPIP_TX_QUEUE_SIZE                     TCPIP_MAX_FRAMES_COUNT
+#endif //TCPIP_TX_QUEUE_SIZE
+
+typedef enum {
+    //ARP, ICMP, TCP without payload. Sent first, dropped last
+    TCPIP_TX_CONTROL = 0,
+    TCPIP_TX_BULK,
+    TCPIP_TX_CLASSES
+} TCPIP_TX_CLASS;
+
+typedef struct {
+    IO* io[TCPIP_TX_QUEUE_SIZE];
+    unsigned int head, count;
+} TCPIP_TX_QUEUE;
+
 typedef struct _TCPIPS {
     //stack itself - public use
     HANDLE eth, timer, app;
     unsigned seconds;
     ETH_CONN_TYPE conn;
     //stack itself - private use
-    unsigned int io_allocated, tx_count, eth_handle, eth_header_size;
-    ARRAY* free_io;
-    ARRAY* tx_queue;
+    unsigned int io_allocated, tx_count, rx_count, eth_handle, eth_header_size, eth_features;
+    //reads and writes, accepted by driver at once
+    unsigned int eth_rx_ring, eth_tx_ring;
+    TCPIP_TX_QUEUE tx_queue[TCPIP_TX_CLASSES];
     bool connected;
+    //checksums of frame in processing are verified by MAC
+    bool rx_checksum_ok;
+#if (TCPIP_DEBUG_RX_STATS)
+    //per second: received frames, interrupt driven completions, completions IPC
+    unsigned int rx_frames, rx_irqs, rx_ipcs;
+    bool rx_poll_pending;
+#endif //TCPIP_DEBUG_RX_STATS
     MACS macs;
     IPS ips;
     ARPS arps;
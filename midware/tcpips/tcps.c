@@ -16,8 +16,51 @@
 
 #define TCP_MSS_MAX                                      (IP_FRAME_MAX_DATA_SIZE - sizeof(TCP_HEADER))
 #define TCP_MSS_MIN                                      536
+#define TCP_PORT_HASH(port)                              ((port) & (TCP_HASH_SIZE - 1))
 
 #define MSL_MS                                           60000
+//RFC 5681 initial window
+#define TCP_IW(mss)                                      ((mss) > 2190 ? 2 * (mss) : ((mss) > 1095 ? 3 * (mss) : 4 * (mss)))
+//no more than ssthresh in initial slow start
+#define TCP_SSTHRESH_MAX                                 0xffff
+//RFC 5681 fast retransmit
+#define TCP_DUPACK_THRESHOLD                             3
+//RFC 6298 retransmission timeout, ms. Upper bound is TCP_TIMEOUT
+#define TCP_RTO_INITIAL                                  1000
+#ifndef TCP_RTO_MIN
+#define TCP_RTO_MIN                                      1000
+#endif //TCP_RTO_MIN
+//RFC 1122 delayed ACK, ms. 0 - ACK every segment
+#ifndef TCP_DELAYED_ACK
+#define TCP_DELAYED_ACK                                  200
+#endif //TCP_DELAYED_ACK
+//out of order segments, held per connection. 0 - drop
+#ifndef TCP_OOO_MAX
+#define TCP_OOO_MAX                                      4
+#endif //TCP_OOO_MAX
+//RFC 7323 receive window scale shift, up to 14. 0 - window is limited by 64K
+#ifndef TCP_WSCALE
+#define TCP_WSCALE                                       0
+#endif //TCP_WSCALE
+#define TCP_WSCALE_MAX                                   14
+//RFC 7323 timestamps, used for RTT measurement and PAWS
+#ifndef TCP_TIMESTAMPS
+#define TCP_TIMESTAMPS                                   1
+#endif //TCP_TIMESTAMPS
+//NOOP, NOOP, timestamps
+#define TCP_TS_SIZE                                      12
+//RFC 2018: 4 blocks fill options space, 3 with timestamps
+#define TCP_SACK_BLOCKS_MAX                              4
+
+//not sent user blocks are returned on close as chain of no more segments. Kernel limit, KERNEL_IO_MAX_SEGMENTS
+#ifndef TCP_CLOSE_SEGMENTS
+#define TCP_CLOSE_SEGMENTS                               64
+#endif //TCP_CLOSE_SEGMENTS
+
+//zero-copy read: frames per connection, queued and separately owned by user
+#ifndef TCP_ZC_FRAMES
+#define TCP_ZC_FRAMES                                    TCPIP_MAX_FRAMES_COUNT
+#endif //TCP_ZC_FRAMES
 
 #pragma pack(push, 1)
 typedef struct {
@@ -41,7 +84,7 @@ typedef struct {
 #pragma pack(pop)
 
 typedef struct {
-    HANDLE process;
+    HANDLE process, next;
     uint16_t port;
 } TCP_LISTEN_HANDLE;
 
@@ -63,14 +106,42 @@ typedef struct {
     IP remote_addr;
     IO* rx;
     IO* rx_tmp;
+    //out of order segments, sorted by sequence, linked by io->queue
+    IO* ooo;
+    //zero-copy read: in order frames, not given to user yet, linked by io->queue
+    IO* rx_zc;
+    //queue of user blocks, linked by io->queue. tx_cur is acked offset in first
     IO* tx;
     HANDLE timer;
-    unsigned int tx_cur, rx_cur;
-    uint32_t snd_una, snd_nxt, rcv_nxt;
+    //index chains
+    HANDLE hash_next, port_next;
+    //rx_cur is received sequence space to ACK now, rx_unacked is count of text segments with delayed ACK
+    //rx_gap is sequence space after RCV.NXT, seen out of order
+    unsigned int tx_cur, rx_cur, rx_unacked, rx_gap, cwnd, ssthresh;
+    //windows in bytes, not scaled
+    unsigned int rx_wnd, tx_wnd;
+    //zero-copy frames: queued, owned by user
+    unsigned int rx_zc_frames, rx_zc_held;
+    //smoothed RTT x8, RTT variation x4, ms
+    unsigned int srtt, rttvar, rto;
+    //snd_max is highest sent, snd_end is end of queued data, including FIN
+    //rcv_adv is right edge of last advertised window
+    uint32_t snd_una, snd_nxt, snd_max, snd_end, rcv_nxt, rcv_adv;
+    //NewReno recovery point
+    uint32_t recover;
+    //sequence of most recently held out of order segment
+    uint32_t sack_seq;
+    //timestamp to echo, RCV.NXT in last sent ACK
+    uint32_t ts_recent, last_ack;
+    //timed segment, only one at time
+    uint32_t rtt_seq;
+    SYSTIME rtt_time;
 
     TCP_STATE state;
-    uint16_t remote_port, local_port, mss, rx_wnd, tx_wnd, retry;
-    bool active, transmit, fin;
+    uint16_t remote_port, local_port, mss, retry, dupacks;
+    uint8_t snd_wscale, rcv_wscale;
+    //sack, wscale, ts - options, negotiated on SYN. zc - zero-copy read mode, zc_read - user is waiting for frame
+    bool active, transmit, fin, rtt_active, recovery, sack, wscale, ts, zc, zc_read;
 } TCP_TCB;
 
 #if (TCP_DEBUG_PACKETS)
@@ -115,13 +186,8 @@ static uint32_t tcps_delta(uint32_t from, uint32_t to)
 
 static int tcps_diff(uint32_t from, uint32_t to)
 {
-    uint32_t res = tcps_delta(from, to);
-    if (res <= 0xffff)
-        return (int)res;
-    res = tcps_delta(to, from);
-    if (res <= 0xffff)
-        return -(int)res;
-    return 0x10000;
+    //scaled window can be more than 64K
+    return (int)(to - from);
 }
 
 static unsigned int tcps_get_first_opt(IO* io)
@@ -194,6 +260,77 @@ static void tcps_append_mss(IO* io)
     tcps_append_opt(io, TCP_OPTS_MSS, mss_be, 2 + 2);
 }
 
+static void tcps_append_wscale(IO* io)
+{
+    uint8_t shift = TCP_WSCALE;
+    tcps_append_opt(io, TCP_OPTS_NOOP, NULL, 1);
+    tcps_append_opt(io, TCP_OPTS_WSCALE, &shift, 2 + 1);
+}
+
+static uint32_t tcps_ts_now()
+{
+    SYSTIME uptime;
+    get_uptime(&uptime);
+    return uptime.sec * 1000 + uptime.usec / 1000;
+}
+
+static void tcps_append_ts(IO* io, uint32_t ecr)
+{
+    uint8_t ts_be[8];
+    int2be(ts_be, tcps_ts_now());
+    int2be(ts_be + 4, ecr);
+    tcps_append_opt(io, TCP_OPTS_NOOP, NULL, 1);
+    tcps_append_opt(io, TCP_OPTS_NOOP, NULL, 1);
+    tcps_append_opt(io, TCP_OPTS_TIMESTAMPS, ts_be, 2 + 8);
+}
+
+static bool tcps_get_ts(IO* io, uint32_t* val, uint32_t* ecr)
+{
+    int i;
+    TCP_OPT* opt;
+    for (i = tcps_get_first_opt(io); i; i = tcps_get_next_opt(io, i))
+    {
+        opt = (TCP_OPT*)((uint8_t*)io_data(io) + i);
+        if (opt->kind == TCP_OPTS_TIMESTAMPS && opt->len == 2 + 8)
+        {
+            *val = be2int(opt->data);
+            *ecr = be2int(opt->data + 4);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void tcps_append_sack(IO* io, TCP_TCB* tcb)
+{
+    IO* cur;
+    unsigned int count;
+    uint32_t left, right;
+    uint8_t blocks[TCP_SACK_BLOCKS_MAX * 8];
+    for (cur = tcb->ooo, count = 0; cur != NULL && count < (tcb->ts ? TCP_SACK_BLOCKS_MAX - 1 : TCP_SACK_BLOCKS_MAX); ++count)
+    {
+        //merge contiguous segments in single block
+        left = be2int(((TCP_HEADER*)io_data(cur))->seq_be);
+        right = left + tcps_data_len(cur);
+        for (cur = cur->queue; cur != NULL && be2int(((TCP_HEADER*)io_data(cur))->seq_be) == right; cur = cur->queue)
+            right += tcps_data_len(cur);
+        //RFC 2018: block with most recently received segment goes first
+        if (count && tcps_diff(left, tcb->sack_seq) >= 0 && tcps_diff(tcb->sack_seq, right) > 0)
+        {
+            memmove(blocks + 8, blocks, count * 8);
+            int2be(blocks, left);
+            int2be(blocks + 4, right);
+        }
+        else
+        {
+            int2be(blocks + count * 8, left);
+            int2be(blocks + count * 8 + 4, right);
+        }
+    }
+    if (count)
+        tcps_append_opt(io, TCP_OPTS_SACK, blocks, 2 + count * 8);
+}
+
 #if (TCP_DEBUG_PACKETS)
 static void tcps_debug(IO* io, const IP* src, const IP* dst)
 {
@@ -227,14 +364,16 @@ static void tcps_debug(IO* io, const IP* src, const IP* dst)
         printf("<DATA=%d byte(s)>", tcps_data_len(io));
     if ((i = tcps_get_first_opt(io)) != 0)
     {
-        tcps_append_opt(io, 0, NULL, 0);
         has_flag = false;
         printf("<OPTS=");
         for (; i; i = tcps_get_next_opt(io, i))
         {
+            opt = (TCP_OPT*)((uint8_t*)io_data(io) + i);
+            //padding
+            if (opt->kind == TCP_OPTS_END)
+                break;
             if (has_flag)
                 printf(",");
-            opt = (TCP_OPT*)((uint8_t*)io_data(io) + i);
             switch(opt->kind)
             {
             case TCP_OPTS_NOOP:
@@ -243,6 +382,20 @@ static void tcps_debug(IO* io, const IP* src, const IP* dst)
             case TCP_OPTS_MSS:
                 printf("MSS:%d", be2short(opt->data));
                 break;
+            case TCP_OPTS_WSCALE:
+                printf("WS:%d", opt->data[0]);
+                break;
+            case TCP_OPTS_SACK_PERMITTED:
+                printf("SACK_PERM");
+                break;
+            case TCP_OPTS_TIMESTAMPS:
+                printf("TS:%u/%u", be2int(opt->data), be2int(opt->data + 4));
+                break;
+            case TCP_OPTS_SACK:
+                printf("SACK");
+                for (j = 0; j + 8 <= opt->len - 2; j += 8)
+                    printf("%s%u-%u", j ? " " : ":", be2int(opt->data + j), be2int(opt->data + j + 4));
+                break;
             default:
                 printf("K%d", opt->kind);
                 for (j = 0; j < opt->len - 2; ++j)
@@ -273,6 +426,8 @@ static inline void tcps_set_state(TCP_TCB* tcb, TCP_STATE state)
 #endif //TCP_DEBUG_FLOW
     tcb->state = state;
     tcb->retry = 0;
+    if (state == TCP_STATE_ESTABLISHED)
+        tcb->cwnd = TCP_IW(tcb->mss);
 }
 
 static uint32_t tcps_gen_isn()
@@ -283,28 +438,159 @@ static uint32_t tcps_gen_isn()
     return (uptime.sec % 17179) + (uptime.usec >> 2);
 }
 
-static bool tcps_update_rx_wnd(TCP_TCB* tcb)
+static inline bool tcps_rx_wnd_opened(TCP_TCB* tcb)
 {
-    bool need_update = tcb->rx_wnd < (TCP_MSS_MAX / 2);
-    tcb->rx_wnd = TCP_MSS_MAX;
-    if (tcb->rx != NULL)
-        tcb->rx_wnd += io_get_free(tcb->rx);
-    if (tcb->rx_tmp != NULL)
-        tcb->rx_wnd = io_get_free(tcb->rx_tmp);
-    return need_update;
+    //RFC 1122 receiver SWS avoidance: update peer if right edge moved by MSS. Segment with timestamps is shorter
+    return tcps_diff(tcb->rcv_adv, tcb->rcv_nxt + tcb->rx_wnd) >= (int)(TCP_MSS_MAX - (tcb->ts ? TCP_TS_SIZE : 0));
+}
+
+static bool tcps_update_rx_wnd(TCPIPS* tcpips, TCP_TCB* tcb)
+{
+    unsigned int frames, free;
+    //zero-copy: each free frame holds one full segment. Frames, owned by user, are limited on give
+    if (tcb->zc)
+    {
+        frames = tcb->rx_zc_frames < TCP_ZC_FRAMES ? TCP_ZC_FRAMES - tcb->rx_zc_frames : 0;
+        //posted for rx are free. Keep 2 for rx refill and ACK/control, while user is not reading
+        free = TCPIP_MAX_FRAMES_COUNT + tcpips->rx_count - tcpips->io_allocated;
+        free = free > 2 ? free - 2 : 0;
+        if (frames > free)
+            frames = free;
+        tcb->rx_wnd = frames * (TCP_MSS_MAX - (tcb->ts ? TCP_TS_SIZE : 0));
+        //RFC 1122: window is not shrunk, segment in it is already in frame
+        if (tcps_diff(tcb->rcv_nxt, tcb->rcv_adv) > (int)tcb->rx_wnd)
+            tcb->rx_wnd = tcps_diff(tcb->rcv_nxt, tcb->rcv_adv);
+    }
+    else
+    {
+        tcb->rx_wnd = TCP_MSS_MAX;
+        if (tcb->rx != NULL)
+            tcb->rx_wnd += io_get_free(tcb->rx);
+        if (tcb->rx_tmp != NULL)
+            tcb->rx_wnd = io_get_free(tcb->rx_tmp);
+    }
+    //accept only, what can be advertised
+    if (tcb->rx_wnd > (0xffff << tcb->rcv_wscale))
+        tcb->rx_wnd = 0xffff << tcb->rcv_wscale;
+    tcb->rx_wnd &= ~((1 << tcb->rcv_wscale) - 1);
+    return tcps_rx_wnd_opened(tcb);
+}
+
+//RFC 7323: window in SYN is never scaled
+static inline unsigned int tcps_get_tx_wnd(TCP_TCB* tcb, TCP_HEADER* tcp)
+{
+    if (tcp->flags & TCP_FLAG_SYN)
+        return be2short(tcp->window_be);
+    return be2short(tcp->window_be) << tcb->snd_wscale;
 }
 
 static void tcps_timer_start(TCP_TCB* tcb)
 {
-    switch (tcb->state)
+    unsigned int timeout = tcb->rto;
+    //idle
+    if (tcb->state == TCP_STATE_ESTABLISHED && !tcb->transmit)
+#if (TCP_KEEP_ALIVE)
+        timeout = TCP_TIMEOUT;
+#else
+        timeout = 0;
+#endif //TCP_KEEP_ALIVE
+    //delayed ACK goes first
+    if (tcb->rx_unacked && (timeout == 0 || timeout > TCP_DELAYED_ACK))
+        timeout = TCP_DELAYED_ACK;
+    if (timeout)
+        timer_start_ms(tcb->timer, timeout);
+}
+
+static void tcps_rtt_sample(TCP_TCB* tcb, unsigned int rtt)
+{
+    int delta;
+    //clock granularity
+    if (rtt == 0)
+        rtt = 1;
+    //first measurement
+    if (tcb->srtt == 0)
     {
-    case TCP_STATE_ESTABLISHED:
-#if !(TCP_KEEP_ALIVE)
-        if (!tcb->transmit)
+        tcb->srtt = rtt << 3;
+        tcb->rttvar = rtt << 1;
+    }
+    else
+    {
+        //RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|, SRTT = 7/8 SRTT + 1/8 R
+        delta = (int)rtt - (int)(tcb->srtt >> 3);
+        tcb->srtt += delta;
+        if (delta < 0)
+            delta = -delta;
+        tcb->rttvar += delta - (int)(tcb->rttvar >> 2);
+    }
+    //RTO = SRTT + 4 * RTTVAR
+    tcb->rto = (tcb->srtt >> 3) + tcb->rttvar;
+    if (tcb->rto < TCP_RTO_MIN)
+        tcb->rto = TCP_RTO_MIN;
+    if (tcb->rto > TCP_TIMEOUT)
+        tcb->rto = TCP_TIMEOUT;
+}
+
+static void tcps_rx_release(TCPIPS* tcpips, IO* io)
+{
+    if (tcpips->tcps.rx_io == io)
+        tcpips->tcps.rx_io = NULL;
+    ips_release_io(tcpips, io);
+}
+
+static void tcps_rx_ooo_flush(TCPIPS* tcpips, TCP_TCB* tcb)
+{
+    IO* io;
+    while ((io = tcb->ooo) != NULL)
+    {
+        tcb->ooo = io->queue;
+        io->queue = NULL;
+        tcps_rx_release(tcpips, io);
+    }
+}
+
+//header is hidden, frame is owned by user until TCP_RELEASE_FRAME
+static void tcps_rx_zc_give(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    IO* io;
+    unsigned int i;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    if (!tcb->zc_read || (io = tcb->rx_zc) == NULL || tcb->rx_zc_held >= TCP_ZC_FRAMES)
+        return;
+    //frame is given only if it can be checked on release
+    for (i = 0; i < TCPIP_MAX_FRAMES_COUNT; ++i)
+        if (tcpips->tcps.zc_io[i] == NULL)
             break;
-#endif //!TCP_KEEP_ALIVE
-    default:
-        timer_start_ms(tcb->timer, TCP_TIMEOUT);
+    if (i >= TCPIP_MAX_FRAMES_COUNT)
+        return;
+    tcpips->tcps.zc_io[i] = io;
+    tcpips->tcps.zc_tcb[i] = tcb_handle;
+    --tcb->rx_zc_frames;
+    ++tcb->rx_zc_held;
+    tcb->rx_zc = io->queue;
+    io->queue = NULL;
+    tcb->zc_read = false;
+    if (tcpips->tcps.rx_io == io)
+        tcpips->tcps.rx_io = NULL;
+    io_hide(io, tcps_data_offset(io));
+    io_give(tcb->process, HAL_IO_CMD(HAL_TCP, TCP_READ_FRAME), tcb_handle, io, io->data_size);
+}
+
+static void tcps_rx_zc_flush(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    IO* io;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    tcps_rx_zc_give(tcpips, tcb_handle);
+    if (tcb->zc_read)
+    {
+        io_give(tcb->process, HAL_IO_CMD(HAL_TCP, TCP_READ_FRAME), tcb_handle, NULL, ERROR_CONNECTION_CLOSED);
+        tcb->zc_read = false;
+    }
+    while ((io = tcb->rx_zc) != NULL)
+    {
+        tcb->rx_zc = io->queue;
+        io->queue = NULL;
+        --tcb->rx_zc_frames;
+        tcps_rx_release(tcpips, io);
     }
 }
 
@@ -312,6 +598,7 @@ static void tcps_rx_flush(TCPIPS* tcpips, HANDLE tcb_handle)
 {
     TCP_STACK* tcp_stack;
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    tcps_rx_zc_flush(tcpips, tcb_handle);
     if (tcb->rx)
     {
         if (tcb->rx->data_size)
@@ -326,16 +613,25 @@ static void tcps_rx_flush(TCPIPS* tcpips, HANDLE tcb_handle)
     }
     if (tcb->rx_tmp)
     {
-        ips_release_io(tcpips, tcb->rx_tmp);
+        tcps_rx_release(tcpips, tcb->rx_tmp);
         tcb->rx_tmp = NULL;
     }
+    tcps_rx_ooo_flush(tcpips, tcb);
+}
+
+static inline unsigned int tcps_hash(const IP* remote_addr, uint16_t remote_port, uint16_t local_port)
+{
+    uint32_t res = remote_addr->u32.ip ^ ((uint32_t)remote_port << 16) ^ local_port;
+    res ^= res >> 16;
+    res ^= res >> 8;
+    return res & (TCP_HASH_SIZE - 1);
 }
 
 static HANDLE tcps_find_listener(TCPIPS* tcpips, uint16_t port)
 {
     HANDLE handle;
     TCP_LISTEN_HANDLE* tlh;
-    for (handle = so_first(&tcpips->tcps.listen); handle != INVALID_HANDLE; handle = so_next(&tcpips->tcps.listen, handle))
+    for (handle = tcpips->tcps.listen_hash[TCP_PORT_HASH(port)]; handle != INVALID_HANDLE; handle = tlh->next)
     {
         tlh = so_get(&tcpips->tcps.listen, handle);
         if (tlh->port == port)
@@ -348,7 +644,7 @@ static HANDLE tcps_find_tcb(TCPIPS* tcpips, const IP* src, uint16_t remote_port,
 {
     HANDLE handle;
     TCP_TCB* tcb;
-    for (handle = so_first(&tcpips->tcps.tcbs); handle != INVALID_HANDLE; handle = so_next(&tcpips->tcps.tcbs, handle))
+    for (handle = tcpips->tcps.tcb_hash[tcps_hash(src, remote_port, local_port)]; handle != INVALID_HANDLE; handle = tcb->hash_next)
     {
         tcb = so_get(&tcpips->tcps.tcbs, handle);
         if (tcb->remote_port == remote_port && tcb->local_port == local_port && tcb->remote_addr.u32.ip == src->u32.ip)
@@ -361,7 +657,7 @@ static HANDLE tcps_find_tcb_local_port(TCPIPS* tcpips, uint16_t local_port)
 {
     HANDLE handle;
     TCP_TCB* tcb;
-    for (handle = so_first(&tcpips->tcps.tcbs); handle != INVALID_HANDLE; handle = so_next(&tcpips->tcps.tcbs, handle))
+    for (handle = tcpips->tcps.port_hash[TCP_PORT_HASH(local_port)]; handle != INVALID_HANDLE; handle = tcb->port_next)
     {
         tcb = so_get(&tcpips->tcps.tcbs, handle);
         if (tcb->local_port == local_port)
@@ -370,6 +666,30 @@ static HANDLE tcps_find_tcb_local_port(TCPIPS* tcpips, uint16_t local_port)
     return INVALID_HANDLE;
 }
 
+static void tcps_hash_add(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    unsigned int hash;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    hash = tcps_hash(&tcb->remote_addr, tcb->remote_port, tcb->local_port);
+    tcb->hash_next = tcpips->tcps.tcb_hash[hash];
+    tcpips->tcps.tcb_hash[hash] = tcb_handle;
+    hash = TCP_PORT_HASH(tcb->local_port);
+    tcb->port_next = tcpips->tcps.port_hash[hash];
+    tcpips->tcps.port_hash[hash] = tcb_handle;
+}
+
+static void tcps_hash_remove(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    HANDLE* cur;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    for (cur = &tcpips->tcps.tcb_hash[tcps_hash(&tcb->remote_addr, tcb->remote_port, tcb->local_port)]; *cur != tcb_handle;
+         cur = &((TCP_TCB*)so_get(&tcpips->tcps.tcbs, *cur))->hash_next) {}
+    *cur = tcb->hash_next;
+    for (cur = &tcpips->tcps.port_hash[TCP_PORT_HASH(tcb->local_port)]; *cur != tcb_handle;
+         cur = &((TCP_TCB*)so_get(&tcpips->tcps.tcbs, *cur))->port_next) {}
+    *cur = tcb->port_next;
+}
+
 static HANDLE tcps_create_tcb_internal(TCPIPS* tcpips, const IP* remote_addr, uint16_t remote_port, uint16_t local_port)
 {
     TCP_TCB* tcb;
@@ -395,8 +715,13 @@ static HANDLE tcps_create_tcb_internal(TCPIPS* tcpips, const IP* remote_addr, ui
     tcb->retry = 0;
     tcb->process = INVALID_HANDLE;
     tcb->remote_addr.u32.ip = remote_addr->u32.ip;
-    tcb->snd_una = tcb->snd_nxt = 0;
-    tcb->rcv_nxt = 0;
+    tcb->snd_una = tcb->snd_nxt = tcb->snd_max = tcb->snd_end = tcb->recover = 0;
+    tcb->rcv_nxt = tcb->rcv_adv = tcb->last_ack = tcb->ts_recent = 0;
+    tcb->cwnd = TCP_IW(TCP_MSS_MAX);
+    tcb->ssthresh = TCP_SSTHRESH_MAX;
+    tcb->srtt = tcb->rttvar = 0;
+    tcb->rto = TCP_RTO_INITIAL;
+    tcb->dupacks = 0;
     tcb->state = TCP_STATE_CLOSED;
     tcb->remote_port = remote_port;
     tcb->local_port = local_port;
@@ -404,24 +729,58 @@ static HANDLE tcps_create_tcb_internal(TCPIPS* tcpips, const IP* remote_addr, ui
     tcb->active = false;
     tcb->transmit = false;
     tcb->fin = false;
-    tcb->rx = tcb->tx = tcb->rx_tmp = NULL;
-    tcb->tx_cur = 0;
-    tcps_update_rx_wnd(tcb);
+    tcb->rtt_active = false;
+    tcb->recovery = false;
+    tcb->sack = tcb->wscale = tcb->ts = false;
+    tcb->zc = tcb->zc_read = false;
+    tcb->snd_wscale = tcb->rcv_wscale = 0;
+    tcb->rx = tcb->tx = tcb->rx_tmp = tcb->ooo = tcb->rx_zc = NULL;
+    tcb->tx_cur = tcb->rx_unacked = tcb->rx_gap = tcb->rx_zc_frames = tcb->rx_zc_held = 0;
+    tcps_update_rx_wnd(tcpips, tcb);
     tcb->tx_wnd = 0;
+    tcps_hash_add(tcpips, handle);
     return handle;
 }
 
+static unsigned int tcps_segments(IO* io)
+{
+    unsigned int res;
+    for (res = 0; io != NULL; io = io->next)
+        ++res;
+    return res;
+}
+
 static void tcps_destroy_tcb(TCPIPS* tcpips, HANDLE tcb_handle)
 {
+    IO* io;
+    IO* cur;
+    unsigned int i, segments, count;
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
 #if (TCP_DEBUG_FLOW)
     printf("%s -> 0\n", __TCP_STATES[tcb->state]);
 #endif //TCP_DEBUG_FLOW
     timer_stop(tcb->timer, tcb_handle, HAL_TCP);
     timer_destroy(tcb->timer);
+    tcps_hash_remove(tcpips, tcb_handle);
     tcps_rx_flush(tcpips, tcb_handle);
-    if (tcb->tx)
-        io_complete_ex(tcb->process, HAL_IO_CMD(HAL_TCP, IPC_WRITE), tcb_handle, tcb->tx, ERROR_CONNECTION_CLOSED);
+    //frames, still owned by user, are returned after close
+    for (i = 0; i < TCPIP_MAX_FRAMES_COUNT; ++i)
+        if (tcpips->tcps.zc_io[i] != NULL && tcpips->tcps.zc_tcb[i] == tcb_handle)
+            tcpips->tcps.zc_tcb[i] = INVALID_HANDLE;
+    //not sent blocks are chained and returned at once, user IPC queue can't hold completion of every block.
+    //Next block starts at io->queue of previous, see tcp_unchain_write()
+    while ((io = tcb->tx) != NULL)
+    {
+        segments = tcps_segments(io);
+        for (cur = io; cur->queue != NULL && segments + (count = tcps_segments(cur->queue)) <= TCP_CLOSE_SEGMENTS; cur = cur->queue)
+        {
+            io_chain(cur, cur->queue);
+            segments += count;
+        }
+        tcb->tx = cur->queue;
+        cur->queue = NULL;
+        io_complete_ex(tcb->process, HAL_IO_CMD(HAL_TCP, IPC_WRITE), tcb_handle, io, ERROR_CONNECTION_CLOSED);
+    }
     so_free(&tcpips->tcps.tcbs, tcb_handle);
 }
 
@@ -487,6 +846,10 @@ static void tcps_apply_options(TCPIPS* tcpips, IO* io, TCP_TCB* tcb)
 {
     int i;
     TCP_OPT* opt;
+    bool syn;
+    TCP_HEADER* tcp = io_data(io);
+    //negotiated only on connection open
+    syn = (tcp->flags & TCP_FLAG_SYN) && (tcb->state == TCP_STATE_LISTEN || tcb->state == TCP_STATE_SYN_SENT);
     for (i = tcps_get_first_opt(io); i; i = tcps_get_next_opt(io, i))
     {
         opt = (TCP_OPT*)((uint8_t*)io_data(io) + i);
@@ -500,6 +863,28 @@ static void tcps_apply_options(TCPIPS* tcpips, IO* io, TCP_TCB* tcb)
             tcps_set_mss(tcpips, tcb, be2short(opt->data));
 #endif //ICMP
             break;
+        case TCP_OPTS_WSCALE:
+            if (syn)
+            {
+                tcb->snd_wscale = opt->data[0] > TCP_WSCALE_MAX ? TCP_WSCALE_MAX : opt->data[0];
+                tcb->rcv_wscale = TCP_WSCALE;
+                //largest possible window
+                tcb->ssthresh = TCP_SSTHRESH_MAX << tcb->snd_wscale;
+                tcb->wscale = true;
+                tcps_update_rx_wnd(tcpips, tcb);
+            }
+            break;
+        case TCP_OPTS_SACK_PERMITTED:
+            if (syn)
+                tcb->sack = true;
+            break;
+        case TCP_OPTS_TIMESTAMPS:
+            if (syn && TCP_TIMESTAMPS)
+            {
+                tcb->ts = true;
+                tcb->ts_recent = be2int(opt->data);
+            }
+            break;
         default:
             break;
         }
@@ -522,14 +907,30 @@ static IO* tcps_allocate_io(TCPIPS* tcpips, TCP_TCB* tcb)
     short2be(tcp->urgent_pointer_be, 0);
     short2be(tcp->checksum_be, 0);
     io->data_size = sizeof(TCP_HEADER);
+    if (tcb->ts)
+        tcps_append_ts(io, tcb->ts_recent);
     return io;
 }
 
 static void tcps_tx(TCPIPS* tcpips, IO* io, TCP_TCB* tcb)
 {
+    unsigned int wnd, shift;
     TCP_HEADER* tcp = io_data(io);
-    short2be(tcp->window_be, tcb->rx_wnd);
-    short2be(tcp->checksum_be, tcp_checksum(io_data(io), io->data_size, &tcpips->ips.ip, &tcb->remote_addr));
+    //any ACK covers delayed one
+    if (tcp->flags & TCP_FLAG_ACK)
+    {
+        tcb->rx_unacked = 0;
+        tcb->last_ack = be2int(tcp->ack_be);
+    }
+    //RFC 7323: window in SYN is never scaled
+    shift = (tcp->flags & TCP_FLAG_SYN) ? 0 : tcb->rcv_wscale;
+    wnd = tcb->rx_wnd >> shift;
+    if (wnd > 0xffff)
+        wnd = 0xffff;
+    short2be(tcp->window_be, wnd);
+    tcb->rcv_adv = tcb->rcv_nxt + (wnd << shift);
+    if (!ips_tx_checksum_offload(tcpips, io))
+        short2be(tcp->checksum_be, tcp_checksum(io_data(io), io->data_size, &tcpips->ips.ip, &tcb->remote_addr));
 #if (TCP_DEBUG_PACKETS)
     tcps_debug(io, &tcpips->ips.ip, &tcb->remote_addr);
 #endif //TCP_DEBUG_PACKETS
@@ -574,59 +975,145 @@ static void tcps_tx_ack(TCPIPS* tcpips, HANDLE tcb_handle)
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
 
     if ((tx = tcps_allocate_io(tcpips, tcb)) == NULL)
+    {
+        //no frame now, retry as delayed ACK
+        if (tcb->rx_unacked == 0)
+            tcb->rx_unacked = 1;
+        tcps_timer_start(tcb);
         return;
+    }
 
     tcp_tx = io_data(tx);
 
     tcp_tx->flags |= TCP_FLAG_ACK;
+    if (tcb->sack)
+        tcps_append_sack(tx, tcb);
     int2be(tcp_tx->seq_be, tcb->snd_nxt);
     int2be(tcp_tx->ack_be, tcb->rcv_nxt);
     tcps_tx(tcpips, tx, tcb);
+    ++tcpips->tcps.tx_acks;
     tcps_timer_start(tcb);
 }
 
-static void tcps_tx_text_ack_fin(TCPIPS* tcpips, HANDLE tcb_handle)
+//zero-copy window is reopened on give and release. Update now only if peer is blocked, else window goes with next ACK
+static void tcps_rx_zc_wnd(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    if (tcps_update_rx_wnd(tcpips, tcb) && tcps_diff(tcb->rcv_nxt, tcb->rcv_adv) < 2 * (int)TCP_MSS_MAX)
+        tcps_tx_ack(tcpips, tcb_handle);
+}
+
+//send next segment from SND.NXT, if allowed by window. Return false if nothing to send
+static bool tcps_tx_text_fin(TCPIPS* tcpips, HANDLE tcb_handle)
 {
     IO* io;
+    IO* tx;
     TCP_HEADER* tcp;
     TCP_STACK* tcp_stack;
-    unsigned int size;
+    unsigned int flight, wnd, mss, data_size, size, offset, chunk, tx_size;
+    bool fin;
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    //MSS doesn't include options
+    mss = tcb->ts ? tcb->mss - TCP_TS_SIZE : tcb->mss;
 
+    flight = tcps_delta(tcb->snd_una, tcb->snd_nxt);
+    wnd = tcb->tx_wnd < tcb->cwnd ? tcb->tx_wnd : tcb->cwnd;
+    //all sent, including FIN
+    if (tcb->snd_nxt == tcb->snd_end || flight >= wnd)
+        return false;
+    data_size = tcps_delta(tcb->snd_nxt, tcb->snd_end);
+    if ((fin = tcb->fin) == true)
+        --data_size;
+    size = data_size;
+    if (size > mss)
+        size = mss;
+    if (size > wnd - flight)
+        size = wnd - flight;
+    //FIN goes after last data byte
+    if (size < data_size || flight + size >= wnd)
+        fin = false;
+    if (size == 0 && !fin)
+        return false;
+    //RFC 1122 sender SWS avoidance: no runt segment, cut by window, while ACK is expected
+    if (size < (mss >> 1) && size < data_size && flight)
+        return false;
+    //don't starve rx and ACK of frames
+    if (tcpips->io_allocated + 1 >= TCPIP_MAX_FRAMES_COUNT)
+        return false;
     if ((io = tcps_allocate_io(tcpips, tcb)) == NULL)
-        return;
+        return false;
 
     tcp = io_data(io);
     tcp->flags |= TCP_FLAG_ACK;
-    int2be(tcp->seq_be, tcb->snd_una);
+    int2be(tcp->seq_be, tcb->snd_nxt);
     int2be(tcp->ack_be, tcb->rcv_nxt);
-    //if no transmit window, request window update, wait timeout, than try again
-    if (tcb->tx_wnd)
+    //find user block with SND.NXT. Block can be chain of segments
+    offset = tcb->tx_cur + flight;
+    for (tx = tcb->tx; tx != NULL && offset >= (tx_size = io_chain_size(tx)); tx = tx->queue)
+        offset -= tx_size;
+    if (size)
     {
-        if (tcb->tx != NULL)
+        tcp_stack = io_stack(tx);
+        if ((tcp_stack->flags & TCP_URG) && (tcp_stack->urg_len > offset))
         {
-            size = tcb->tx->data_size - tcb->tx_cur;
-            if (size > tcb->tx_wnd)
-                size = tcb->tx_wnd;
-            memcpy((uint8_t*)io_data(io) + io->data_size, (uint8_t*)io_data(tcb->tx) + tcb->tx_cur, size);
-            io->data_size += size;
-            //apply flags
-            tcp_stack = io_stack(tcb->tx);
-            if ((tcp_stack->flags & TCP_PSH) && (tcb->tx_cur + size >= tcb->tx->data_size))
-                tcp->flags |= TCP_FLAG_PSH;
-            if ((tcp_stack->flags & TCP_URG) && (tcp_stack->urg_len > tcb->tx_cur))
-            {
-                tcp->flags |= TCP_FLAG_URG;
-                short2be(tcp->urgent_pointer_be, tcp_stack->urg_len - tcb->tx_cur);
-            }
+            tcp->flags |= TCP_FLAG_URG;
+            short2be(tcp->urgent_pointer_be, tcp_stack->urg_len - offset);
         }
-        else
-            size = 0;
-        if (tcb->fin && (tcb->snd_una != tcb->snd_nxt) && (size < tcb->tx_wnd))
-            tcp->flags |= TCP_FLAG_FIN;
-        tcps_tx(tcpips, io, tcb);
     }
-    tcps_timer_start(tcb);
+    for (data_size = 0; data_size < size; tx = tx->queue, offset = 0)
+    {
+        tx_size = io_chain_size(tx);
+        chunk = tx_size - offset;
+        if (chunk > size - data_size)
+            chunk = size - data_size;
+        io_chain_read(tx, offset, (uint8_t*)io_data(io) + io->data_size, chunk);
+        io->data_size += chunk;
+        data_size += chunk;
+        //apply flags
+        tcp_stack = io_stack(tx);
+        if ((tcp_stack->flags & TCP_PSH) && (offset + chunk >= tx_size))
+            tcp->flags |= TCP_FLAG_PSH;
+    }
+    if (fin)
+        tcp->flags |= TCP_FLAG_FIN;
+    //time new data only (Karn). Timestamps are timing each segment
+    if (!tcb->ts && !tcb->rtt_active && tcb->snd_nxt == tcb->snd_max)
+    {
+        tcb->rtt_active = true;
+        tcb->rtt_seq = tcb->snd_nxt;
+        get_uptime(&tcb->rtt_time);
+    }
+    tcb->snd_nxt += size + (fin ? 1 : 0);
+    if (tcps_diff(tcb->snd_max, tcb->snd_nxt) > 0)
+        tcb->snd_max = tcb->snd_nxt;
+    tcps_tx(tcpips, io, tcb);
+    return true;
+}
+
+//resend first unacked segment. SND.NXT is not changed
+static void tcps_tx_retransmit(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    uint32_t snd_nxt;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    tcb->rtt_active = false;
+    snd_nxt = tcb->snd_nxt;
+    tcb->snd_nxt = tcb->snd_una;
+    tcps_tx_text_fin(tcpips, tcb_handle);
+    if (tcps_diff(tcb->snd_nxt, snd_nxt) > 0)
+        tcb->snd_nxt = snd_nxt;
+}
+
+static void tcps_tx_text_ack_fin(TCPIPS* tcpips, HANDLE tcb_handle, bool ack)
+{
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    //fill window. ACK is piggybacked on each segment
+    while (tcps_tx_text_fin(tcpips, tcb_handle))
+        ack = false;
+    //nothing sent. If no transmit window, wait window update or timeout, than try again
+    if (ack)
+        tcps_tx_ack(tcpips, tcb_handle);
+    else
+        tcps_timer_start(tcb);
 }
 
 static void tcps_tx_syn(TCPIPS* tcpips, HANDLE tcb_handle)
@@ -643,6 +1130,11 @@ static void tcps_tx_syn(TCPIPS* tcpips, HANDLE tcb_handle)
     //SYN flag
     tcp->flags |= TCP_FLAG_SYN;
     tcps_append_mss(io);
+    tcps_append_opt(io, TCP_OPTS_SACK_PERMITTED, NULL, 2);
+    tcps_append_wscale(io);
+#if (TCP_TIMESTAMPS)
+    tcps_append_ts(io, 0);
+#endif //TCP_TIMESTAMPS
 
     int2be(tcp->seq_be, tcb->snd_una);
     tcps_tx(tcpips, io, tcb);
@@ -663,6 +1155,10 @@ static void tcps_tx_syn_ack(TCPIPS* tcpips, HANDLE tcb_handle)
     //add ACK, SYN flags
     tcp->flags |= TCP_FLAG_ACK | TCP_FLAG_SYN;
     tcps_append_mss(io);
+    if (tcb->sack)
+        tcps_append_opt(io, TCP_OPTS_SACK_PERMITTED, NULL, 2);
+    if (tcb->wscale)
+        tcps_append_wscale(io);
 
     int2be(tcp->seq_be, tcb->snd_una);
     int2be(tcp->ack_be, tcb->rcv_nxt);
@@ -670,10 +1166,129 @@ static void tcps_tx_syn_ack(TCPIPS* tcpips, HANDLE tcb_handle)
     tcps_timer_start(tcb);
 }
 
+//remove leading bytes of received text
+static void tcps_rx_trim(IO* io, unsigned int size)
+{
+    uint16_t urg;
+    TCP_HEADER* tcp = io_data(io);
+    unsigned int data_off = tcps_data_offset(io);
+    memmove((uint8_t*)io_data(io) + data_off, (uint8_t*)io_data(io) + data_off + size, io->data_size - data_off - size);
+    io->data_size -= size;
+    int2be(tcp->seq_be, be2int(tcp->seq_be) + size);
+    if (tcp->flags & TCP_FLAG_URG)
+    {
+        urg = be2short(tcp->urgent_pointer_be);
+        if (urg > size)
+            short2be(tcp->urgent_pointer_be, urg - size);
+        else
+            tcp->flags &= ~TCP_FLAG_URG;
+    }
+}
+
+//remove trailing bytes of received text. FIN and PSH are going after last byte
+static void tcps_rx_chop(IO* io, unsigned int size)
+{
+    TCP_HEADER* tcp = io_data(io);
+    io->data_size -= size;
+    tcp->flags &= ~(TCP_FLAG_FIN | TCP_FLAG_PSH);
+}
+
+static inline int tcps_rx_ooo_offset(TCP_TCB* tcb, IO* io)
+{
+    return tcps_diff(tcb->rcv_nxt, be2int(((TCP_HEADER*)io_data(io))->seq_be));
+}
+
+//hold future in-window text until gap is filled
+static void tcps_rx_ooo_queue(TCPIPS* tcpips, IO* io, TCP_TCB* tcb, int seq_delta)
+{
+    IO* cur;
+    IO** prev;
+    unsigned int count;
+    int start, end, cur_start, cur_end;
+    TCP_HEADER* tcp = io_data(io);
+
+    switch (tcb->state)
+    {
+    case TCP_STATE_ESTABLISHED:
+    case TCP_STATE_FIN_WAIT_1:
+    case TCP_STATE_FIN_WAIT_2:
+        break;
+    default:
+        return;
+    }
+    if ((tcp->flags & (TCP_FLAG_SYN | TCP_FLAG_ACK)) != TCP_FLAG_ACK || tcps_data_len(io) == 0 || seq_delta >= tcb->rx_wnd)
+        return;
+    for (cur = tcb->ooo, count = 0; cur != NULL; cur = cur->queue)
+        ++count;
+    //don't starve rx and ACK of frames
+    if (count >= TCP_OOO_MAX || tcpips->io_allocated + 2 >= TCPIP_MAX_FRAMES_COUNT)
+        return;
+    start = seq_delta;
+    end = start + tcps_data_len(io);
+    if (end > tcb->rx_wnd)
+    {
+        tcps_rx_chop(io, end - tcb->rx_wnd);
+        end = tcb->rx_wnd;
+    }
+    //find place, remove text already held
+    for (prev = &tcb->ooo; (cur = *prev) != NULL; prev = &cur->queue)
+    {
+        cur_start = tcps_rx_ooo_offset(tcb, cur);
+        cur_end = cur_start + tcps_data_len(cur);
+        if (cur_start <= start && cur_end >= end)
+            return;
+        if (cur_start >= start)
+            break;
+        if (cur_end > start)
+        {
+            tcps_rx_trim(io, cur_end - start);
+            start = cur_end;
+        }
+    }
+    //new text covers next segments
+    while ((cur = *prev) != NULL && tcps_rx_ooo_offset(tcb, cur) + (int)tcps_data_len(cur) <= end)
+    {
+        *prev = cur->queue;
+        cur->queue = NULL;
+        ips_release_io(tcpips, cur);
+    }
+    if (cur != NULL && (cur_start = tcps_rx_ooo_offset(tcb, cur)) < end)
+        tcps_rx_chop(io, end - cur_start);
+#if (TCP_DEBUG_FLOW)
+    printf("TCP: hold out of order %d seq\n", tcps_data_len(io));
+#endif //TCP_DEBUG_FLOW
+    io->queue = cur;
+    *prev = io;
+    tcb->sack_seq = be2int(tcp->seq_be);
+}
+
+static inline bool tcps_rx_otw_paws(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
+{
+    uint32_t ts_val, ts_ecr;
+    TCP_HEADER* tcp;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    tcp = io_data(io);
+
+    if (!tcb->ts || !tcps_get_ts(io, &ts_val, &ts_ecr))
+        return true;
+    //RFC 7323 PAWS: timestamp is older than recent, segment is old duplicate
+    if (tcps_diff(tcb->ts_recent, ts_val) < 0 && (tcp->flags & TCP_FLAG_RST) == 0)
+    {
+#if (TCP_DEBUG_FLOW)
+        printf("TCP: PAWS\n");
+#endif //TCP_DEBUG_FLOW
+        tcps_tx_ack(tcpips, tcb_handle);
+        return false;
+    }
+    //echo timestamp of first segment, covered by next ACK
+    if (tcps_diff(be2int(tcp->seq_be), tcb->last_ack) >= 0)
+        tcb->ts_recent = ts_val;
+    return true;
+}
+
 static inline bool tcps_rx_otw_check_seq(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
 {
     int seq_delta, seg_len;
-    unsigned int data_off;
     uint32_t seq;
     TCP_HEADER* tcp;
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
@@ -705,21 +1320,11 @@ static inline bool tcps_rx_otw_check_seq(TCPIPS* tcpips, IO* io, HANDLE tcb_hand
             tcp->flags &= ~TCP_FLAG_SYN;
             --seg_len;
             ++seq_delta;
-            ++seq;
+            int2be(tcp->seq_be, ++seq);
         }
-        data_off = tcps_data_offset(io);
-        seg_len -= -seq_delta;
         //FIN is not in data, but occupying virtual byte
-        if (tcp->flags & TCP_FLAG_FIN)
-        {
-            memmove((uint8_t*)io_data(io) + data_off, (uint8_t*)io_data(io) + data_off + (-seq_delta), seg_len - 1);
-            io->data_size -= (-seq_delta) - 1;
-        }
-        else
-        {
-            memmove((uint8_t*)io_data(io) + data_off, (uint8_t*)io_data(io) + data_off + (-seq_delta), seg_len);
-            io->data_size -= -seq_delta;
-        }
+        seg_len += seq_delta;
+        tcps_rx_trim(io, -seq_delta);
         seq += -seq_delta;
         seq_delta = 0;
     }
@@ -738,7 +1343,7 @@ static inline bool tcps_rx_otw_check_seq(TCPIPS* tcpips, IO* io, HANDLE tcb_hand
         //still don't fit? remove some data
         if (seg_len > tcb->rx_wnd)
         {
-            io->data_size = seg_len - tcb->rx_wnd;
+            io->data_size -= seg_len - tcb->rx_wnd;
             seg_len = tcb->rx_wnd;
         }
         //remove PSH flag, cause it's goes after all bytes
@@ -749,12 +1354,17 @@ static inline bool tcps_rx_otw_check_seq(TCPIPS* tcpips, IO* io, HANDLE tcb_hand
 #if (TCP_DEBUG_FLOW)
         printf("TCP: Future sequence/don't fit\n");
 #endif //TCP_DEBUG_FLOW
+        //remember gap, filling it will be ACKed immediately
+        if (seq_delta > 0 && seq_delta < tcb->rx_wnd && (unsigned int)(seq_delta + seg_len) > tcb->rx_gap)
+            tcb->rx_gap = seq_delta + seg_len;
         //RST bit is set, drop the segment and return:
         if (tcp->flags & TCP_FLAG_RST)
         {
             tcps_timer_start(tcb);
             return false;
         }
+        if (seq_delta > 0)
+            tcps_rx_ooo_queue(tcpips, io, tcb, seq_delta);
 
         tcps_tx_ack(tcpips, tcb_handle);
         return false;
@@ -762,13 +1372,109 @@ static inline bool tcps_rx_otw_check_seq(TCPIPS* tcpips, IO* io, HANDLE tcb_hand
     return true;
 }
 
+static void tcps_cwnd_ack(TCP_TCB* tcb, unsigned int acked)
+{
+    //not limited by cwnd, don't grow
+    if (tcb->cwnd >= (unsigned int)tcb->tx_wnd << 1)
+        return;
+    //slow start
+    if (tcb->cwnd < tcb->ssthresh)
+        tcb->cwnd += acked < tcb->mss ? acked : tcb->mss;
+    //congestion avoidance
+    else
+        tcb->cwnd += tcb->mss * tcb->mss / tcb->cwnd + 1;
+}
+
+static void tcps_cwnd_loss(TCP_TCB* tcb)
+{
+    //ssthresh = max(FlightSize / 2, 2 * SMSS)
+    tcb->ssthresh = tcps_delta(tcb->snd_una, tcb->snd_max) >> 1;
+    if (tcb->ssthresh < 2 * tcb->mss)
+        tcb->ssthresh = 2 * tcb->mss;
+}
+
+static void tcps_rx_dup_ack(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    //segment left the network, inflate window
+    if (tcb->recovery)
+    {
+        tcb->cwnd += tcb->mss;
+        return;
+    }
+    if (++tcb->dupacks != TCP_DUPACK_THRESHOLD)
+        return;
+    //loss in already reduced window, don't reduce twice
+    if (tcps_diff(tcb->recover, tcb->snd_una) <= 0)
+        return;
+#if (TCP_DEBUG_FLOW)
+    printf("TCP: fast retransmit\n");
+#endif //TCP_DEBUG_FLOW
+    //fast retransmit, enter fast recovery
+    tcb->recover = tcb->snd_max - 1;
+    tcps_cwnd_loss(tcb);
+    tcb->cwnd = tcb->ssthresh + TCP_DUPACK_THRESHOLD * tcb->mss;
+    tcb->recovery = true;
+    tcps_tx_retransmit(tcpips, tcb_handle);
+}
+
+static void tcps_rx_new_ack(TCPIPS* tcpips, HANDLE tcb_handle, unsigned int acked)
+{
+    unsigned int flight;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    tcb->dupacks = 0;
+    if (!tcb->recovery)
+    {
+        tcps_cwnd_ack(tcb, acked);
+        return;
+    }
+    //full ACK, exit fast recovery
+    if (tcps_diff(tcb->recover, tcb->snd_una) > 0)
+    {
+        flight = tcps_delta(tcb->snd_una, tcb->snd_max);
+        tcb->cwnd = (flight > tcb->mss ? flight : tcb->mss) + tcb->mss;
+        if (tcb->cwnd > tcb->ssthresh)
+            tcb->cwnd = tcb->ssthresh;
+        tcb->recovery = false;
+        return;
+    }
+    //partial ACK, next segment is lost too. Deflate by acked, retransmit
+    tcb->cwnd = tcb->cwnd > acked ? tcb->cwnd - acked : 0;
+    if (acked >= tcb->mss)
+        tcb->cwnd += tcb->mss;
+    if (tcb->cwnd < tcb->mss)
+        tcb->cwnd = tcb->mss;
+    tcps_tx_retransmit(tcpips, tcb_handle);
+}
+
+//return fully acked blocks to user
+static void tcps_tx_acked(TCPIPS* tcpips, HANDLE tcb_handle, unsigned int acked)
+{
+    IO* io;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    while ((io = tcb->tx) != NULL && acked >= io_chain_size(io) - tcb->tx_cur)
+    {
+        acked -= io_chain_size(io) - tcb->tx_cur;
+        tcb->tx = io->queue;
+        tcb->tx_cur = 0;
+        io->queue = NULL;
+        io_pop(io, sizeof(TCP_STACK));
+        io_complete(tcb->process, HAL_IO_CMD(HAL_TCP, IPC_WRITE), tcb_handle, io);
+    }
+    //SYN/FIN are not in user data
+    if (tcb->tx != NULL)
+        tcb->tx_cur += acked;
+}
+
 static inline bool tcps_rx_otw_ack(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
 {
     int snd_diff, ack_diff;
+    unsigned int wnd;
+    uint32_t ts_val, ts_ecr;
     TCP_HEADER* tcp;
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
     tcp = io_data(io);
-    snd_diff = tcps_diff(tcb->snd_una, tcb->snd_nxt);
+    snd_diff = tcps_diff(tcb->snd_una, tcb->snd_max);
     ack_diff = tcps_diff(tcb->snd_una, be2int(tcp->ack_be));
 
     if (tcb->state == TCP_STATE_SYN_RECEIVED)
@@ -778,6 +1484,11 @@ static inline bool tcps_rx_otw_ack(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
         {
             tcps_set_state(tcb, TCP_STATE_ESTABLISHED);
             ipc_post_inline(tcb->process, HAL_CMD(HAL_TCP, IPC_OPEN), tcb_handle, tcb_handle, 0);
+            //SYN is acked
+            tcb->snd_una += ack_diff;
+            tcb->tx_wnd = tcps_get_tx_wnd(tcb, tcp);
+            snd_diff -= ack_diff;
+            ack_diff = 0;
             //and continue processing in that state if no data
             if (tcps_seg_len(io) == 0)
                 return false;
@@ -790,7 +1501,7 @@ static inline bool tcps_rx_otw_ack(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
             return false;
         }
     }
-    //SEG.ACK > SND.NXT
+    //SEG.ACK > SND.MAX
     if (ack_diff > snd_diff)
     {
 #if (TCP_DEBUG_FLOW)
@@ -800,31 +1511,40 @@ static inline bool tcps_rx_otw_ack(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
         return false;
     }
 
-    if ((ack_diff > 0) || ((ack_diff == 0) && (tcb->snd_nxt == tcb->snd_una)))
+    wnd = tcps_get_tx_wnd(tcb, tcp);
+    //RFC 1122 4.2.2.17: zero window probe is answered, connection is alive while window is closed
+    if ((ack_diff > 0) || ((ack_diff == 0) && (tcb->snd_end == tcb->snd_una || wnd == 0)))
         tcb->retry = 0;
+    //duplicate ACK: no data, no window update, something in flight
+    if ((ack_diff == 0) && (tcps_seg_len(io) == 0) && (wnd == tcb->tx_wnd) && (tcb->snd_max != tcb->snd_una))
+        tcps_rx_dup_ack(tcpips, tcb_handle);
     //adjust ack
     if (ack_diff > 0)
     {
         tcb->snd_una += ack_diff;
-        if (tcb->tx != NULL)
+        //retransmission after timeout is acked by previously sent
+        if (tcps_diff(tcb->snd_nxt, tcb->snd_una) > 0)
+            tcb->snd_nxt = tcb->snd_una;
+        //RFC 7323: echoed timestamp is RTT of any acked segment
+        if (tcb->ts && tcps_get_ts(io, &ts_val, &ts_ecr) && ts_ecr)
+            tcps_rtt_sample(tcb, tcps_ts_now() - ts_ecr);
+        //timed segment acked
+        else if (tcb->rtt_active && tcps_diff(tcb->rtt_seq, tcb->snd_una) > 0)
         {
-            if (ack_diff >= tcb->tx->data_size - tcb->tx_cur)
-            {
-                //return sent buffers to user
-                io_pop(tcb->tx, sizeof(TCP_STACK));
-                io_complete(tcb->process, HAL_IO_CMD(HAL_TCP, IPC_WRITE), tcb_handle, tcb->tx);
-                tcb->tx = NULL;
-                tcb->tx_cur = 0;
-            }
-            else
-                tcb->tx_cur += ack_diff;
+            tcb->rtt_active = false;
+            tcps_rtt_sample(tcb, systime_elapsed_ms(&tcb->rtt_time));
         }
+        tcps_tx_acked(tcpips, tcb_handle, ack_diff);
+        tcps_rx_new_ack(tcpips, tcb_handle, ack_diff);
     }
+    //old ACK can't update window
+    if (ack_diff >= 0)
+        tcb->tx_wnd = wnd;
 
     switch (tcb->state)
     {
     case TCP_STATE_FIN_WAIT_1:
-        if (tcb->snd_nxt == tcb->snd_una)
+        if (tcb->snd_end == tcb->snd_una)
         {
             tcps_set_state(tcb, TCP_STATE_FIN_WAIT_2);
             //In addition to the processing for the ESTABLISHED state, if the retransmission queue is empty, the user’s CLOSE can be acknowledged
@@ -833,7 +1553,7 @@ static inline bool tcps_rx_otw_ack(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
         break;
     case TCP_STATE_CLOSING:
     case TCP_STATE_LAST_ACK:
-        if (tcb->snd_nxt == tcb->snd_una)
+        if (tcb->snd_end == tcb->snd_una)
         {
             tcps_destroy_tcb(tcpips, tcb_handle);
             return false;
@@ -845,6 +1565,32 @@ static inline bool tcps_rx_otw_ack(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
     return true;
 }
 
+//zero-copy: frame is queued as is, urgent data is inline. Small segment is appended to last frame
+static void tcps_rx_zc_queue(IO* io, TCP_TCB* tcb)
+{
+    IO* tail;
+    TCP_HEADER* tcp = io_data(io);
+    unsigned int data_size = tcps_data_len(io);
+    if ((tail = tcb->rx_zc) != NULL)
+    {
+        while (tail->queue != NULL)
+            tail = tail->queue;
+        if (io_get_free(tail) >= data_size)
+        {
+            memcpy((uint8_t*)io_data(tail) + tail->data_size, (uint8_t*)io_data(io) + tcps_data_offset(io), data_size);
+            tail->data_size += data_size;
+            if (tcp->flags & TCP_FLAG_PSH)
+                ((TCP_HEADER*)io_data(tail))->flags |= TCP_FLAG_PSH;
+            return;
+        }
+        tail->queue = io;
+    }
+    else
+        tcb->rx_zc = io;
+    io->queue = NULL;
+    ++tcb->rx_zc_frames;
+}
+
 static void tcps_rx_text(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
 {
     TCP_STACK* tcp_stack;
@@ -860,7 +1606,7 @@ static void tcps_rx_text(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
     case TCP_STATE_ESTABLISHED:
     case TCP_STATE_FIN_WAIT_1:
     case TCP_STATE_FIN_WAIT_2:
-        tcb->rx_cur = data_size = tcps_data_len(io);
+        data_size = tcps_data_len(io);
         if (data_size)
         {
             data_offset = tcps_data_offset(io);
@@ -877,6 +1623,15 @@ static void tcps_rx_text(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
             }
             tcb->rcv_nxt += data_size;
             tcb->retry = 0;
+            //text ACK can be delayed, unless it fills gap
+            if (tcb->rx_gap)
+                tcb->rx_gap = tcb->rx_gap > data_size ? tcb->rx_gap - data_size : 0;
+            else
+            {
+                tcb->rx_cur -= data_size;
+                ++tcb->rx_unacked;
+            }
+            tcpips->tcps.rx_bytes += data_size;
             //has user block
             if (tcb->rx != NULL)
             {
@@ -913,9 +1668,22 @@ static void tcps_rx_text(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
             //no user block/no fit
             if (data_size)
             {
+                if (tcb->zc)
+                    tcps_rx_zc_queue(io, tcb);
                 //move to tmp
-                if (tcb->rx_tmp == NULL)
+                else if (tcb->rx_tmp == NULL)
+                {
+                    //remove data, already copied to user block
+                    if (data_offset > tcps_data_offset(io))
+                    {
+                        memmove((uint8_t*)io_data(io) + tcps_data_offset(io), (uint8_t*)io_data(io) + data_offset, data_size);
+                        io->data_size = tcps_data_offset(io) + data_size;
+                        short2be(tcp->urgent_pointer_be, urg);
+                        if (urg == 0)
+                            tcp->flags &= ~TCP_FLAG_URG;
+                    }
                     tcb->rx_tmp = io;
+                }
                 //append to tmp
                 else
                 {
@@ -944,7 +1712,7 @@ static void tcps_rx_text(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
                     tcb->rx_tmp->data_size += data_size;
                 }
             }
-            tcps_update_rx_wnd(tcb);
+            tcps_update_rx_wnd(tcpips, tcb);
         }
         break;
     default:
@@ -953,6 +1721,61 @@ static void tcps_rx_text(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
     }
 }
 
+//frame is queued in rx and can't be released
+static bool tcps_rx_held(TCP_TCB* tcb, IO* io)
+{
+    IO* cur;
+    if (tcb->rx_tmp == io)
+        return true;
+    for (cur = tcb->ooo; cur != NULL; cur = cur->queue)
+        if (cur == io)
+            return true;
+    for (cur = tcb->rx_zc; cur != NULL; cur = cur->queue)
+        if (cur == io)
+            return true;
+    return false;
+}
+
+//gap is filled, pass held text in order. Return true if FIN is reached
+static bool tcps_rx_ooo_drain(TCPIPS* tcpips, HANDLE tcb_handle)
+{
+    IO* io;
+    int start;
+    unsigned int data_len;
+    bool fin;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    while ((io = tcb->ooo) != NULL && (start = tcps_rx_ooo_offset(tcb, io)) <= 0)
+    {
+        tcb->ooo = io->queue;
+        io->queue = NULL;
+        data_len = tcps_data_len(io);
+        //already received
+        if ((unsigned int)(-start) >= data_len)
+        {
+            ips_release_io(tcpips, io);
+            continue;
+        }
+        if (start < 0)
+        {
+            tcps_rx_trim(io, -start);
+            data_len += start;
+        }
+        //window was shrinked after segment was held. Rest will be retransmitted
+        if (data_len > tcb->rx_wnd)
+        {
+            tcps_rx_chop(io, data_len - tcb->rx_wnd);
+            tcps_rx_ooo_flush(tcpips, tcb);
+        }
+        fin = (((TCP_HEADER*)io_data(io))->flags & TCP_FLAG_FIN) != 0;
+        tcps_rx_text(tcpips, io, tcb_handle);
+        if (!tcps_rx_held(tcb, io))
+            ips_release_io(tcpips, io);
+        if (fin)
+            return true;
+    }
+    return false;
+}
+
 static inline bool tcps_rx_otw_fin(TCPIPS* tcpips, HANDLE tcb_handle)
 {
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
@@ -962,7 +1785,7 @@ static inline bool tcps_rx_otw_fin(TCPIPS* tcpips, HANDLE tcb_handle)
     if (!tcb->fin)
     {
         tcb->fin = true;
-        ++tcb->snd_nxt;
+        ++tcb->snd_end;
     }
     switch (tcb->state)
     {
@@ -990,18 +1813,24 @@ static inline bool tcps_rx_otw_fin(TCPIPS* tcpips, HANDLE tcb_handle)
 
 static inline void tcps_rx_send(TCPIPS* tcpips, HANDLE tcb_handle)
 {
+    bool ack;
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
 
+    //SYN, FIN or not acceptable text are ACKed now, text every second segment or with window update
+    ack = (tcb->rx_cur != 0) || (tcb->rx_unacked >= 2) || (tcb->rx_unacked && tcps_rx_wnd_opened(tcb));
+#if (TCP_DELAYED_ACK == 0)
+    if (tcb->rx_unacked)
+        ack = true;
+#endif //TCP_DELAYED_ACK
     //ack from remote host - we transmitted all
-    if (tcb->state == TCP_STATE_ESTABLISHED && tcb->transmit && (tcb->snd_una == tcb->snd_nxt) && !tcb->fin && tcb->rx_cur == 0)
+    if (tcb->state == TCP_STATE_ESTABLISHED && tcb->transmit && (tcb->snd_una == tcb->snd_end) && !tcb->fin && !ack)
     {
         tcb->transmit = false;
-#if (TCP_KEEP_ALIVE)
         tcps_timer_start(tcb);
-#endif //TCP_KEEP_ALIVE
         return;
     }
-    tcps_tx_text_ack_fin(tcpips, tcb_handle);
+    //sequence space received, ACK it even if nothing to send. Piggybacked on text, if any
+    tcps_tx_text_ack_fin(tcpips, tcb_handle, ack);
 }
 
 static inline void tcps_rx_closed(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
@@ -1045,8 +1874,9 @@ static inline void tcps_rx_listen(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
         {
             tcps_set_state(tcb, TCP_STATE_SYN_RECEIVED);
             tcb->rcv_nxt = be2int(tcp->seq_be) + 1;
-            tcb->snd_una = tcb->snd_nxt = tcps_gen_isn();
-            ++tcb->snd_nxt;
+            tcb->tx_wnd = tcps_get_tx_wnd(tcb, tcp);
+            tcb->snd_una = tcb->recover = tcps_gen_isn();
+            tcb->snd_nxt = tcb->snd_max = tcb->snd_end = tcb->snd_una + 1;
 
             tcps_tx_syn_ack(tcpips, tcb_handle);
             return;
@@ -1099,7 +1929,9 @@ static inline void tcps_rx_syn_sent(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
     {
         if (ack_diff)
         {
-            ++tcb->rcv_nxt;
+            tcb->rcv_nxt = be2int(tcp->seq_be) + 1;
+            tcb->snd_una = ack;
+            tcb->tx_wnd = tcps_get_tx_wnd(tcb, tcp);
             tcps_set_state(tcb, TCP_STATE_ESTABLISHED);
             //inform user connected successfully
             ipc_post_inline(tcb->process, HAL_CMD(HAL_TCP, IPC_OPEN), tcb_handle, tcb_handle, 0);
@@ -1112,10 +1944,11 @@ static inline void tcps_rx_syn_sent(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
 
 static inline void tcps_rx_otw(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
 {
+    bool fin;
     TCP_HEADER* tcp = io_data(io);
 
     //first check sequence number
-    if (!tcps_rx_otw_check_seq(tcpips, io, tcb_handle))
+    if (!tcps_rx_otw_paws(tcpips, io, tcb_handle) || !tcps_rx_otw_check_seq(tcpips, io, tcb_handle))
         return;
 
     //second check the RST bit
@@ -1140,9 +1973,13 @@ static inline void tcps_rx_otw(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
     //sixth, check the URG bit
     //seventh, process the segment text
     tcps_rx_text(tcpips, io, tcb_handle);
+    fin = (tcp->flags & TCP_FLAG_FIN) != 0;
+    //gap is filled? continue with held text
+    if (!fin)
+        fin = tcps_rx_ooo_drain(tcpips, tcb_handle);
 
     //eighth, check the FIN bit
-    if (tcp->flags & TCP_FLAG_FIN)
+    if (fin)
     {
         if (!tcps_rx_otw_fin(tcpips, tcb_handle))
             return;
@@ -1174,12 +2011,21 @@ static inline void tcps_rx_process(TCPIPS* tcpips, IO* io, HANDLE tcb_handle)
 
 void tcps_init(TCPIPS* tcpips)
 {
+    int i;
     so_create(&tcpips->tcps.listen, sizeof(TCP_LISTEN_HANDLE), 1);
     so_create(&tcpips->tcps.tcbs, sizeof(TCP_TCB), 1);
+    for (i = 0; i < TCP_HASH_SIZE; ++i)
+        tcpips->tcps.tcb_hash[i] = tcpips->tcps.port_hash[i] = tcpips->tcps.listen_hash[i] = INVALID_HANDLE;
+    tcpips->tcps.dynamic = TCPIP_DYNAMIC_RANGE_LO;
+    tcpips->tcps.rx_bytes = tcpips->tcps.tx_acks = 0;
+    tcpips->tcps.rx_io = NULL;
+    for (i = 0; i < TCPIP_MAX_FRAMES_COUNT; ++i)
+        tcpips->tcps.zc_io[i] = NULL;
 }
 
 void tcps_link_changed(TCPIPS* tcpips, bool link)
 {
+    int i;
     HANDLE handle;
     //nothing to do if link, close all connections if not
     if (!link)
@@ -1188,6 +2034,8 @@ void tcps_link_changed(TCPIPS* tcpips, bool link)
             tcps_close_connection(tcpips, handle, ERROR_CONNECTION_CLOSED);
         while((handle = so_first(&tcpips->tcps.listen)) != INVALID_HANDLE)
             so_free(&tcpips->tcps.listen, handle);
+        for (i = 0; i < TCP_HASH_SIZE; ++i)
+            tcpips->tcps.listen_hash[i] = INVALID_HANDLE;
     }
 }
 
@@ -1197,7 +2045,7 @@ void tcps_rx(TCPIPS* tcpips, IO* io, IP* src)
     TCP_TCB* tcb;
     HANDLE tcb_handle, process;
     uint16_t src_port, dst_port;
-    if (io->data_size < sizeof(TCP_HEADER) || tcp_checksum(io_data(io), io->data_size, src, &tcpips->ips.ip))
+    if (io->data_size < sizeof(TCP_HEADER) || (!tcpips->rx_checksum_ok && tcp_checksum(io_data(io), io->data_size, src, &tcpips->ips.ip)))
     {
         ips_release_io(tcpips, io);
         return;
@@ -1228,12 +2076,21 @@ void tcps_rx(TCPIPS* tcpips, IO* io, IP* src)
         tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
         timer_stop(tcb->timer, tcb_handle, HAL_TCP);
         tcps_apply_options(tcpips, io, tcb);
-        tcb->tx_wnd = be2short(tcp->window_be);
-        tcb->rx_cur = 0;
+        tcb->rx_cur = tcps_seg_len(io);
+        tcpips->tcps.rx_io = io;
         tcps_rx_process(tcpips, io, tcb_handle);
+        //already released or given to user on flush
+        if (tcpips->tcps.rx_io == NULL)
+            return;
+        tcpips->tcps.rx_io = NULL;
         //make sure not queued in rx
-        if (tcb->rx_tmp == io)
+        if (tcps_rx_held(tcb, io))
+        {
+            //zero-copy frame is given only after check: it's not owned anymore
+            tcps_rx_zc_give(tcpips, tcb_handle);
+            tcps_rx_zc_wnd(tcpips, tcb_handle);
             return;
+        }
     }
     ips_release_io(tcpips, io);
 }
@@ -1253,11 +2110,21 @@ static inline void tcps_listen(TCPIPS* tcpips, IPC* ipc)
     tlh = so_get(&tcpips->tcps.listen, handle);
     tlh->port = (uint16_t)ipc->param1;
     tlh->process = ipc->process;
+    tlh->next = tcpips->tcps.listen_hash[TCP_PORT_HASH(tlh->port)];
+    tcpips->tcps.listen_hash[TCP_PORT_HASH(tlh->port)] = handle;
     ipc->param2 = handle;
 }
 
 static inline void tcps_close_listen(TCPIPS* tcpips, HANDLE handle)
 {
+    HANDLE* cur;
+    TCP_LISTEN_HANDLE* tlh;
+    if (!so_check_handle(&tcpips->tcps.listen, handle))
+        return;
+    tlh = so_get(&tcpips->tcps.listen, handle);
+    for (cur = &tcpips->tcps.listen_hash[TCP_PORT_HASH(tlh->port)]; *cur != handle;
+         cur = &((TCP_LISTEN_HANDLE*)so_get(&tcpips->tcps.listen, *cur))->next) {}
+    *cur = tlh->next;
     so_free(&tcpips->tcps.listen, handle);
 }
 
@@ -1312,8 +2179,8 @@ static inline void tcps_open(TCPIPS* tcpips, HANDLE tcb_handle)
         return;
     }
     tcps_set_state(tcb, TCP_STATE_SYN_SENT);
-    tcb->snd_una = tcb->snd_nxt = tcps_gen_isn();
-    ++tcb->snd_nxt;
+    tcb->snd_una = tcb->recover = tcps_gen_isn();
+    tcb->snd_nxt = tcb->snd_max = tcb->snd_end = tcb->snd_una + 1;
     tcps_tx_syn(tcpips, tcb_handle);
     error(ERROR_SYNC);
 }
@@ -1328,9 +2195,9 @@ static inline void tcps_close(TCPIPS* tcpips, HANDLE tcb_handle)
     case TCP_STATE_ESTABLISHED:
         tcps_set_state(tcb, TCP_STATE_FIN_WAIT_1);
         tcb->fin = true;
-        ++tcb->snd_nxt;
+        ++tcb->snd_end;
         tcps_rx_flush(tcpips, tcb_handle);
-        tcps_tx_text_ack_fin(tcpips, tcb_handle);
+        tcps_tx_text_ack_fin(tcpips, tcb_handle, false);
         error(ERROR_SYNC);
         break;
     case TCP_STATE_LAST_ACK:
@@ -1357,6 +2224,12 @@ static inline void tcps_read(TCPIPS* tcpips, HANDLE tcb_handle, IO* io)
         error(ERROR_IN_PROGRESS);
         return;
     }
+    //connection is in zero-copy mode
+    if (tcb->zc)
+    {
+        error(ERROR_INVALID_MODE);
+        return;
+    }
     io_reset(io);
     switch (tcb->state)
     {
@@ -1417,14 +2290,14 @@ static inline void tcps_read(TCPIPS* tcpips, HANDLE tcb_handle, IO* io)
             if ((io_get_free(io) == 0) || (tcp_stack->flags & TCP_PSH))
             {
                 io_complete(tcb->process, HAL_IO_CMD(HAL_TCP, IPC_READ), tcb_handle, io);
-                if (tcps_update_rx_wnd(tcb))
+                if (tcps_update_rx_wnd(tcpips, tcb))
                     tcps_tx_ack(tcpips, tcb_handle);
                 error(ERROR_SYNC);
                 return;
             }
         }
         tcb->rx = io;
-        if (tcps_update_rx_wnd(tcb))
+        if (tcps_update_rx_wnd(tcpips, tcb))
             tcps_tx_ack(tcpips, tcb_handle);
         error(ERROR_SYNC);
         break;
@@ -1433,27 +2306,93 @@ static inline void tcps_read(TCPIPS* tcpips, HANDLE tcb_handle, IO* io)
     }
 }
 
-static inline void tcps_write(TCPIPS* tcpips, HANDLE tcb_handle, IO* io)
+static inline void tcps_read_frame(TCPIPS* tcpips, HANDLE tcb_handle)
 {
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
     if (tcb == NULL)
         return;
-    if (tcb->state != TCP_STATE_ESTABLISHED)
+    if (tcb->rx != NULL || tcb->zc_read)
     {
+        error(ERROR_IN_PROGRESS);
+        return;
+    }
+    switch (tcb->state)
+    {
+    case TCP_STATE_ESTABLISHED:
+    case TCP_STATE_FIN_WAIT_1:
+    case TCP_STATE_FIN_WAIT_2:
+        if (!tcb->zc)
+        {
+            tcb->zc = true;
+            //text, received before, goes first
+            if (tcb->rx_tmp != NULL)
+            {
+                tcps_rx_zc_queue(tcb->rx_tmp, tcb);
+                tcb->rx_tmp = NULL;
+            }
+            if (tcps_update_rx_wnd(tcpips, tcb))
+                tcps_tx_ack(tcpips, tcb_handle);
+        }
+        tcb->zc_read = true;
+        tcps_rx_zc_give(tcpips, tcb_handle);
+        tcps_rx_zc_wnd(tcpips, tcb_handle);
+        error(ERROR_SYNC);
+        break;
+    default:
         error(ERROR_INVALID_STATE);
+    }
+}
+
+static inline void tcps_release_frame(TCPIPS* tcpips, HANDLE tcb_handle, IO* io)
+{
+    TCP_TCB* tcb;
+    unsigned int i;
+    //only frame, given by stack, is accepted
+    for (i = 0; i < TCPIP_MAX_FRAMES_COUNT; ++i)
+        if (io != NULL && tcpips->tcps.zc_io[i] == io)
+            break;
+    if (i >= TCPIP_MAX_FRAMES_COUNT)
+    {
+        error(ERROR_INVALID_PARAMS);
         return;
     }
-    if (tcb->tx != NULL)
+    tcpips->tcps.zc_io[i] = NULL;
+    //owned by stack again, even if connection is already closed
+    ips_release_io(tcpips, io);
+    if ((tcb_handle = tcpips->tcps.zc_tcb[i]) == INVALID_HANDLE)
+        return;
+    tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    --tcb->rx_zc_held;
+    //user was blocked by limit of owned frames
+    tcps_rx_zc_give(tcpips, tcb_handle);
+    tcps_rx_zc_wnd(tcpips, tcb_handle);
+}
+
+static inline void tcps_write(TCPIPS* tcpips, HANDLE tcb_handle, IO* io)
+{
+    IO* tx;
+    TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
+    if (tcb == NULL)
+        return;
+    if (tcb->state != TCP_STATE_ESTABLISHED)
     {
-        error(ERROR_IN_PROGRESS);
+        error(ERROR_INVALID_STATE);
         return;
     }
     timer_stop(tcb->timer, tcb_handle, HAL_TCP);
 
-    tcb->tx = io;
-    tcb->snd_nxt += io->data_size;
+    //append to queue
+    io->queue = NULL;
+    if (tcb->tx == NULL)
+        tcb->tx = io;
+    else
+    {
+        for (tx = tcb->tx; tx->queue != NULL; tx = tx->queue) {}
+        tx->queue = io;
+    }
+    tcb->snd_end += io_chain_size(io);
     tcb->transmit = true;
-    tcps_tx_text_ack_fin(tcpips, tcb_handle);
+    tcps_tx_text_ack_fin(tcpips, tcb_handle, false);
     error(ERROR_SYNC);
 }
 
@@ -1470,6 +2409,12 @@ static inline void tcps_timeout(TCPIPS* tcpips, HANDLE tcb_handle)
     TCP_TCB* tcb = so_get(&tcpips->tcps.tcbs, tcb_handle);
     if (tcb == NULL)
         return;
+    //delayed ACK, not error condition
+    if (tcb->rx_unacked)
+    {
+        tcps_tx_text_ack_fin(tcpips, tcb_handle, true);
+        return;
+    }
 #if (TCP_KEEP_ALIVE)
     //keep-alive, not error condition
     if ((tcb->state == TCP_STATE_ESTABLISHED) && (tcb->transmit == false))
@@ -1480,7 +2425,7 @@ static inline void tcps_timeout(TCPIPS* tcpips, HANDLE tcb_handle)
         printf(":%u\n", tcb->remote_port);
 #endif //TCP_DEBUG_FLOW
         tcb->transmit = true;
-        tcps_tx_text_ack_fin(tcpips, tcb_handle);
+        tcps_tx_text_ack_fin(tcpips, tcb_handle, true);
         return;
     }
 #endif //TCP_KEEP_ALIVE
@@ -1490,7 +2435,14 @@ static inline void tcps_timeout(TCPIPS* tcpips, HANDLE tcb_handle)
     ip_print(&tcb->remote_addr);
     printf(":%u retry\n", tcb->remote_port);
 #endif //TCP_DEBUG_FLOW
-    if (++tcb->retry > TCP_RETRY_COUNT)
+    //exponential backoff up to TCP_TIMEOUT, then count retries
+    if (tcb->rto < TCP_TIMEOUT)
+    {
+        tcb->rto <<= 1;
+        if (tcb->rto > TCP_TIMEOUT)
+            tcb->rto = TCP_TIMEOUT;
+    }
+    else if (++tcb->retry > TCP_RETRY_COUNT)
     {
 #if (TCP_DEBUG_FLOW)
         printf("TCP: Retry exceed, closing connection\n");
@@ -1504,8 +2456,28 @@ static inline void tcps_timeout(TCPIPS* tcpips, HANDLE tcb_handle)
     case TCP_STATE_SYN_SENT:
         tcps_tx_syn(tcpips, tcb_handle);
         break;
+    case TCP_STATE_SYN_RECEIVED:
+        tcps_tx_syn_ack(tcpips, tcb_handle);
+        break;
     default:
-        tcps_tx_text_ack_fin(tcpips, tcb_handle);
+        //collapse window, retransmit from first unacked
+        tcps_cwnd_loss(tcb);
+        tcb->cwnd = tcb->mss;
+        tcb->recover = tcb->snd_max - 1;
+        tcb->recovery = false;
+        tcb->dupacks = 0;
+        tcb->rtt_active = false;
+        tcb->snd_nxt = tcb->snd_una;
+        //RFC 9293 3.8.6.1 zero window probe: one byte beyond window, receiver answers with its window.
+        //Otherwise lost window update is never repeated
+        if (tcb->tx_wnd == 0 && tcb->snd_una != tcb->snd_end)
+        {
+            tcb->tx_wnd = 1;
+            tcps_tx_text_ack_fin(tcpips, tcb_handle, true);
+            tcb->tx_wnd = 0;
+            break;
+        }
+        tcps_tx_text_ack_fin(tcpips, tcb_handle, true);
         break;
     }
 }
@@ -1513,6 +2485,12 @@ static inline void tcps_timeout(TCPIPS* tcpips, HANDLE tcb_handle)
 void tcps_request(TCPIPS* tcpips, IPC* ipc)
 {
     IP ip;
+    //frame is returned even after link down
+    if (HAL_ITEM(ipc->cmd) == TCP_RELEASE_FRAME)
+    {
+        tcps_release_frame(tcpips, (HANDLE)ipc->param1, (IO*)ipc->param2);
+        return;
+    }
     if (!tcpips->connected)
     {
         error(ERROR_NOT_ACTIVE);
@@ -1540,6 +2518,10 @@ void tcps_request(TCPIPS* tcpips, IPC* ipc)
     case TCP_GET_LOCAL_PORT:
         ipc->param2 = tcps_get_local_port(tcpips, (HANDLE)ipc->param1);
         break;
+    case TCP_GET_STAT:
+        ipc->param2 = tcpips->tcps.rx_bytes;
+        ipc->param3 = tcpips->tcps.tx_acks;
+        break;
     case IPC_OPEN:
         tcps_open(tcpips, (HANDLE)ipc->param1);
         break;
@@ -1549,6 +2531,9 @@ void tcps_request(TCPIPS* tcpips, IPC* ipc)
     case IPC_READ:
         tcps_read(tcpips, (HANDLE)ipc->param1, (IO*)ipc->param2);
         break;
+    case TCP_READ_FRAME:
+        tcps_read_frame(tcpips, (HANDLE)ipc->param1);
+        break;
     case IPC_WRITE:
         tcps_write(tcpips, (HANDLE)ipc->param1, (IO*)ipc->param2);
         break;
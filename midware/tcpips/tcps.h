@@ -12,6 +12,7 @@
 #include "../../userspace/so.h"
 #include "tcpips.h"
 #include "icmps.h"
+#include "sys_config.h"
 
 #define TCP_FLAG_FIN                                (1 << 0)
 #define TCP_FLAG_SYN                                (1 << 1)
@@ -25,10 +26,28 @@
 #define TCP_OPTS_END                                0
 #define TCP_OPTS_NOOP                               1
 #define TCP_OPTS_MSS                                2
+#define TCP_OPTS_WSCALE                             3
+#define TCP_OPTS_SACK_PERMITTED                     4
+#define TCP_OPTS_SACK                               5
+#define TCP_OPTS_TIMESTAMPS                         8
+
+//buckets in TCB and listener indexes, power of 2. Usually set in sys_config
+#ifndef TCP_HASH_SIZE
+#define TCP_HASH_SIZE                               16
+#endif //TCP_HASH_SIZE
 
 typedef struct {
     SO listen, tcbs;
+    //TCB chains by 4-tuple and by local port, listener chains by port
+    HANDLE tcb_hash[TCP_HASH_SIZE], port_hash[TCP_HASH_SIZE], listen_hash[TCP_HASH_SIZE];
     uint16_t dynamic;
+    //segment in processing. Cleared, if released or given to user before processing is complete
+    IO* rx_io;
+    //zero-copy frames, owned by user, and their connections. INVALID_HANDLE, if connection is closed
+    IO* zc_io[TCPIP_MAX_FRAMES_COUNT];
+    HANDLE zc_tcb[TCPIP_MAX_FRAMES_COUNT];
+    //received text bytes, pure ACK frames sent
+    unsigned int rx_bytes, tx_acks;
 } TCPS;
 
 
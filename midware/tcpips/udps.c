@@ -165,7 +165,8 @@ static void udps_replay(TCPIPS* tcpips, IO* io, const IP* src)
 
     short2be(udp->len_be, io->data_size);
     short2be(udp->checksum_be, 0);
-    short2be(udp->checksum_be, udp_checksum(io_data(io), io->data_size, &tcpips->ips.ip, &dst));
+    if (!ips_tx_checksum_offload(tcpips, io))
+        short2be(udp->checksum_be, udp_checksum(io_data(io), io->data_size, &tcpips->ips.ip, &dst));
     ips_tx(tcpips, io, &dst);
 }
 
@@ -178,9 +179,9 @@ void udps_rx(TCPIPS* tcpips, IO* io, IP* src)
 #if(UDP_BROADCAST)
     const IP* dst;
     dst = (const IP*)io_data(io) - 1;
-    if (io->data_size < sizeof(UDP_HEADER) || udp_checksum(io_data(io), io->data_size, src, dst))
+    if (io->data_size < sizeof(UDP_HEADER) || (!tcpips->rx_checksum_ok && udp_checksum(io_data(io), io->data_size, src, dst)))
 #else
-    if (io->data_size < sizeof(UDP_HEADER) || udp_checksum(io_data(io), io->data_size, src, &tcpips->ips.ip))
+    if (io->data_size < sizeof(UDP_HEADER) || (!tcpips->rx_checksum_ok && udp_checksum(io_data(io), io->data_size, src, &tcpips->ips.ip)))
 #endif
     {
         ips_release_io(tcpips, io);
@@ -336,7 +337,7 @@ static inline void udps_read(TCPIPS* tcpips, HANDLE handle, IO* io)
 static inline void udps_write(TCPIPS* tcpips, HANDLE handle, IO* io)
 {
     IO* cur;
-    unsigned int offset, size;
+    unsigned int offset, size, data_size;
     unsigned short remote_port;
     IP dst;
     UDP_STACK* udp_stack;
@@ -370,16 +371,18 @@ static inline void udps_write(TCPIPS* tcpips, HANDLE handle, IO* io)
         dst.u32.ip = uh->remote_addr.u32.ip;
     }
 
-    for (offset = 0; offset < io->data_size; offset += size)
+    //user block can be chain of segments
+    data_size = io_chain_size(io);
+    for (offset = 0; offset < data_size; offset += size)
     {
         size = UDP_FRAME_MAX_DATA_SIZE;
-        if (size > io->data_size - offset)
-            size = io->data_size - offset;
+        if (size > data_size - offset)
+            size = data_size - offset;
         cur = ips_allocate_io(tcpips, size + sizeof(UDP_HEADER), PROTO_UDP);
         if (cur == NULL)
             return;
         //copy data
-        memcpy((uint8_t*)io_data(cur) + sizeof(UDP_HEADER), (uint8_t*)io_data(io) + offset, size);
+        io_chain_read(io, offset, (uint8_t*)io_data(cur) + sizeof(UDP_HEADER), size);
         udp = io_data(cur);
 // correct size
         cur->data_size = size + sizeof(UDP_HEADER);
@@ -388,7 +391,8 @@ static inline void udps_write(TCPIPS* tcpips, HANDLE handle, IO* io)
         short2be(udp->dst_port_be, remote_port);
         short2be(udp->len_be, size + sizeof(UDP_HEADER));
         short2be(udp->checksum_be, 0);
-        short2be(udp->checksum_be, udp_checksum(io_data(cur), cur->data_size, &tcpips->ips.ip, &dst));
+        if (!ips_tx_checksum_offload(tcpips, cur))
+            short2be(udp->checksum_be, udp_checksum(io_data(cur), cur->data_size, &tcpips->ips.ip, &dst));
         ips_tx(tcpips, cur, &dst);
     }
 }
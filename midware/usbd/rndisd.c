@@ -1096,27 +1096,38 @@ static inline void rndisd_eth_close(USBD* usbd, RNDISD* rndisd, HANDLE tcpip)
 
 static inline void rndisd_eth_read(USBD* usbd, RNDISD* rndisd, IO* io, unsigned int size)
 {
+    IO* next;
     if (!rndisd_link_ready(rndisd))
     {
         error(ERROR_NOT_ACTIVE);
         return;
     }
-    if (rndisd->rx_cur == NULL)
+    //chain of IOs can be posted at once
+    for (; io != NULL; io = next)
     {
-        rndisd->rx_cur = io;
-        usbd_usb_ep_read(usbd, rndisd->data_ep, rndisd->rx_cur, size);
-        error(ERROR_SYNC);
-    }
+        next = io->next;
+        if (rndisd->rx_cur == NULL)
+        {
+            io->next = NULL;
+            rndisd->rx_cur = io;
+            usbd_usb_ep_read(usbd, rndisd->data_ep, rndisd->rx_cur, size);
+        }
 #if (ETH_DOUBLE_BUFFERING)
-    else if (rndisd->rx == NULL)
-    {
-        rndisd->rx = io;
-        rndisd->rx_size = size;
-        error(ERROR_SYNC);
-    }
+        else if (rndisd->rx == NULL)
+        {
+            io->next = NULL;
+            rndisd->rx = io;
+            rndisd->rx_size = size;
+        }
 #endif //ETH_DOUBLE_BUFFERING
-    else
-        error(ERROR_IN_PROGRESS);
+        else
+        {
+            //rest of chain is returned
+            io_complete_ex(rndisd->tcpip, HAL_IO_CMD(HAL_ETH, IPC_READ), USBD_IFACE(rndisd->control_iface, 0), io, ERROR_IN_PROGRESS);
+            break;
+        }
+    }
+    error(ERROR_SYNC);
 }
 
 static inline void rndisd_eth_write(USBD* usbd, RNDISD* rndisd, IO* io)
@@ -1157,6 +1168,13 @@ static inline void rndisd_eth_event(USBD* usbd, RNDISD* rndisd, IPC* ipc)
         ipc->param2 = rndisd_eth_get_header_size();
         ipc->param3 = ERROR_OK;
         break;
+    case ETH_GET_RING_SIZE:
+#if (ETH_DOUBLE_BUFFERING)
+        ipc->param2 = ipc->param3 = 2;
+#else
+        ipc->param2 = ipc->param3 = 1;
+#endif //ETH_DOUBLE_BUFFERING
+        break;
     case IPC_OPEN:
         rndisd_eth_open(usbd, rndisd, ipc->process);
         break;
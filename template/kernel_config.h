@@ -27,7 +27,7 @@
 #define KERNEL_DEVELOPER_MODE                       1
 //enable this only if you have problems with system timer. May decrease perfomance
 #define KERNEL_TIMER_DEBUG                          0
-//size of IPC queue per process
+//default size of IPC queue per process. Can be overrided in REX
 #define KERNEL_IPC_COUNT                            7
 //enable this only if you have problems with IPC oferflow.
 #define KERNEL_IPC_DEBUG                            1
@@ -37,5 +37,11 @@
 #define KERNEL_IO_DEBUG                             1
 //maximum number of global handles. Must be at least 1
 #define KERNEL_OBJECTS_COUNT                        5
+//preallocated IOs, shared by drivers and stacks. 0 - IO is always allocated from heap
+#define KERNEL_IO_POOL_COUNT                        0
+//size of preallocated IO with header. Ethernet frame with TCPIP_MTU 1500 requires ~1560
+#define KERNEL_IO_POOL_SIZE                         1568
+//maximum segments in IO chain. Longer or looped chain is rejected
+#define KERNEL_IO_MAX_SEGMENTS                      64
 
 #endif // KERNEL_CONFIG_H
@@ -40,6 +40,7 @@ HANDLE canopen_create(uint32_t process_size, uint32_t priority)
     rex.priority = priority;
     rex.flags = PROCESS_FLAGS_ACTIVE;
     rex.fn = canopens_main;
+    rex.ipc_size = 0;
     return process_create(&rex);
 }
 void canopen_send_pdo(HANDLE co, uint8_t pdo_num, uint8_t pdo_len, uint32_t hi, uint32_t lo)
@@ -34,4 +34,21 @@
 #include "arm7/core_arm7.h"
 #endif
 
+//host (linux) simulation. Requires x86-64, non-PIE executable. SRAM is mapped below 4GB, so all handles fit in 32 bit
+#ifdef POSIX
+#ifndef SRAM_BASE
+#define SRAM_BASE                0x20000000
+#endif
+#ifndef SRAM_SIZE
+#define SRAM_SIZE                0x100000
+#endif
+#ifndef IRQ_VECTORS_COUNT
+#define IRQ_VECTORS_COUNT        32
+#endif
+//GLOBAL with 64 bit pointers
+#ifndef KERNEL_GLOBAL_SIZE
+#define KERNEL_GLOBAL_SIZE       24
+#endif
+#endif //POSIX
+
 #endif // CORE_H
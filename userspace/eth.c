@@ -27,3 +27,26 @@ unsigned int eth_get_header_size(HANDLE eth, unsigned int eth_handle)
     int res = get(eth, HAL_REQ(HAL_ETH, ETH_GET_HEADER_SIZE), eth_handle, 0, 0);
     return (res < 0) ? 0 : res;
 }
+
+unsigned int eth_get_features(HANDLE eth, unsigned int eth_handle)
+{
+    int res = get(eth, HAL_REQ(HAL_ETH, ETH_GET_FEATURES), eth_handle, 0, 0);
+    return (res < 0) ? 0 : res;
+}
+
+void eth_get_ring_size(HANDLE eth, unsigned int eth_handle, unsigned int* rx, unsigned int* tx)
+{
+    IPC ipc;
+    ipc.cmd = HAL_REQ(HAL_ETH, ETH_GET_RING_SIZE);
+    ipc.process = eth;
+    ipc.param1 = eth_handle;
+    call(&ipc);
+    //driver without ring accepts single frame in each direction
+    if ((int)ipc.param3 <= 0)
+    {
+        *rx = *tx = 1;
+        return;
+    }
+    *rx = ipc.param2;
+    *tx = ipc.param3;
+}
@@ -10,6 +10,34 @@
 #include <stdint.h>
 #include "ipc.h"
 #include "mac.h"
+#include "sys_config.h"
+
+//DMA descriptors per direction. Stack keeps same number of rx frames posted and tx frames in flight
+#ifndef ETH_RX_RING_SIZE
+#if (ETH_DOUBLE_BUFFERING)
+#define ETH_RX_RING_SIZE                        2
+#else
+#define ETH_RX_RING_SIZE                        1
+#endif //ETH_DOUBLE_BUFFERING
+#endif //ETH_RX_RING_SIZE
+
+#ifndef ETH_TX_RING_SIZE
+#if (ETH_DOUBLE_BUFFERING)
+#define ETH_TX_RING_SIZE                        2
+#else
+#define ETH_TX_RING_SIZE                        1
+#endif //ETH_DOUBLE_BUFFERING
+#endif //ETH_TX_RING_SIZE
+
+//rx interrupt is masked after first frame, driver hands frames in batches to stack, polling until ring is drained
+#ifndef ETH_RX_POLLING
+#define ETH_RX_POLLING                          0
+#endif //ETH_RX_POLLING
+
+//poll, returned less frames, switches driver back to interrupt mode
+#ifndef ETH_RX_POLL_THRESHOLD
+#define ETH_RX_POLL_THRESHOLD                   1
+#endif //ETH_RX_POLL_THRESHOLD
 
 typedef enum {
     ETH_10_HALF = 0,
@@ -27,11 +55,33 @@ typedef enum {
     ETH_SET_MAC = IPC_USER,
     ETH_GET_MAC,
     ETH_NOTIFY_LINK_CHANGED,
-    ETH_GET_HEADER_SIZE
+    ETH_GET_HEADER_SIZE,
+    ETH_GET_FEATURES,
+    //stack: poll rx ring with budget. Driver: completed frames, linked by next
+    ETH_POLL,
+    //reads and writes, accepted by driver at once
+    ETH_GET_RING_SIZE
 }ETH_IPCS;
 
+//MAC inserts IP header and TCP/UDP/ICMP checksums on tx. Checksum fields are left zero
+#define ETH_FEATURE_TX_CHECKSUM                 (1 << 0)
+//MAC verifies checksums on rx
+#define ETH_FEATURE_RX_CHECKSUM                 (1 << 1)
+
+//rx complete param3 flag: IP header and TCP/UDP/ICMP checksums verified by MAC
+#define ETH_RX_CHECKSUM_OK                      (1 << 30)
+//ETH_POLL complete param3 flag: rx interrupt is masked, stack must poll again
+#define ETH_RX_POLL                             (1 << 29)
+
+//ETH_POLL complete: with ETH_FEATURE_RX_CHECKSUM every frame of chain has own ETH_RX_CHECKSUM_OK on stack
+typedef struct {
+    unsigned int flags;
+} ETH_RX_STACK;
+
 void eth_set_mac(HANDLE eth, unsigned int eth_handle, const MAC* mac);
 void eth_get_mac(HANDLE eth, unsigned int eth_handle, MAC* mac);
 unsigned int eth_get_header_size(HANDLE eth, unsigned int eth_handle);
+unsigned int eth_get_features(HANDLE eth, unsigned int eth_handle);
+void eth_get_ring_size(HANDLE eth, unsigned int eth_handle, unsigned int* rx, unsigned int* tx);
 
 #endif // ETH_H
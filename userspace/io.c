@@ -22,16 +22,27 @@ void* io_stack(IO* io)
 
 void* io_push(IO* io, unsigned int size)
 {
+    unsigned int spill;
+    IO* next = io->next;
     if (io_get_free(io) < size)
-        return NULL;
+    {
+        spill = size - io_get_free(io);
+        if (next == NULL || io->data_size < spill || io_get_free(next) < spill)
+            return NULL;
+        //data order of chain is kept
+        memmove((uint8_t*)io_data(next) + spill, io_data(next), next->data_size);
+        memcpy(io_data(next), (uint8_t*)io_data(io) + io->data_size - spill, spill);
+        next->data_size += spill;
+        io->data_size -= spill;
+    }
     io->stack_size += size;
     return io_stack(io);
 }
 
 void io_push_data(IO* io, void* data, unsigned int size)
 {
-    io_push(io, size);
-    memcpy(io_stack(io), data, size);
+    if (io_push(io, size) != NULL)
+        memcpy(io_stack(io), data, size);
 }
 
 void* io_pop(IO* io, unsigned int size)
@@ -49,21 +60,69 @@ unsigned int io_get_free(IO* io)
 
 unsigned int io_data_write(IO* io, const void* data, unsigned int size)
 {
-    io->data_size = 0;
-    if (io_get_free(io) < size)
-        size = io_get_free(io);
-    memcpy(io_data(io), data, size);
-    io->data_size = size;
-    return size;
+    IO* cur;
+    for (cur = io; cur != NULL; cur = cur->next)
+        cur->data_size = 0;
+    return io_data_append(io, data, size);
 }
 
 unsigned int io_data_append(IO* io, const void* data, unsigned int size)
 {
-    if (io_get_free(io) < size)
-        size = io_get_free(io);
-    memcpy(io_data(io) + io->data_size, data, size);
-    io->data_size += size;
-    return size;
+    IO* cur;
+    unsigned int chunk;
+    unsigned int res = 0;
+    //skip to last non-empty segment
+    for (cur = io; cur->next != NULL && cur->next->data_size; cur = cur->next) {}
+    for (; cur != NULL && size; cur = cur->next)
+    {
+        chunk = io_get_free(cur);
+        if (chunk > size)
+            chunk = size;
+        memcpy(io_data(cur) + cur->data_size, (const uint8_t*)data + res, chunk);
+        cur->data_size += chunk;
+        res += chunk;
+        size -= chunk;
+    }
+    return res;
+}
+
+void io_chain(IO* io, IO* segment)
+{
+    for (; io->next != NULL; io = io->next) {}
+    io->next = segment;
+}
+
+IO* io_unchain(IO* io)
+{
+    IO* res = io->next;
+    io->next = NULL;
+    return res;
+}
+
+unsigned int io_chain_size(IO* io)
+{
+    unsigned int res;
+    for (res = 0; io != NULL; io = io->next)
+        res += io->data_size;
+    return res;
+}
+
+unsigned int io_chain_read(IO* io, unsigned int offset, void* data, unsigned int size)
+{
+    unsigned int chunk;
+    unsigned int res = 0;
+    for (; io != NULL && offset >= io->data_size; io = io->next)
+        offset -= io->data_size;
+    for (; io != NULL && size; io = io->next, offset = 0)
+    {
+        chunk = io->data_size - offset;
+        if (chunk > size)
+            chunk = size;
+        memcpy((uint8_t*)data + res, (uint8_t*)io_data(io) + offset, chunk);
+        res += chunk;
+        size -= chunk;
+    }
+    return res;
 }
 
 void io_reset(IO* io)
@@ -112,6 +171,11 @@ int io_async_wait(HANDLE process, unsigned int cmd, unsigned int handle)
     return (int)ipc.param3;
 }
 
+void io_ref(IO* io)
+{
+    svc_call(SVC_IO_REF, (unsigned int)io, 0, 0);
+}
+
 void io_destroy(IO* io)
 {
     if (io != NULL)
@@ -28,11 +28,18 @@
  *      +-------------------------+
  *      |    user params stack    |
  *      +-------------------------+
+ *
+ *      IO can be chained with other IOs (segments). Data of chain is data of all segments in order,
+ *      user params stack is always in head. Chain is sent and destroyed as whole.
  */
 
-typedef struct {
+typedef struct _IO {
     HANDLE kio;
     unsigned int size, data_offset, data_size, stack_size;
+    //next segment of chain or NULL
+    struct _IO* next;
+    //link in queue of current owner. Not used by kernel
+    struct _IO* queue;
 } IO;
 
 #pragma pack(pop)
@@ -59,9 +66,10 @@ void* io_stack(IO* io);
 
 /**
     \brief push IO stack
+    \details Stack is always in head. For chain, tail of head data is moved to next segment, if head is full
     \param io: IO pointer
     \param size: data size
-    \retval none
+    \retval new stack pointer or NULL
 */
 void *io_push(IO* io, unsigned int size);
 
@@ -91,6 +99,7 @@ unsigned int io_get_free(IO* io);
 
 /**
     \brief safe write data to IO
+    \details For chain data is written starting from head, continuing to next segments
     \param io: IO pointer
     \param data: data pointer
     \param size: data size
@@ -101,6 +110,7 @@ unsigned int io_data_write(IO* io, const void *data, unsigned int size);
 
 /**
     \brief safe append data to end of IO
+    \details For chain data is appended after last non-empty segment, continuing to next segments
     \param io: IO pointer
     \param data: data pointer
     \param size: data size
@@ -108,6 +118,38 @@ unsigned int io_data_write(IO* io, const void *data, unsigned int size);
 */
 unsigned int io_data_append(IO* io, const void *data, unsigned int size);
 
+/**
+    \brief append segment to end of chain
+    \param io: chain head
+    \param segment: IO or chain to append
+    \retval none
+*/
+void io_chain(IO* io, IO* segment);
+
+/**
+    \brief detach rest of chain
+    \param io: IO pointer
+    \retval detached segments or NULL
+*/
+IO* io_unchain(IO* io);
+
+/**
+    \brief get data size of whole chain
+    \param io: chain head
+    \retval data size
+*/
+unsigned int io_chain_size(IO* io);
+
+/**
+    \brief read data of chain
+    \param io: chain head
+    \param offset: offset in chain data
+    \param data: data pointer
+    \param size: data size
+    \retval data actually read
+*/
+unsigned int io_chain_read(IO* io, unsigned int offset, void* data, unsigned int size);
+
 
 /**
     \brief reset IO to default values
@@ -141,6 +183,7 @@ void io_show(IO* io);
 
 /**
     \brief creates IO
+    \details Taken from preallocated kernel IO pool if size fits, otherwise allocated from heap
     \param size: size of io without header
     \retval IO pointer on success.
 */
@@ -208,6 +251,19 @@ IO* io_create(unsigned int size);
 */
 #define io_complete_ex(process, cmd, handle, io, param3)                ipc_post_inline((process), (cmd), (handle), (unsigned int)(io), (param3))
 
+/**
+    \brief give IO to another process
+    \details Ownership is transferred: receiver must destroy IO or give it further. Sender must not
+    use IO anymore. Sent with HAL_IO_GIVE_MODE, so receiver must match command by HAL_GROUP/HAL_ITEM
+    \param process: receiver process
+    \param cmd: command to send
+    \param handle: user handle
+    \param io: pointer to IO structure
+    \param param3: ext param or error
+    \retval none.
+*/
+#define io_give(process, cmd, handle, io, param3)                       ipc_post_inline((process), (cmd) | HAL_IO_GIVE_MODE, (handle), (unsigned int)(io), (param3))
+
 /**
     \brief wait for async IO completion
     \param process: target process
@@ -286,8 +342,18 @@ int io_async_wait(HANDLE process, unsigned int cmd, unsigned int handle);
 */
 #define io_read_sync_exo(cmd, handle, io, size)                         get_size_exo((cmd), (handle), (unsigned int)(io), (size))
 
+/**
+    \brief add reference to IO. Owner only
+    \details IO is destroyed on last io_destroy
+    \param io: io pointer
+    \retval none
+*/
+void io_ref(IO* io);
+
 /**
     \brief destroy IO
+    \details Releases reference. IO is returned to pool or heap, when last reference is released.
+    For chain all segments are released. Segment, referenced in other chain, must be last in chain
     \param io: io to destroy
     \retval IO pointer on success.
 */
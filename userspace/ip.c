@@ -6,6 +6,7 @@
 
 #include "ip.h"
 #include "stdio.h"
+#include "endian.h"
 
 void ip_print(const IP* ip)
 {
@@ -18,18 +19,82 @@ void ip_print(const IP* ip)
     }
 }
 
-uint16_t ip_checksum(void* buf, unsigned int size)
+//one's complement sum is byte order independent (RFC 1071): sum is accumulated in native order
+static inline uint16_t ip_checksum_raw(uint16_t value)
+{
+    uint16_t raw;
+    short2be((uint8_t*)&raw, value);
+    return raw;
+}
+
+uint32_t ip_checksum_add(uint32_t sum, const void* buf, unsigned int size)
 {
-    unsigned int i;
-    uint32_t sum = 0;
-    for (i = 0; i < (size >> 1); ++i)
-        sum += (((uint8_t*)buf)[i << 1] << 8) | (((uint8_t*)buf)[(i << 1) + 1]);
+    const uint8_t* p = buf;
+    const uint32_t* w;
+    uint64_t acc = 0;
+    uint16_t tail;
+    bool odd = ((unsigned int)p & 1) && size;
+    //odd start: leading zero, whole sum is byte swapped
+    if (odd)
+    {
+        tail = 0;
+        ((uint8_t*)&tail)[1] = *p++;
+        acc += tail;
+        --size;
+    }
+    if (((unsigned int)p & 2) && size >= 2)
+    {
+        acc += *(const uint16_t*)p;
+        p += 2;
+        size -= 2;
+    }
+    w = (const uint32_t*)p;
+    for (; size >= 32; size -= 32, w += 8)
+        acc += (uint64_t)w[0] + w[1] + w[2] + w[3] + w[4] + w[5] + w[6] + w[7];
+    for (; size >= 4; size -= 4)
+        acc += *w++;
+    p = (const uint8_t*)w;
+    if (size >= 2)
+    {
+        acc += *(const uint16_t*)p;
+        p += 2;
+        size -= 2;
+    }
     //padding zero
-    if (size & 1)
-        sum += ((uint8_t*)buf)[size - 1] << 8;
+    if (size)
+    {
+        tail = 0;
+        ((uint8_t*)&tail)[0] = *p;
+        acc += tail;
+    }
+    while (acc >> 16)
+        acc = (acc & 0xffff) + (acc >> 16);
+    if (odd)
+        acc = ((acc & 0xff) << 8) | (acc >> 8);
+    sum += (uint32_t)acc;
     while (sum >> 16)
         sum = (sum & 0xffff) + (sum >> 16);
-    return ~((uint16_t)sum);
+    return sum;
+}
+
+uint16_t ip_checksum_fold(uint32_t sum)
+{
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return ip_checksum_raw(~sum);
+}
+
+uint16_t ip_checksum(void* buf, unsigned int size)
+{
+    return ip_checksum_fold(ip_checksum_add(0, buf, size));
+}
+
+uint16_t ip_checksum_update(uint16_t checksum, const void* from, const void* to, unsigned int size)
+{
+    //RFC 1624: HC' = ~(~HC + ~m + m')
+    uint32_t sum = (uint16_t)~ip_checksum_raw(checksum);
+    sum += (uint16_t)~ip_checksum_add(0, from, size);
+    return ip_checksum_fold(ip_checksum_add(sum, to, size));
 }
 
 bool ip_compare(const IP* ip1, const IP* ip2, const IP* mask)
@@ -227,6 +227,31 @@ typedef enum {
 
 void ip_print(const IP* ip);
 uint16_t ip_checksum(void *buf, unsigned int size);
+/**
+    \brief add buffer to partial checksum
+    \details partial sum is in native byte order. All previous chunks must be of even size
+    \param sum: partial sum of previous chunks or 0
+    \param buf: data
+    \param size: data size
+    \retval partial sum
+*/
+uint32_t ip_checksum_add(uint32_t sum, const void* buf, unsigned int size);
+/**
+    \brief make checksum from partial sum
+    \param sum: partial sum
+    \retval checksum, same as ip_checksum()
+*/
+uint16_t ip_checksum_fold(uint32_t sum);
+/**
+    \brief incremental checksum update (RFC 1624)
+    \details changed field must start at even offset from start of checksummed data
+    \param checksum: old checksum, as returned by ip_checksum()
+    \param from: old field value
+    \param to: new field value
+    \param size: field size
+    \retval new checksum
+*/
+uint16_t ip_checksum_update(uint16_t checksum, const void* from, const void* to, unsigned int size);
 bool ip_compare(const IP* ip1, const IP* ip2, const IP* mask);
 void ip_set(HANDLE tcpip, const IP* ip);
 void ip_get(HANDLE tcpip, IP* ip);
@@ -16,7 +16,15 @@
 static int ipc_index(HANDLE wait_process, unsigned int cmd, unsigned int param1)
 {
     int i;
-    unsigned int head = __GLOBAL->process->ipcs.head;
+    unsigned int head, hash;
+    if ((wait_process != ANY_HANDLE) && (cmd != ANY_CMD))
+    {
+        hash = IPC_HASH(wait_process, cmd);
+        //nothing queued from this sender with this cmd
+        if (__GLOBAL->process->ipc_posted[hash] == __GLOBAL->process->ipc_peeked[hash])
+            return -1;
+    }
+    head = __GLOBAL->process->ipcs.head;
     for (i = __GLOBAL->process->ipcs.tail; i != head; i = RB_ROUND(&__GLOBAL->process->ipcs, i + 1))
         if (((IPC_ITEM(i)->process == wait_process) || (wait_process == ANY_HANDLE)) && ((IPC_ITEM(i)->cmd == cmd) || (cmd == ANY_CMD)) &&
              ((IPC_ITEM(i)->param1 == param1) || (param1 == ANY_HANDLE)))
@@ -36,7 +44,11 @@ static IPC* ipc_peek(int index, IPC* ipc)
         memcpy(IPC_ITEM(RB_ROUND_BACK(&__GLOBAL->process->ipcs, index - 1)), &tmp, sizeof(IPC));
     }
     memcpy(ipc, IPC_ITEM(__GLOBAL->process->ipcs.tail), sizeof(IPC));
+    ++__GLOBAL->process->ipc_peeked[IPC_HASH(ipc->process, ipc->cmd)];
     rb_get(&__GLOBAL->process->ipcs);
+    //free space for blocked sender
+    if (__GLOBAL->process->ipc_blocked)
+        svc_call(SVC_IPC_UNBLOCK, 0, 0, 0);
     return ipc;
 }
 
@@ -55,6 +67,11 @@ void ipc_post(IPC* ipc)
     svc_call(SVC_IPC_POST, (unsigned int)ipc, 0, 0);
 }
 
+void ipc_post_batch(IPC* ipcs, unsigned int count)
+{
+    svc_call(SVC_IPC_POST_BATCH, (unsigned int)ipcs, count, 0);
+}
+
 void ipc_post_inline(HANDLE process, unsigned int cmd, unsigned int param1, unsigned int param2, unsigned int param3)
 {
     IPC ipc;
@@ -97,6 +114,23 @@ void ipc_read(IPC* ipc)
     }
 }
 
+unsigned int ipc_read_batch(IPC* ipcs, unsigned int max)
+{
+    unsigned int count;
+    error(ERROR_OK);
+    if (rb_is_empty(&__GLOBAL->process->ipcs))
+        svc_call(SVC_IPC_WAIT, ANY_HANDLE, ANY_CMD, ANY_HANDLE);
+    for (count = 0; (count < max) && !rb_is_empty(&__GLOBAL->process->ipcs); )
+    {
+        ipc_peek(__GLOBAL->process->ipcs.tail, &ipcs[count]);
+        if (ipcs[count].cmd == HAL_REQ(HAL_SYSTEM, IPC_PING))
+            ipc_write(&ipcs[count]);
+        else
+            ++count;
+    }
+    return count;
+}
+
 void ipc_read_ex(IPC* ipc, HANDLE process, unsigned int cmd, unsigned int param1)
 {
     if (ipc_index(process, cmd, param1) < 0)
@@ -126,8 +160,15 @@ void ipc_write(IPC* ipc)
 
 void call(IPC* ipc)
 {
+    int index;
     svc_call(SVC_IPC_CALL, (unsigned int)ipc, 0, 0);
-    ipc_peek(ipc_index(ipc->process, ipc->cmd & ~HAL_REQ_FLAG, ipc->param1), ipc);
+    //receiver destroyed, while we are blocked on it's queue
+    if ((index = ipc_index(ipc->process, ipc->cmd & ~HAL_REQ_FLAG, ipc->param1)) < 0)
+    {
+        ipc->param3 = get_last_error();
+        return;
+    }
+    ipc_peek(index, ipc);
 }
 
 void ack(HANDLE process, unsigned int cmd, unsigned int param1, unsigned int param2, unsigned int param3)
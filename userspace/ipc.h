@@ -80,6 +80,8 @@ typedef enum {
 //ipc contains IO in param2
 #define HAL_MODE                                            (3 << 30)
 #define HAL_IO_MODE                                         (1ul << 30)
+//ipc contains IO in param2, ownership is transferred to receiver
+#define HAL_IO_GIVE_MODE                                    (3ul << 30)
 //response required
 #define HAL_REQ_FLAG                                        (1ul << 15)
 
@@ -123,6 +125,15 @@ unsigned int ipc_remove(HANDLE process, unsigned int cmd, unsigned int param1);
 */
 void ipc_post(IPC* ipc);
 
+/**
+    \brief post number of IPCs with single system call
+    \details Receivers are waked up, but context is switched only once, after all IPCs are posted
+    \param ipcs: array of IPC structures
+    \param count: number of IPCs in array
+    \retval none
+*/
+void ipc_post_batch(IPC* ipcs, unsigned int count);
+
 /**
     \brief post IPC, inline version
     \param process: receiver process
@@ -170,6 +181,15 @@ void ipc_ipost_inline(HANDLE process, unsigned int cmd, unsigned int param1, uns
 */
 void ipc_read(IPC* ipc);
 
+/**
+    \brief read all queued IPCs, but not more than max. Ping is processed internally
+    \details If queue is empty, wait for IPC first
+    \param ipcs: array of IPC structures to fill
+    \param max: max number of IPCs to read
+    \retval number of IPCs read. Can be 0, if only ping was received
+*/
+unsigned int ipc_read_batch(IPC* ipcs, unsigned int max);
+
 /**
     \brief read message fro process
     \param ipc: ipc to read
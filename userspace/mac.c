@@ -6,6 +6,8 @@
 
 #include "mac.h"
 #include "stdio.h"
+#include "error.h"
+#include "process.h"
 
 void mac_print(const MAC* mac)
 {
@@ -43,3 +45,14 @@ void mac_disable_firewall(HANDLE tcpip)
 {
     ack(tcpip, HAL_REQ(HAL_MAC, MAC_DISABLE_FIREWALL), 0, 0, 0);
 }
+
+bool mac_pcap_start(HANDLE tcpip, unsigned int snaplen)
+{
+    ack(tcpip, HAL_REQ(HAL_MAC, MAC_PCAP_START), 0, snaplen, 0);
+    return get_last_error() == ERROR_OK;
+}
+
+unsigned int mac_pcap_stop(HANDLE tcpip)
+{
+    return get(tcpip, HAL_REQ(HAL_MAC, MAC_PCAP_STOP), 0, 0, 0);
+}
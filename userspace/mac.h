@@ -10,6 +10,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "ipc.h"
+#include "io.h"
 
 #define MAC_INDIVIDUAL_ADDRESS                      (0 << 0)
 #define MAC_MULTICAST_ADDRESS                       (1 << 0)
@@ -41,12 +42,20 @@ typedef struct {
 
 typedef enum {
     MAC_ENABLE_FIREWALL = IPC_USER,
-    MAC_DISABLE_FIREWALL
+    MAC_DISABLE_FIREWALL,
+    MAC_PCAP_START,
+    MAC_PCAP_STOP
 }MAC_IPCS;
 
+//pcap stream of captured frames. Global header first, then records in libpcap format
+#define mac_pcap_read(tcpip, io, size)                              io_read((tcpip), HAL_IO_REQ(HAL_MAC, IPC_READ), 0, (io), (size))
+#define mac_pcap_read_sync(tcpip, io, size)                         io_read_sync((tcpip), HAL_IO_REQ(HAL_MAC, IPC_READ), 0, (io), (size))
+
 void mac_print(const MAC* mac);
 bool mac_compare(const MAC* src, const MAC* dst);
 void mac_enable_firewall(HANDLE tcpip, const MAC* src);
 void mac_disable_firewall(HANDLE tcpip);
+bool mac_pcap_start(HANDLE tcpip, unsigned int snaplen);
+unsigned int mac_pcap_stop(HANDLE tcpip);
 
 #endif // MAC_H
@@ -47,6 +47,14 @@ typedef enum {
 }PROCESS_SYNC_TYPE;
 
 #define REX_FLAG_PERSISTENT_NAME                                 (1 << 24)
+//sender is sleeping on full receiver IPC queue instead of ERROR_OVERFLOW. Not applied for IRQ/kernel posts
+#define REX_FLAG_IPC_BLOCKING                                    (1 << 25)
+
+//must be power of 2
+#define IPC_HASH_SIZE                                            16
+#define IPC_HASH(process, cmd)                                   ((((unsigned int)(process) >> 2) ^ (cmd) ^ ((cmd) >> 16)) & (IPC_HASH_SIZE - 1))
+//width of hash counters
+#define IPC_SIZE_MAX                                             0xffff
 
 typedef struct {
     const char* name;
@@ -54,6 +62,8 @@ typedef struct {
     unsigned int priority;
     unsigned int flags;
     void (*fn) (void);
+    //IPC queue size. 0 - KERNEL_IPC_COUNT
+    unsigned int ipc_size;
 }REX;
 
 typedef struct {
@@ -63,6 +73,12 @@ typedef struct {
     HANDLE stdout, stdin;
     const char* name;
     RB ipcs;
+    //queued IPC count by sender/cmd hash is ipc_posted - ipc_peeked. Posted is written only by kernel,
+    //peeked only by process itself, so no lock is required. Counters wrap, so queue is limited by IPC_SIZE_MAX
+    uint16_t ipc_posted[IPC_HASH_SIZE];
+    uint16_t ipc_peeked[IPC_HASH_SIZE];
+    //senders are blocked on full queue. Written by kernel
+    bool ipc_blocked;
     //follow:
     //IPC queue
     //name holder (if not persistent)
@@ -94,6 +94,18 @@ __STATIC_INLINE unsigned int rb_get(RB* rb)
     return offset;
 }
 
+/**
+    \brief put item before tail, so it will be get first
+    \details Not safe with concurrent get
+    \param rb: pointer to initialized \ref RB structure
+    \retval index of element from start, where need to put data
+*/
+__STATIC_INLINE unsigned int rb_unget(RB* rb)
+{
+    rb->tail = RB_ROUND_BACK(rb, (int)rb->tail - 1);
+    return rb->tail;
+}
+
 /**
     \brief get rb used size
     \param rb: pointer to initialized \ref RB structure
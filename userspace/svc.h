@@ -49,6 +49,8 @@ typedef enum {
     SVC_IPC_POST,
     SVC_IPC_WAIT,
     SVC_IPC_CALL,
+    SVC_IPC_POST_BATCH,
+    SVC_IPC_UNBLOCK,
 
     SVC_STREAM_CREATE,
     SVC_STREAM_OPEN,
@@ -65,6 +67,7 @@ typedef enum {
     SVC_STREAM_DESTROY,
 
     SVC_IO_CREATE,
+    SVC_IO_REF,
     SVC_IO_DESTROY,
 
     SVC_OBJECT_SET,
@@ -72,6 +75,7 @@ typedef enum {
 
     SVC_ADD_POOL,
     SVC_SETUP_DBG,
+    SVC_PRINTD,
     SVC_TEST
 }SVC;
 
@@ -84,13 +88,17 @@ typedef void (*STDOUT)(const char *const buf, unsigned int size, void* param);
 
 /**
     \brief arch-dependent stack pointer query
-    \details Same for every ARM, so defined here
+    \details Same for every ARM, so defined here. POSIX host simulation uses x86-64 rsp
     \retval stack pointer
 */
 __STATIC_INLINE void* get_sp()
 {
   void* result;
+#ifdef POSIX
+  __ASM volatile ("mov %%rsp, %0" : "=r" (result));
+#else
   __ASM volatile ("mov %0, sp" : "=r" (result));
+#endif //POSIX
   return result;
 }
 
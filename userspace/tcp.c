@@ -6,6 +6,7 @@
 
 #include "tcp.h"
 #include "endian.h"
+#include "process.h"
 
 #pragma pack(push, 1)
 typedef struct {
@@ -20,24 +21,13 @@ typedef struct {
 uint16_t tcp_checksum(void* buf, unsigned int size, const IP* src, const IP* dst)
 {
     TCP_PSEUDO_HEADER tph;
-    unsigned int i;
-    uint32_t sum = 0;
     tph.src.u32.ip = src->u32.ip;
     tph.dst.u32.ip = dst->u32.ip;
     tph.zero = 0;
     tph.ptcl = PROTO_TCP;
     short2be(tph.length_be, size);
 
-    for (i = 0; i < (sizeof(TCP_PSEUDO_HEADER) >> 1); ++i)
-        sum += (((uint8_t*)&tph)[i << 1] << 8) | (((uint8_t*)&tph)[(i << 1) + 1]);
-    for (i = 0; i < (size >> 1); ++i)
-        sum += (((uint8_t*)buf)[i << 1] << 8) | (((uint8_t*)buf)[(i << 1) + 1]);
-    //padding zero
-    if (size & 1)
-        sum += ((uint8_t*)buf)[size - 1] << 8;
-    while (sum >> 16)
-        sum = (sum & 0xffff) + (sum >> 16);
-    return ~((uint16_t)sum);
+    return ip_checksum_fold(ip_checksum_add(ip_checksum_add(0, &tph, sizeof(TCP_PSEUDO_HEADER)), buf, size));
 }
 
 void tcp_get_remote_addr(HANDLE tcpip, HANDLE handle, IP* ip)
@@ -55,6 +45,17 @@ uint16_t tcp_get_local_port(HANDLE tcpip, HANDLE handle)
     return get(tcpip, HAL_REQ(HAL_TCP, TCP_GET_LOCAL_PORT), handle, 0, 0);
 }
 
+void tcp_get_stat(HANDLE tcpip, TCP_STAT* stat)
+{
+    IPC ipc;
+    ipc.cmd = HAL_REQ(HAL_TCP, TCP_GET_STAT);
+    ipc.process = tcpip;
+    ipc.param1 = 0;
+    call(&ipc);
+    stat->rx_bytes = ipc.param2;
+    stat->tx_acks = ipc.param3;
+}
+
 HANDLE tcp_listen(HANDLE tcpip, unsigned short port)
 {
     return get_handle(tcpip, HAL_REQ(HAL_TCP, TCP_LISTEN), port, 0, 0);
@@ -80,7 +81,36 @@ void tcp_close(HANDLE tcpip, HANDLE handle)
     ack(tcpip, HAL_REQ(HAL_TCP, IPC_CLOSE), handle, 0, 0);
 }
 
+IO* tcp_read_frame_sync(HANDLE tcpip, HANDLE handle)
+{
+    IPC ipc;
+    ipc.cmd = HAL_IO_REQ(HAL_TCP, TCP_READ_FRAME) | HAL_IO_GIVE_MODE;
+    ipc.process = tcpip;
+    ipc.param1 = handle;
+    ipc.param2 = 0;
+    ipc.param3 = 0;
+    call(&ipc);
+    if ((int)ipc.param3 < 0)
+    {
+        error(ipc.param3);
+        return NULL;
+    }
+    return (IO*)ipc.param2;
+}
+
 void tcp_flush(HANDLE tcpip, HANDLE handle)
 {
     ack(tcpip, HAL_REQ(HAL_TCP, IPC_FLUSH), handle, 0, 0);
 }
+
+IO* tcp_unchain_write(IO* io)
+{
+    IO* cur;
+    IO* next = io->queue;
+    if (next == NULL)
+        return NULL;
+    for (cur = io; cur->next != NULL && cur->next != next; cur = cur->next) {}
+    cur->next = NULL;
+    io->queue = NULL;
+    return next;
+}
@@ -26,14 +26,23 @@ typedef enum {
     TCP_CREATE_TCB,
     TCP_GET_REMOTE_ADDR,
     TCP_GET_REMOTE_PORT,
-    TCP_GET_LOCAL_PORT
+    TCP_GET_LOCAL_PORT,
+    TCP_GET_STAT,
+    TCP_READ_FRAME,
+    TCP_RELEASE_FRAME
 }TCP_IPCS;
 
+typedef struct {
+    //received text bytes, pure ACK frames sent
+    unsigned int rx_bytes, tx_acks;
+} TCP_STAT;
+
 uint16_t tcp_checksum(void* buf, unsigned int size, const IP* src, const IP* dst);
 
 void tcp_get_remote_addr(HANDLE tcpip, HANDLE handle, IP* ip);
 uint16_t tcp_get_remote_port(HANDLE tcpip, HANDLE handle);
 uint16_t tcp_get_local_port(HANDLE tcpip, HANDLE handle);
+void tcp_get_stat(HANDLE tcpip, TCP_STAT* stat);
 
 HANDLE tcp_listen(HANDLE tcpip, unsigned short port);
 void tcp_close_listen(HANDLE tcpip, HANDLE handle);
@@ -47,6 +56,20 @@ void tcp_close(HANDLE tcpip, HANDLE handle);
 #define tcp_write(tcpip, handle, io)                                io_write((tcpip), HAL_IO_REQ(HAL_TCP, IPC_WRITE), (handle), (io))
 #define tcp_write_sync(tcpip, handle, io)                           io_write_sync((tcpip), HAL_IO_REQ(HAL_TCP, IPC_WRITE), (handle), (io))
 
+/*
+    on connection close not sent writes are completed with ERROR_CONNECTION_CLOSED in few IPC_WRITE: blocks are chained,
+    next block starts at io->queue of previous. Detach next block from returned chain, NULL if io is last
+*/
+IO* tcp_unchain_write(IO* io);
+
+/*
+    zero-copy read. Received frame is given to user with header hidden. Frame must be returned by tcp_release_frame,
+    window is reopened after. Connection can't be switched back to tcp_read
+*/
+#define tcp_read_frame(tcpip, handle)                               ipc_post_inline((tcpip), HAL_IO_REQ(HAL_TCP, TCP_READ_FRAME) | HAL_IO_GIVE_MODE, (handle), 0, 0)
+#define tcp_release_frame(tcpip, handle, io)                        io_give((tcpip), HAL_IO_CMD(HAL_TCP, TCP_RELEASE_FRAME), (handle), (io), 0)
+IO* tcp_read_frame_sync(HANDLE tcpip, HANDLE handle);
+
 void tcp_flush(HANDLE tcpip, HANDLE handle);
 
 #endif // TCP_H
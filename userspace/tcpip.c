@@ -7,6 +7,11 @@
 #include "tcpip.h"
 #include "stdio.h"
 #include "process.h"
+#include "sys_config.h"
+
+#ifndef TCPIP_IPC_COUNT
+#define TCPIP_IPC_COUNT                         0
+#endif //TCPIP_IPC_COUNT
 
 extern void tcpips_main();
 
@@ -20,6 +25,7 @@ HANDLE tcpip_create(unsigned int process_size, unsigned int priority, unsigned i
     rex.priority = priority;
     rex.flags = PROCESS_FLAGS_ACTIVE;
     rex.fn = tcpips_main;
+    rex.ipc_size = TCPIP_IPC_COUNT;
     return process_create(&rex);
 }
 
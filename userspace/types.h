@@ -26,10 +26,21 @@
 #include <stddef.h>
 #include <stdarg.h>
 
+//freed small slots are cached by size class, not merged back to pool
+#define POOL_CACHE_CLASSES                  8
+#define POOL_CACHE_GRANULARITY              8
+
 typedef struct {
     void* free_slot;
     void* first_slot;
     void* last_slot;
+    void* cache[POOL_CACHE_CLASSES];
+    //changed with free slots
+    unsigned int gen;
+    //walk steps since last yield, over all walks
+    unsigned int steps;
+    //called on long walk of free slots, may change pool. NULL - walk is never split
+    void (*yield)(void);
 } POOL;
 
 typedef struct {
@@ -38,6 +49,10 @@ typedef struct {
     unsigned int free;
     unsigned int used;
     unsigned int largest_free;
+    unsigned int cached_slots;
+    unsigned int cached;
+    //percent of free space, not in largest free slot
+    unsigned int fragmentation;
 } POOL_STAT;
 
 #endif // TYPES_H
@@ -144,6 +144,7 @@ HANDLE usbd_create(USB_PORT_TYPE port, unsigned int process_size, unsigned int p
     rex.priority = priority;
     rex.flags = PROCESS_FLAGS_ACTIVE;
     rex.fn = usbd;
+    rex.ipc_size = 0;
     return process_create(&rex);
 }
 
@@ -20,6 +20,7 @@ HANDLE vfs_create(unsigned int process_size, unsigned int priority)
     rex.priority = priority;
     rex.flags = PROCESS_FLAGS_ACTIVE;
     rex.fn = vfss;
+    rex.ipc_size = 0;
     return process_create(&rex);
 
 }
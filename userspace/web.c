@@ -7,8 +7,13 @@
 #include "web.h"
 #include "../midware/http/webs.h"
 #include "error.h"
+#include "sys_config.h"
 #include <string.h>
 
+#ifndef WEBS_IPC_COUNT
+#define WEBS_IPC_COUNT                          0
+#endif //WEBS_IPC_COUNT
+
 extern void webs_main();
 
 HANDLE web_server_create(unsigned int process_size, unsigned int priority)
@@ -17,8 +22,10 @@ HANDLE web_server_create(unsigned int process_size, unsigned int priority)
     rex.name = "Web Server";
     rex.size = process_size;
     rex.priority = priority;
-    rex.flags = PROCESS_FLAGS_ACTIVE;
+    //throttle on stack queue full instead of IO loss
+    rex.flags = PROCESS_FLAGS_ACTIVE | REX_FLAG_IPC_BLOCKING;
     rex.fn = webs_main;
+    rex.ipc_size = WEBS_IPC_COUNT;
     return process_create(&rex);
 }
 